@@ -35,6 +35,27 @@
 
 extern BOOL sse2_supported DECLSPEC_HIDDEN;
 
+#if defined(__i386__) || defined(__x86_64__)
+#ifdef __i386__
+#define SSE2_FUNC __attribute__((target("sse2")))
+#else
+#define SSE2_FUNC
+#endif
+
+typedef char sse2_vec __attribute__((vector_size(16), __may_alias__));
+typedef char sse2_vec_u __attribute__((vector_size(16), __may_alias__, __aligned__(1)));
+typedef short sse2_vec_w __attribute__((vector_size(16), __may_alias__));
+
+static inline BOOL use_sse2(void)
+{
+#ifdef __x86_64__
+    return TRUE;
+#else
+    return sse2_supported;
+#endif
+}
+#endif
+
 #define DBL80_MAX_10_EXP 4932
 #define DBL80_MIN_10_EXP -4951
 
@@ -1557,12 +1557,136 @@ int CDECL _atoldbl(_LDOUBLE *value, char *str)
     return _atoldbl_l( (MSVCRT__LDOUBLE*)value, str, NULL );
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+
+/* SSE2 versions of the string functions. They scan whole aligned 16-byte
+ * blocks, which never cross a page boundary, so reading past the end of the
+ * string is safe; bits for bytes before the start are masked out. */
+
+static inline SSE2_FUNC unsigned int sse2_cmpeq_mask(sse2_vec a, sse2_vec b)
+{
+    return __builtin_ia32_pmovmskb128((sse2_vec)(a == b));
+}
+
+static inline SSE2_FUNC sse2_vec sse2_splat(char c)
+{
+    return (sse2_vec){c, c, c, c, c, c, c, c, c, c, c, c, c, c, c, c};
+}
+
+static SSE2_FUNC size_t sse2_strlen(const char *str)
+{
+    const sse2_vec *p = (const sse2_vec *)((uintptr_t)str & ~15);
+    const sse2_vec zero = {0};
+    unsigned int mask;
+
+    mask = sse2_cmpeq_mask(*p, zero) & (~0u << ((uintptr_t)str & 15));
+    while (!mask) mask = sse2_cmpeq_mask(*++p, zero);
+    return (const char *)p + __builtin_ctz(mask) - str;
+}
+
+static SSE2_FUNC size_t sse2_strnlen(const char *str, size_t maxlen)
+{
+    const sse2_vec *p = (const sse2_vec *)((uintptr_t)str & ~15);
+    const sse2_vec zero = {0};
+    unsigned int mask;
+    size_t len;
+
+    mask = sse2_cmpeq_mask(*p, zero) & (~0u << ((uintptr_t)str & 15));
+    len = (const char *)(p + 1) - str;
+    while (!mask && len < maxlen)
+    {
+        mask = sse2_cmpeq_mask(*++p, zero);
+        len += 16;
+    }
+    if (!mask) return maxlen;
+    len = (const char *)p + __builtin_ctz(mask) - str;
+    return len < maxlen ? len : maxlen;
+}
+
+static SSE2_FUNC char *sse2_strchr(const char *str, char c)
+{
+    const sse2_vec *p = (const sse2_vec *)((uintptr_t)str & ~15);
+    const sse2_vec zero = {0}, chr = sse2_splat(c);
+    unsigned int mask;
+    const char *ret;
+
+    mask = (sse2_cmpeq_mask(*p, chr) | sse2_cmpeq_mask(*p, zero)) & (~0u << ((uintptr_t)str & 15));
+    while (!mask)
+    {
+        ++p;
+        mask = sse2_cmpeq_mask(*p, chr) | sse2_cmpeq_mask(*p, zero);
+    }
+    ret = (const char *)p + __builtin_ctz(mask);
+    return *ret == c ? (char *)ret : NULL;
+}
+
+static SSE2_FUNC void *sse2_memchr(const void *ptr, unsigned char c, size_t n)
+{
+    const sse2_vec *p = (const sse2_vec *)((uintptr_t)ptr & ~15);
+    const sse2_vec chr = sse2_splat(c);
+    unsigned int mask;
+    size_t len;
+
+    mask = sse2_cmpeq_mask(*p, chr) & (~0u << ((uintptr_t)ptr & 15));
+    len = (const char *)(p + 1) - (const char *)ptr;
+    while (!mask && len < n)
+    {
+        mask = sse2_cmpeq_mask(*++p, chr);
+        len += 16;
+    }
+    if (!mask) return NULL;
+    len = (const char *)p + __builtin_ctz(mask) - (const char *)ptr;
+    return len < n ? (char *)ptr + len : NULL;
+}
+
+/* The two strings usually have different alignments, so this uses unaligned
+ * loads and falls back to single bytes near the end of a page. */
+static SSE2_FUNC int sse2_strcmp(const char *str1, const char *str2)
+{
+    const sse2_vec zero = {0};
+    unsigned int mask;
+    sse2_vec a, b;
+
+    for (;;)
+    {
+        if (((uintptr_t)str1 & 0xfff) <= 0xff0 && ((uintptr_t)str2 & 0xfff) <= 0xff0)
+        {
+            a = *(const sse2_vec_u *)str1;
+            b = *(const sse2_vec_u *)str2;
+            if ((mask = (sse2_cmpeq_mask(a, b) ^ 0xffff) | sse2_cmpeq_mask(a, zero)))
+            {
+                str1 += __builtin_ctz(mask);
+                str2 += __builtin_ctz(mask);
+                break;
+            }
+            str1 += 16;
+            str2 += 16;
+        }
+        else
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+        }
+    }
+    if ((unsigned char)*str1 > (unsigned char)*str2) return 1;
+    if ((unsigned char)*str1 < (unsigned char)*str2) return -1;
+    return 0;
+}
+
+#endif
+
 /*********************************************************************
  *              strlen (MSVCRT.@)
  */
 size_t __cdecl strlen(const char *str)
 {
     const char *s = str;
+
+#if defined(__i386__) || defined(__x86_64__)
+    if (use_sse2()) return sse2_strlen(str);
+#endif
+
     while (*s) s++;
     return s - str;
 }
@@ -1574,6 +1698,10 @@ size_t CDECL strnlen(const char *s, size_t maxlen)
 {
     size_t i;
 
+#if defined(__i386__) || defined(__x86_64__)
+    if (use_sse2() && maxlen) return sse2_strnlen(s, maxlen);
+#endif
+
     for(i=0; i<maxlen; i++)
         if(!s[i]) break;
 
@@ -2759,6 +2887,23 @@ static inline int memcmp_blocks(const void *ptr1, const void *ptr2, size_t size)
     return memcmp_bytes(p1, p2, remainder);
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+static SSE2_FUNC int sse2_memcmp(const unsigned char *p1, const unsigned char *p2, size_t n)
+{
+    unsigned int mask;
+
+    for (; n >= 16; p1 += 16, p2 += 16, n -= 16)
+    {
+        if ((mask = sse2_cmpeq_mask(*(const sse2_vec_u *)p1, *(const sse2_vec_u *)p2) ^ 0xffff))
+        {
+            mask = __builtin_ctz(mask);
+            return p1[mask] > p2[mask] ? 1 : -1;
+        }
+    }
+    return memcmp_bytes(p1, p2, n);
+}
+#endif
+
 /*********************************************************************
  *                  memcmp (MSVCRT.@)
  */
@@ -2768,6 +2913,10 @@ int __cdecl memcmp(const void *ptr1, const void *ptr2, size_t n)
     size_t align;
     int result;
 
+#if defined(__i386__) || defined(__x86_64__)
+    if (use_sse2()) return sse2_memcmp(p1, p2, n);
+#endif
+
     if (n < sizeof(uint64_t))
         return memcmp_bytes(p1, p2, n);
 
@@ -3246,6 +3395,10 @@ void *__cdecl memset(void *dst, int c, size_t n)
  */
 char* __cdecl strchr(const char *str, int c)
 {
+#if defined(__i386__) || defined(__x86_64__)
+    if (use_sse2()) return sse2_strchr(str, c);
+#endif
+
     do
     {
         if (*str == (char)c) return (char*)str;
@@ -3270,6 +3423,10 @@ void* __cdecl memchr(const void *ptr, int c, size_t n)
 {
     const unsigned char *p = ptr;
 
+#if defined(__i386__) || defined(__x86_64__)
+    if (use_sse2()) return n ? sse2_memchr(ptr, c, n) : NULL;
+#endif
+
     for (p = ptr; n; n--, p++) if (*p == (unsigned char)c) return (void *)(ULONG_PTR)p;
     return NULL;
 }
@@ -3279,6 +3436,10 @@ void* __cdecl memchr(const void *ptr, int c, size_t n)
  */
 int __cdecl strcmp(const char *str1, const char *str2)
 {
+#if defined(__i386__) || defined(__x86_64__)
+    if (use_sse2()) return sse2_strcmp(str1, str2);
+#endif
+
     while (*str1 && *str1 == *str2) { str1++; str2++; }
     if ((unsigned char)*str1 > (unsigned char)*str2) return 1;
     if ((unsigned char)*str1 < (unsigned char)*str2) return -1;
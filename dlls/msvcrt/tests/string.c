@@ -74,7 +74,11 @@ static int (__cdecl *p_wcscpy_s)(wchar_t *wcDest, size_t size, const wchar_t *wc
 static int (__cdecl *p_wcsncpy_s)(wchar_t *wcDest, size_t size, const wchar_t *wcSrc, size_t count);
 static int (__cdecl *p_wcsncat_s)(wchar_t *dst, size_t elem, const wchar_t *src, size_t count);
 static int (__cdecl *p_wcsupr_s)(wchar_t *str, size_t size);
+static size_t (__cdecl *p_strlen)(const char *);
 static size_t (__cdecl *p_strnlen)(const char *, size_t);
+static char * (__cdecl *p_strchr)(const char *, int);
+static void * (__cdecl *p_memchr)(const void *, int, size_t);
+static size_t (__cdecl *p_wcslen)(const wchar_t *);
 static __int64 (__cdecl *p_strtoi64)(const char *, char **, int);
 static unsigned __int64 (__cdecl *p_strtoui64)(const char *, char **, int);
 static __int64 (__cdecl *p_wcstoi64)(const wchar_t *, wchar_t **, int);
@@ -4594,6 +4598,70 @@ static void test_wcsncpy(void)
             wine_dbgstr_wn(dst, ARRAY_SIZE(dst)));
 }
 
+static void test_page_boundary(void)
+{
+    char *mem, *str, copy[80];
+    wchar_t *wstr;
+    size_t len, off, i;
+    DWORD prot;
+
+    /* The strings end right before an inaccessible page, the implementation
+     * must not read past the page holding the terminator. */
+    mem = VirtualAlloc(NULL, 0x2000, MEM_COMMIT, PAGE_READWRITE);
+    ok(mem != NULL, "VirtualAlloc failed\n");
+    ok(VirtualProtect(mem + 0x1000, 0x1000, PAGE_NOACCESS, &prot), "VirtualProtect failed\n");
+
+    for (len = 0; len < 48; len++)
+    {
+        for (off = 0; off < 20; off++)
+        {
+            memset(mem, '#', 0x1000);
+            str = mem + 0x1000 - off - len - 1;
+            for (i = 0; i < len; i++) str[i] = 'a' + i % 26;
+            str[len] = 0;
+
+            ok(p_strlen(str) == len, "%Iu/%Iu: strlen returned %Iu\n", len, off, p_strlen(str));
+            if (p_strnlen)
+            {
+                ok(p_strnlen(str, len + 16) == len, "%Iu/%Iu: strnlen returned %Iu\n",
+                        len, off, p_strnlen(str, len + 16));
+                ok(p_strnlen(str, len / 2) == len / 2, "%Iu/%Iu: strnlen returned %Iu\n",
+                        len, off, p_strnlen(str, len / 2));
+            }
+            ok(p_strchr(str, '#') == NULL, "%Iu/%Iu: strchr returned %p\n", len, off, p_strchr(str, '#'));
+            ok(p_strchr(str, 0) == str + len, "%Iu/%Iu: strchr returned %p, expected %p\n",
+                    len, off, p_strchr(str, 0), str + len);
+            if (len)
+                ok(p_strchr(str, str[len - 1]) == str + (len - 1) % 26, "%Iu/%Iu: strchr returned %p\n",
+                        len, off, p_strchr(str, str[len - 1]));
+            ok(p_memchr(str, '#', len + 1) == NULL, "%Iu/%Iu: memchr returned %p\n",
+                    len, off, p_memchr(str, '#', len + 1));
+            ok(p_memchr(str, 0, len + 1) == str + len, "%Iu/%Iu: memchr returned %p, expected %p\n",
+                    len, off, p_memchr(str, 0, len + 1), str + len);
+
+            memcpy(copy + 1, str, len + 1);
+            ok(!p_strcmp(str, copy + 1), "%Iu/%Iu: strings differ\n", len, off);
+            ok(!pmemcmp(str, copy + 1, len + 1), "%Iu/%Iu: buffers differ\n", len, off);
+            if (len)
+            {
+                copy[len] = 'z' + 1;
+                ok(p_strcmp(str, copy + 1) < 0, "%Iu/%Iu: strcmp returned %d\n",
+                        len, off, p_strcmp(str, copy + 1));
+                ok(p_strcmp(copy + 1, str) > 0, "%Iu/%Iu: strcmp returned %d\n",
+                        len, off, p_strcmp(copy + 1, str));
+                ok(pmemcmp(str, copy + 1, len) != NULL, "%Iu/%Iu: buffers are equal\n", len, off);
+            }
+
+            wstr = (wchar_t *)(mem + 0x1000) - off - len - 1;
+            for (i = 0; i < len; i++) wstr[i] = 0x100 + i;
+            wstr[len] = 0;
+            ok(p_wcslen(wstr) == len, "%Iu/%Iu: wcslen returned %Iu\n", len, off, p_wcslen(wstr));
+        }
+    }
+
+    VirtualFree(mem, 0, MEM_RELEASE);
+}
+
 START_TEST(string)
 {
     char mem[100];
@@ -4613,6 +4681,10 @@ START_TEST(string)
     SET(p_strcpy, "strcpy");
     SET(p_strcmp, "strcmp");
     SET(p_strncmp, "strncmp");
+    SET(p_strlen, "strlen");
+    SET(p_strchr, "strchr");
+    SET(p_memchr, "memchr");
+    SET(p_wcslen, "wcslen");
     pstrcpy_s = (void *)GetProcAddress( hMsvcrt,"strcpy_s" );
     pstrcat_s = (void *)GetProcAddress( hMsvcrt,"strcat_s" );
     p_strncpy_s = (void *)GetProcAddress( hMsvcrt, "strncpy_s" );
@@ -4753,4 +4825,5 @@ START_TEST(string)
     test_SpecialCasing();
     test__mbbtype();
     test_wcsncpy();
+    test_page_boundary();
 }
@@ -2867,9 +2867,28 @@ wchar_t* CDECL wcsrchr(const wchar_t *str, wchar_t ch)
 /***********************************************************************
  *              wcslen (MSVCRT.@)
  */
+#if defined(__i386__) || defined(__x86_64__)
+static SSE2_FUNC size_t sse2_wcslen(const wchar_t *str)
+{
+    const sse2_vec_w *p = (const sse2_vec_w *)((uintptr_t)str & ~15);
+    const sse2_vec_w zero = {0};
+    unsigned int mask;
+
+    mask = __builtin_ia32_pmovmskb128((sse2_vec)(*p == zero)) & (~0u << ((uintptr_t)str & 15));
+    while (!mask) mask = __builtin_ia32_pmovmskb128((sse2_vec)(*++p == zero));
+    return ((const char *)p + __builtin_ctz(mask) - (const char *)str) / sizeof(wchar_t);
+}
+#endif
+
 size_t CDECL wcslen(const wchar_t *str)
 {
     const wchar_t *s = str;
+
+#if defined(__i386__) || defined(__x86_64__)
+    /* Aligned loads only line up with the characters for even addresses. */
+    if (use_sse2() && !((uintptr_t)str & 1)) return sse2_wcslen(str);
+#endif
+
     while (*s) s++;
     return s - str;
 }
@@ -92,6 +92,7 @@ C_ASSERT( sizeof(struct block) == 8 );
 #define BLOCK_FLAG_PREV_FREE   0x00000002
 #define BLOCK_FLAG_FREE_LINK   0x00000003
 #define BLOCK_FLAG_LARGE       0x00000004
+#define BLOCK_FLAG_LFH         0x00000008
 
 
 /* entry to link free blocks in free lists */
@@ -126,6 +127,8 @@ C_ASSERT( sizeof(ARENA_LARGE) == 4 * ALIGNMENT );
 #define ARENA_PENDING_MAGIC    0xbedead
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
+#define ARENA_LFH_MAGIC        0x484c46    /* block index in its group is stored in the high byte */
+#define ARENA_LFH_MAGIC_MASK   0xffffff
 
 #define ARENA_INUSE_FILLER     0x55
 #define ARENA_TAIL_FILLER      0xab
@@ -174,6 +177,52 @@ typedef struct DECLSPEC_ALIGN(ALIGNMENT) tagSUBHEAP
 C_ASSERT( sizeof(SUBHEAP) == offsetof(SUBHEAP, block) + sizeof(struct block) );
 C_ASSERT( sizeof(SUBHEAP) == 4 * ALIGNMENT );
 
+/* Low fragmentation heap front-end: small blocks are grouped by size class
+ * (bins) in groups of LFH_GROUP_BLOCKS blocks, carved from dedicated regions.
+ * Allocating and freeing a block only updates the group free bitmap and
+ * doesn't need the heap lock. Each bin caches a group per thread affinity
+ * slot, so that concurrent threads mostly allocate from different groups. */
+
+#define LFH_SMALL_SIZE      0x200   /* bins up to this size are ALIGNMENT apart */
+#define LFH_LARGE_STEP      0x80    /* and then LFH_LARGE_STEP apart, so that unused size fits in tail_size */
+#define LFH_MAX_BLOCK_SIZE  0x1000  /* larger blocks are always allocated from the heap */
+#define LFH_NB_BINS         (LFH_SMALL_SIZE / ALIGNMENT + (LFH_MAX_BLOCK_SIZE - LFH_SMALL_SIZE) / LFH_LARGE_STEP)
+#define LFH_GROUP_BLOCKS    31      /* the last free_bits bit is used for GROUP_FLAG_DETACHED */
+#define LFH_AFFINITY_SLOTS  16
+#define LFH_ENABLE_COUNT    0x10    /* number of allocations of a size class before it uses the LFH */
+#define LFH_COMMIT_MASK     0xfff   /* bitmask for region commit granularity */
+
+#define GROUP_FLAG_DETACHED 0x80000000  /* group is full, and not referenced from its bin */
+
+C_ASSERT( (1u << LFH_GROUP_BLOCKS) - 1 < GROUP_FLAG_DETACHED );
+
+struct DECLSPEC_ALIGN(ALIGNMENT) group
+{
+    SLIST_ENTRY      entry;      /* entry in bin groups list */
+    struct bin      *bin;        /* bin the group belongs to */
+    LONG             free_bits;  /* bitmap of free blocks */
+};
+
+struct DECLSPEC_ALIGN(ALIGNMENT) lfh_region
+{
+    struct list      entry;      /* entry in heap LFH regions list */
+    SIZE_T           size;       /* size of the reserved region */
+    SIZE_T           commit_size;/* size of the committed region */
+    SIZE_T           block_size; /* size of the groups blocks */
+    SIZE_T           group_size; /* size of the groups, including header */
+    UINT             group_count;/* number of groups carved from the region */
+};
+
+struct bin
+{
+    SLIST_HEADER       groups;       /* groups with free blocks, not owned by any thread */
+    struct group      *affinity_group[LFH_AFFINITY_SLOTS]; /* groups cached for threads */
+    struct lfh_region *region;       /* region new groups are carved from */
+    SIZE_T             block_size;   /* size of the bin blocks */
+    LONG               count_alloc;  /* number of allocations before the bin got enabled */
+    LONG               enabled;      /* whether the bin is used for allocations */
+};
+
 struct heap
 {                                  /* win32/win64 */
     DWORD_PTR        unknown1[2];   /* 0000/0000 */
@@ -195,6 +244,9 @@ struct heap
     DWORD            magic;         /* Magic number */
     DWORD            pending_pos;   /* Position in pending free requests ring */
     struct block   **pending_free;  /* Ring buffer for pending free requests */
+    ULONG            compat_info;   /* HeapCompatibilityInformation value */
+    struct bin      *bins;          /* LFH bins, NULL if LFH is not enabled */
+    struct list      lfh_regions;   /* LFH regions list */
     RTL_CRITICAL_SECTION cs;
     struct entry     free_lists[HEAP_NB_FREE_LISTS];
     SUBHEAP          subheap;
@@ -219,6 +271,10 @@ C_ASSERT( offsetof(struct heap, subheap) <= COMMIT_MASK );
 #define HEAP_VALIDATE_PARAMS  0x40000000
 #define HEAP_CHECKING_ENABLED 0x80000000
 
+/* HeapCompatibilityInformation values */
+#define HEAP_STD 0
+#define HEAP_LFH 2
+
 static struct heap *process_heap;  /* main process heap */
 
 /* check if memory range a contains memory range b */
@@ -265,6 +321,47 @@ static inline void block_set_size( struct block *block, UINT block_flags, UINT b
     block->block_flags = block_flags;
 }
 
+static inline UINT lfh_bin_index( SIZE_T block_size )
+{
+    if (block_size <= LFH_SMALL_SIZE) return (block_size - 1) / ALIGNMENT;
+    return LFH_SMALL_SIZE / ALIGNMENT + (block_size - LFH_SMALL_SIZE - 1) / LFH_LARGE_STEP;
+}
+
+static inline SIZE_T lfh_bin_block_size( UINT index )
+{
+    if (index < LFH_SMALL_SIZE / ALIGNMENT) return (index + 1) * ALIGNMENT;
+    return LFH_SMALL_SIZE + (index + 1 - LFH_SMALL_SIZE / ALIGNMENT) * LFH_LARGE_STEP;
+}
+
+static inline SIZE_T lfh_group_size( SIZE_T block_size )
+{
+    SIZE_T size = sizeof(struct group) + ALIGNMENT - sizeof(struct block) + LFH_GROUP_BLOCKS * block_size;
+    return ROUND_SIZE( size, ALIGNMENT - 1 );
+}
+
+/* group blocks are placed so that their data is aligned */
+static inline struct block *group_get_block( const struct group *group, SIZE_T block_size, UINT index )
+{
+    char *blocks = (char *)(group + 1) + ALIGNMENT - sizeof(struct block);
+    return (struct block *)(blocks + index * block_size);
+}
+
+static inline UINT block_get_group_index( const struct block *block )
+{
+    return block->magic >> 24;
+}
+
+static inline struct group *block_get_group( const struct block *block )
+{
+    char *blocks = (char *)block - block_get_group_index( block ) * block_get_size( block );
+    return (struct group *)(blocks - ALIGNMENT + sizeof(struct block)) - 1;
+}
+
+static inline BOOL is_lfh_block( const struct block *block )
+{
+    return (block_get_flags( block ) & BLOCK_FLAG_LFH) && (block_get_type( block ) & ARENA_LFH_MAGIC_MASK) == ARENA_LFH_MAGIC;
+}
+
 static inline void *subheap_base( const SUBHEAP *subheap )
 {
     return ROUND_ADDR( subheap, COMMIT_MASK );
@@ -904,6 +1001,288 @@ static BOOL validate_large_block( const struct heap *heap, const struct block *b
     return !err;
 }
 
+
+static struct lfh_region *find_lfh_region( const struct heap *heap, const void *ptr )
+{
+    struct lfh_region *region;
+
+    LIST_FOR_EACH_ENTRY( region, &heap->lfh_regions, struct lfh_region, entry )
+        if (contains( region, region->size, ptr, 1 )) return region;
+
+    return NULL;
+}
+
+static BOOL validate_lfh_block( const struct heap *heap, const struct lfh_region *region, const struct block *block )
+{
+    const char *groups = (const char *)(region + 1), *err = NULL;
+    const struct group *group = NULL;
+    UINT index = 0;
+
+    if ((const char *)block >= groups)
+    {
+        group = (const struct group *)(groups + ((const char *)block - groups) / region->group_size * region->group_size);
+        index = ((const char *)block - (const char *)group_get_block( group, region->block_size, 0 )) / region->block_size;
+    }
+
+    if (!group || (const char *)group >= groups + region->group_count * region->group_size)
+        err = "invalid block pointer";
+    else if (index >= LFH_GROUP_BLOCKS || block != group_get_block( group, region->block_size, index ))
+        err = "invalid block alignment";
+    else if (!is_lfh_block( block ) || block_get_group_index( block ) != index)
+        err = "invalid block header";
+    else if (block_get_size( block ) != region->block_size)
+        err = "invalid block size";
+    else if (block->tail_size > block_get_size( block ) - sizeof(*block))
+        err = "invalid block unused size";
+    else if ((ULONG)ReadNoFence( &group->free_bits ) & (1u << index))
+        err = "already freed block";
+
+    if (err)
+    {
+        ERR( "heap %p, block %p: %s\n", heap, block, err );
+        if (TRACE_ON(heap)) heap_dump( heap );
+    }
+
+    return !err;
+}
+
+static BOOL validate_lfh_region( const struct heap *heap, const struct lfh_region *region )
+{
+    const char *groups = (const char *)(region + 1), *err = NULL;
+    const struct block *block;
+    const struct group *group;
+    ULONG free_bits;
+    UINT i, j;
+
+    if (!contains( region, region->commit_size, groups, region->group_count * region->group_size ))
+        err = "invalid region size";
+
+    for (i = 0; !err && i < region->group_count; i++)
+    {
+        group = (const struct group *)(groups + i * region->group_size);
+        free_bits = ReadNoFence( &group->free_bits );
+
+        if (group->bin < heap->bins || group->bin >= heap->bins + LFH_NB_BINS ||
+            group->bin->block_size != region->block_size)
+            err = "invalid group bin";
+        else if (free_bits != GROUP_FLAG_DETACHED && (free_bits & GROUP_FLAG_DETACHED))
+            err = "invalid group free bits";
+
+        for (j = 0; !err && j < LFH_GROUP_BLOCKS; j++)
+        {
+            block = group_get_block( group, region->block_size, j );
+            if (!is_lfh_block( block ) || block_get_group_index( block ) != j)
+                err = "invalid block header";
+            else if (block_get_size( block ) != region->block_size)
+                err = "invalid block size";
+        }
+    }
+
+    if (err)
+    {
+        ERR( "heap %p, region %p: %s\n", heap, region, err );
+        if (TRACE_ON(heap)) heap_dump( heap );
+    }
+
+    return !err;
+}
+
+static struct lfh_region *create_lfh_region( struct heap *heap, struct bin *bin )
+{
+    SIZE_T group_size = lfh_group_size( bin->block_size );
+    SIZE_T size = ROUND_SIZE( sizeof(struct lfh_region) + group_size, COMMIT_MASK );
+    SIZE_T commit_size = LFH_COMMIT_MASK + 1;
+    struct lfh_region *region;
+    void *addr = NULL;
+
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_RESERVE, get_protection_type( heap->flags ) ))
+    {
+        WARN( "Could not allocate %#Ix bytes for heap %p LFH region\n", size, heap );
+        return NULL;
+    }
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &commit_size, MEM_COMMIT, get_protection_type( heap->flags ) ))
+    {
+        WARN( "Could not commit %#Ix bytes for heap %p LFH region\n", commit_size, heap );
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+        return NULL;
+    }
+
+    region = addr;
+    region->size = size;
+    region->commit_size = commit_size;
+    region->block_size = bin->block_size;
+    region->group_size = group_size;
+    region->group_count = 0;
+    list_add_tail( &heap->lfh_regions, &region->entry );
+
+    return region;
+}
+
+/* carve a new group from the bin region, called with the heap lock held */
+static struct group *create_lfh_group( struct heap *heap, struct bin *bin )
+{
+    struct lfh_region *region = bin->region;
+    char *group_end, *commit_end;
+    struct group *group;
+    struct block *block;
+    SIZE_T size;
+    void *addr;
+    UINT i;
+
+    if (!region || sizeof(*region) + (region->group_count + 1) * region->group_size > region->size)
+    {
+        if (!(region = create_lfh_region( heap, bin ))) return NULL;
+        bin->region = region;
+    }
+
+    group = (struct group *)((char *)(region + 1) + region->group_count * region->group_size);
+    group_end = (char *)group + region->group_size;
+    commit_end = ROUND_ADDR( group_end + LFH_COMMIT_MASK, LFH_COMMIT_MASK );
+
+    if (commit_end > (char *)region + region->commit_size)
+    {
+        addr = (char *)region + region->commit_size;
+        size = commit_end - (char *)addr;
+        if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_COMMIT, get_protection_type( heap->flags ) ))
+        {
+            WARN( "Could not commit %#Ix bytes at %p for heap %p\n", size, addr, heap );
+            return NULL;
+        }
+        region->commit_size = commit_end - (char *)region;
+    }
+
+    group->bin = bin;
+    group->free_bits = (1u << LFH_GROUP_BLOCKS) - 1;
+    for (i = 0; i < LFH_GROUP_BLOCKS; i++)
+    {
+        block = group_get_block( group, bin->block_size, i );
+        block_set_size( block, BLOCK_FLAG_LFH, bin->block_size );
+        block_set_type( block, ARENA_LFH_MAGIC | (i << 24) );
+        block->tail_size = 0;
+    }
+    region->group_count++;
+
+    return group;
+}
+
+static inline ULONG heap_current_affinity(void)
+{
+    static LONG next_affinity;
+    ULONG affinity;
+
+    if (!(affinity = NtCurrentTeb()->HeapVirtualAffinity))
+        affinity = NtCurrentTeb()->HeapVirtualAffinity = InterlockedIncrement( &next_affinity );
+    return affinity % LFH_AFFINITY_SLOTS;
+}
+
+static struct block *lfh_allocate_block( struct heap *heap, struct bin *bin )
+{
+    ULONG affinity = heap_current_affinity(), free_bits, new_bits;
+    struct group *group, *cached;
+    SLIST_ENTRY *entry;
+    DWORD index;
+
+    /* take ownership of a group, only the owner may clear its free bits */
+    if (!(group = InterlockedExchangePointer( (void **)&bin->affinity_group[affinity], NULL )))
+    {
+        if ((entry = RtlInterlockedPopEntrySList( &bin->groups )))
+            group = CONTAINING_RECORD( entry, struct group, entry );
+        else
+        {
+            heap_lock( heap, 0 );
+            group = create_lfh_group( heap, bin );
+            heap_unlock( heap, 0 );
+            if (!group) return NULL;
+        }
+    }
+
+    /* owned groups always have some free blocks, concurrent frees only set more bits */
+    do
+    {
+        free_bits = ReadNoFence( &group->free_bits );
+        BitScanForward( &index, free_bits );
+        new_bits = free_bits & ~(1u << index);
+    } while (InterlockedCompareExchange( &group->free_bits, new_bits, free_bits ) != free_bits);
+
+    /* detach full groups, heap_free_lfh puts them back in the bin list when a block is freed */
+    if (!new_bits && !InterlockedCompareExchange( &group->free_bits, GROUP_FLAG_DETACHED, 0 ))
+        return group_get_block( group, bin->block_size, index );
+
+    if ((cached = InterlockedExchangePointer( (void **)&bin->affinity_group[affinity], group )))
+        RtlInterlockedPushEntrySList( &bin->groups, &cached->entry );
+    return group_get_block( group, bin->block_size, index );
+}
+
+/* quick LFH block check, without looking up the heap regions */
+static struct group *unsafe_group_from_block( const struct heap *heap, const struct block *block )
+{
+    UINT index = block_get_group_index( block );
+    const char *err = NULL;
+    struct group *group;
+
+    if ((ULONG_PTR)(block + 1) % ALIGNMENT)
+        err = "invalid ptr alignment";
+    else if (index >= LFH_GROUP_BLOCKS)
+        err = "invalid block header";
+    else if ((group = block_get_group( block ))->bin < heap->bins || group->bin >= heap->bins + LFH_NB_BINS ||
+             group->bin->block_size != block_get_size( block ))
+        err = "invalid block group";
+    else if ((ULONG)ReadNoFence( &group->free_bits ) & (1u << index))
+        err = "already freed block";
+
+    if (err) WARN( "heap %p, block %p: %s\n", heap, block, err );
+    return err ? NULL : group;
+}
+
+static NTSTATUS heap_free_lfh( struct heap *heap, struct block *block )
+{
+    UINT index = block_get_group_index( block );
+    ULONG free_bits, new_bits;
+    struct group *group;
+
+    if (!(group = unsafe_group_from_block( heap, block ))) return STATUS_INVALID_PARAMETER;
+
+    do
+    {
+        free_bits = ReadNoFence( &group->free_bits );
+        if (free_bits & (1u << index))
+        {
+            WARN( "heap %p, block %p: already freed block\n", heap, block );
+            return STATUS_INVALID_PARAMETER;
+        }
+        new_bits = (free_bits | (1u << index)) & ~GROUP_FLAG_DETACHED;
+    } while (InterlockedCompareExchange( &group->free_bits, new_bits, free_bits ) != free_bits);
+
+    /* we cleared the detached flag, the group is ours to put back in the bin list */
+    if (free_bits & GROUP_FLAG_DETACHED) RtlInterlockedPushEntrySList( &group->bin->groups, &group->entry );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS heap_enable_lfh( struct heap *heap )
+{
+    SIZE_T size = LFH_NB_BINS * sizeof(struct bin);
+    struct bin *bins = NULL;
+    UINT i;
+
+    if (heap->bins) return STATUS_SUCCESS;
+    if (heap->shared || (heap->flags & HEAP_NO_SERIALIZE) || !(heap->flags & HEAP_GROWABLE))
+        return STATUS_INVALID_PARAMETER;
+
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&bins, 0, &size, MEM_COMMIT, PAGE_READWRITE ))
+        return STATUS_NO_MEMORY;
+
+    for (i = 0; i < LFH_NB_BINS; i++)
+    {
+        RtlInitializeSListHead( &bins[i].groups );
+        bins[i].block_size = lfh_bin_block_size( i );
+    }
+
+    /* lock-free allocations may see the bins as soon as they are published */
+    InterlockedExchangePointer( (void **)&heap->bins, bins );
+    return STATUS_SUCCESS;
+}
+
 /***********************************************************************
  *           HEAP_CreateSubHeap
  */
@@ -959,8 +1338,11 @@ static SUBHEAP *HEAP_CreateSubHeap( struct heap **heap_ptr, LPVOID address, DWOR
         heap->magic         = HEAP_MAGIC;
         heap->grow_size     = max( HEAP_DEF_SIZE, totalSize );
         heap->min_size      = commitSize;
+        heap->compat_info   = HEAP_STD;
+        heap->bins          = NULL;
         list_init( &heap->subheap_list );
         list_init( &heap->large_list );
+        list_init( &heap->lfh_regions );
 
         subheap = &heap->subheap;
         subheap_set_bounds( subheap, (char *)address + commitSize, (char *)address + totalSize );
@@ -1195,8 +1577,11 @@ static BOOL heap_validate_ptr( const struct heap *heap, const void *ptr, SUBHEAP
 {
     const struct block *block = (struct block *)ptr - 1;
 
+    const struct lfh_region *region;
+
     if (!(*subheap = find_subheap( heap, block, FALSE )))
     {
+        if ((region = find_lfh_region( heap, block ))) return validate_lfh_block( heap, region, block );
         if (!find_large_block( heap, block ))
         {
             if (WARN_ON(heap)) WARN("heap %p, ptr %p: block region not found\n", heap, ptr );
@@ -1211,6 +1596,7 @@ static BOOL heap_validate_ptr( const struct heap *heap, const void *ptr, SUBHEAP
 
 static BOOL heap_validate( const struct heap *heap )
 {
+    const struct lfh_region *region;
     const ARENA_LARGE *large_arena;
     const struct block *block;
     const SUBHEAP *subheap;
@@ -1237,6 +1623,9 @@ static BOOL heap_validate( const struct heap *heap )
         }
     }
 
+    LIST_FOR_EACH_ENTRY( region, &heap->lfh_regions, struct lfh_region, entry )
+        if (!validate_lfh_region( heap, region )) return FALSE;
+
     LIST_FOR_EACH_ENTRY( large_arena, &heap->large_list, ARENA_LARGE, entry )
         if (!validate_large_block( heap, &large_arena->block )) return FALSE;
 
@@ -1254,6 +1643,12 @@ static inline struct block *unsafe_block_from_ptr( const struct heap *heap, cons
         return block;
     }
 
+    if (heap->bins && is_lfh_block( block ))
+    {
+        *subheap = NULL;
+        return unsafe_group_from_block( heap, block ) ? block : NULL;
+    }
+
     if ((*subheap = find_subheap( heap, block, FALSE )))
     {
         base = subheap_base( *subheap );
@@ -1425,6 +1820,7 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, PVOID addr, SIZE_T totalSize, SIZE_T c
  */
 HANDLE WINAPI RtlDestroyHeap( HANDLE handle )
 {
+    struct lfh_region *region, *region_next;
     SUBHEAP *subheap, *next;
     ARENA_LARGE *arena, *arena_next;
     struct block **pending, **tmp;
@@ -1469,6 +1865,18 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE handle )
         addr = arena;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    LIST_FOR_EACH_ENTRY_SAFE( region, region_next, &heap->lfh_regions, struct lfh_region, entry )
+    {
+        list_remove( &region->entry );
+        size = 0;
+        addr = region;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
+    if ((addr = heap->bins))
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     LIST_FOR_EACH_ENTRY_SAFE( subheap, next, &heap->subheap_list, SUBHEAP, entry )
     {
         if (subheap == &heap->subheap) continue;  /* do this one last */
@@ -1501,6 +1909,35 @@ static SIZE_T heap_get_block_size( const struct heap *heap, ULONG flags, SIZE_T
     return ROUND_SIZE( size + overhead, ALIGNMENT - 1 );
 }
 
+static NTSTATUS heap_allocate_lfh( struct heap *heap, ULONG flags, SIZE_T size, void **ret )
+{
+    static const ULONG lfh_disable_flags = HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED | HEAP_CHECKING_ENABLED |
+                                           HEAP_VALIDATE | HEAP_VALIDATE_ALL | HEAP_VALIDATE_PARAMS | HEAP_ADD_USER_INFO;
+    struct bin *bins = heap->bins, *bin;
+    SIZE_T block_size;
+    struct block *block;
+
+    if (!bins || (flags & lfh_disable_flags) || RUNNING_ON_VALGRIND) return STATUS_UNSUCCESSFUL;
+
+    block_size = heap_get_block_size( heap, flags, size );
+    if (block_size < size || block_size > LFH_MAX_BLOCK_SIZE) return STATUS_UNSUCCESSFUL;
+    bin = bins + lfh_bin_index( block_size );
+
+    /* only use the LFH for sizes which are frequently allocated */
+    if (!ReadNoFence( &bin->enabled ))
+    {
+        if (InterlockedIncrement( &bin->count_alloc ) > LFH_ENABLE_COUNT) WriteNoFence( &bin->enabled, TRUE );
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    if (!(block = lfh_allocate_block( heap, bin ))) return STATUS_UNSUCCESSFUL;
+    block->tail_size = bin->block_size - sizeof(*block) - size;
+    initialize_block( block + 1, size, flags );
+
+    *ret = block + 1;
+    return STATUS_SUCCESS;
+}
+
 static NTSTATUS heap_allocate( struct heap *heap, ULONG flags, SIZE_T size, void **ret )
 {
     SIZE_T old_block_size, block_size;
@@ -1545,7 +1982,7 @@ void *WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE handle, ULONG flags, SIZE
 
     if (!(heap = unsafe_heap_from_handle( handle )))
         status = STATUS_INVALID_HANDLE;
-    else
+    else if ((status = heap_allocate_lfh( heap, heap_get_flags( heap, flags ), size, &ptr )))
     {
         heap_lock( heap, flags );
         status = heap_allocate( heap, heap_get_flags( heap, flags ), size, &ptr );
@@ -1566,6 +2003,7 @@ static NTSTATUS heap_free( struct heap *heap, void *ptr )
     SUBHEAP *subheap;
 
     if (!(block = unsafe_block_from_ptr( heap, ptr, &subheap ))) return STATUS_INVALID_PARAMETER;
+    if (block_get_flags( block ) & BLOCK_FLAG_LFH) return heap_free_lfh( heap, block );
     if (!subheap) free_large_block( heap, block );
     else free_used_block( heap, subheap, block );
 
@@ -1586,6 +2024,8 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE handle, ULONG flags, void *
 
     if (!(heap = unsafe_heap_from_handle( handle )))
         status = STATUS_INVALID_PARAMETER;
+    else if (heap->bins && !(heap->flags & HEAP_VALIDATE) && is_lfh_block( (struct block *)ptr - 1 ))
+        status = heap_free_lfh( heap, (struct block *)ptr - 1 );  /* LFH blocks are freed without the heap lock */
     else
     {
         heap_lock( heap, flags );
@@ -1599,6 +2039,35 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE handle, ULONG flags, void *
 }
 
 
+static NTSTATUS realloc_lfh_block( struct heap *heap, ULONG flags, struct block *block, SIZE_T size, void **ret )
+{
+    SIZE_T old_block_size = block_get_size( block ), old_size = old_block_size - block_get_overhead( block );
+    SIZE_T block_size = heap_get_block_size( heap, flags, size );
+    NTSTATUS status;
+
+    /* keep the block if the new size belongs to the same size class */
+    if (block_size >= size && block_size <= LFH_MAX_BLOCK_SIZE &&
+        lfh_bin_block_size( lfh_bin_index( block_size ) ) == old_block_size)
+    {
+        valgrind_notify_resize( block + 1, old_size, size );
+        block->tail_size = old_block_size - sizeof(*block) - size;
+        if (size > old_size) initialize_block( (char *)(block + 1) + old_size, size - old_size, flags );
+        *ret = block + 1;
+        return STATUS_SUCCESS;
+    }
+
+    if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return STATUS_NO_MEMORY;
+    if (heap_allocate_lfh( heap, flags & ~HEAP_ZERO_MEMORY, size, ret ) &&
+        (status = heap_allocate( heap, flags & ~HEAP_ZERO_MEMORY, size, ret )))
+        return status;
+
+    valgrind_notify_alloc( *ret, size, 0 );
+    memcpy( *ret, block + 1, min( old_size, size ) );
+    if ((flags & HEAP_ZERO_MEMORY) && size > old_size) memset( (char *)*ret + old_size, 0, size - old_size );
+    valgrind_notify_free( block + 1 );
+    return heap_free_lfh( heap, block );
+}
+
 static NTSTATUS heap_reallocate( struct heap *heap, ULONG flags, void *ptr, SIZE_T size, void **ret )
 {
     SIZE_T old_block_size, old_size, block_size;
@@ -1611,6 +2080,7 @@ static NTSTATUS heap_reallocate( struct heap *heap, ULONG flags, void *ptr, SIZE
     if (block_size < HEAP_MIN_BLOCK_SIZE) block_size = HEAP_MIN_BLOCK_SIZE;
 
     if (!(block = unsafe_block_from_ptr( heap, ptr, &subheap ))) return STATUS_INVALID_PARAMETER;
+    if (block_get_flags( block ) & BLOCK_FLAG_LFH) return realloc_lfh_block( heap, flags, block, size, ret );
     if (!subheap)
     {
         if (!(block = realloc_large_block( heap, flags, block, size ))) return STATUS_NO_MEMORY;
@@ -1754,7 +2224,7 @@ static NTSTATUS heap_size( const struct heap *heap, const void *ptr, SIZE_T *siz
     SUBHEAP *subheap;
 
     if (!(block = unsafe_block_from_ptr( heap, ptr, &subheap ))) return STATUS_INVALID_PARAMETER;
-    if (!subheap)
+    if (!subheap && !(block_get_flags( block ) & BLOCK_FLAG_LFH))
     {
         const ARENA_LARGE *large_arena = CONTAINING_RECORD( block, ARENA_LARGE, block );
         *size = large_arena->data_size;
@@ -1853,8 +2323,65 @@ static NTSTATUS heap_walk_blocks( const struct heap *heap, const SUBHEAP *subhea
     return STATUS_SUCCESS;
 }
 
+static NTSTATUS heap_walk_lfh( const struct heap *heap, const struct lfh_region *region, struct rtl_heap_entry *entry )
+{
+    const char *base = (const char *)region, *groups = (const char *)(region + 1), *data = entry->lpData;
+    const char *commit_end = base + region->commit_size, *end = base + region->size;
+    const struct group *group;
+    const struct block *block;
+    UINT group_index = 0, index = 0;
+
+    if (data == commit_end) return STATUS_NO_MORE_ENTRIES;
+    if (data != base)
+    {
+        if (data < groups) return STATUS_INVALID_PARAMETER;
+        group_index = (data - groups) / region->group_size;
+        group = (const struct group *)(groups + group_index * region->group_size);
+        index = (data - (const char *)group_get_block( group, region->block_size, 0 )) / region->block_size + 1;
+        if (index >= LFH_GROUP_BLOCKS)
+        {
+            group_index++;
+            index = 0;
+        }
+    }
+
+    if (group_index >= region->group_count)
+    {
+        if (commit_end == end) return STATUS_NO_MORE_ENTRIES;
+        entry->lpData = (void *)commit_end;
+        entry->cbData = end - commit_end;
+        entry->cbOverhead = 0;
+        entry->iRegionIndex = 0;
+        entry->wFlags = RTL_HEAP_ENTRY_UNCOMMITTED;
+        return STATUS_SUCCESS;
+    }
+
+    group = (const struct group *)(groups + group_index * region->group_size);
+    block = group_get_block( group, region->block_size, index );
+
+    if ((ULONG)ReadNoFence( &group->free_bits ) & (1u << index))
+    {
+        entry->lpData = (char *)block + ALIGNMENT;
+        entry->cbData = region->block_size - ALIGNMENT;
+        entry->cbOverhead = ALIGNMENT;
+        entry->iRegionIndex = 0;
+        entry->wFlags = RTL_HEAP_ENTRY_LFH;
+    }
+    else
+    {
+        entry->lpData = (void *)(block + 1);
+        entry->cbData = block_get_size( block ) - block_get_overhead( block );
+        entry->cbOverhead = block_get_overhead( block );
+        entry->iRegionIndex = 0;
+        entry->wFlags = RTL_HEAP_ENTRY_LFH|RTL_HEAP_ENTRY_BUSY;
+    }
+
+    return STATUS_SUCCESS;
+}
+
 static NTSTATUS heap_walk( const struct heap *heap, struct rtl_heap_entry *entry )
 {
+    const struct lfh_region *region = NULL;
     const char *data = entry->lpData;
     const ARENA_LARGE *large = NULL;
     const struct block *block;
@@ -1872,6 +2399,12 @@ static NTSTATUS heap_walk( const struct heap *heap, struct rtl_heap_entry *entry
         large = CONTAINING_RECORD( block, ARENA_LARGE, block );
         next = &large->entry;
     }
+    else if (data && (region = find_lfh_region( heap, data )))
+    {
+        if (!(status = heap_walk_lfh( heap, region, entry ))) return STATUS_SUCCESS;
+        else if (status != STATUS_NO_MORE_ENTRIES) return status;
+        next = &region->entry;
+    }
     else if ((subheap = find_subheap( heap, block, TRUE )))
     {
         if (!(status = heap_walk_blocks( heap, subheap, block, entry ))) return STATUS_SUCCESS;
@@ -1884,7 +2417,7 @@ static NTSTATUS heap_walk( const struct heap *heap, struct rtl_heap_entry *entry
         next = &heap->subheap_list;
     }
 
-    if (!large && (next = list_next( &heap->subheap_list, next )))
+    if (!large && !region && (next = list_next( &heap->subheap_list, next )))
     {
         subheap = LIST_ENTRY( next, SUBHEAP, entry );
         base = subheap_base( subheap );
@@ -1900,6 +2433,23 @@ static NTSTATUS heap_walk( const struct heap *heap, struct rtl_heap_entry *entry
         return STATUS_SUCCESS;
     }
 
+    if (!large && !next) next = &heap->lfh_regions;
+    if (!large && (next = list_next( &heap->lfh_regions, next )))
+    {
+        region = LIST_ENTRY( next, struct lfh_region, entry );
+        base = (char *)region;
+        entry->lpData = base;
+        entry->cbData = sizeof(*region);
+        entry->cbOverhead = 0;
+        entry->iRegionIndex = 0;
+        entry->wFlags = RTL_HEAP_ENTRY_LFH|RTL_HEAP_ENTRY_REGION;
+        entry->Region.dwCommittedSize = region->commit_size;
+        entry->Region.dwUnCommittedSize = region->size - region->commit_size;
+        entry->Region.lpFirstBlock = base + entry->cbData;
+        entry->Region.lpLastBlock = base + region->size;
+        return STATUS_SUCCESS;
+    }
+
     if (!next) next = &heap->large_list;
     if ((next = list_next( &heap->large_list, next )))
     {
@@ -1977,15 +2527,18 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS info_class,
                                          void *info, SIZE_T size_in, PSIZE_T size_out )
 {
+    struct heap *heap;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
+        if (!(heap = unsafe_heap_from_handle( handle ))) return STATUS_ACCESS_VIOLATION;
         if (size_out) *size_out = sizeof(ULONG);
 
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        *(ULONG *)info = heap->compat_info;
         return STATUS_SUCCESS;
 
     default:
@@ -1999,8 +2552,36 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS i
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS info_class, void *info, SIZE_T size )
 {
-    FIXME( "handle %p, info_class %d, info %p, size %ld stub!\n", handle, info_class, info, size );
-    return STATUS_SUCCESS;
+    struct heap *heap;
+    ULONG compat_info;
+    NTSTATUS status;
+
+    TRACE( "handle %p, info_class %d, info %p, size %ld.\n", handle, info_class, info, size );
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heap = unsafe_heap_from_handle( handle ))) return STATUS_INVALID_HANDLE;
+
+        compat_info = *(ULONG *)info;
+        if (compat_info != HEAP_STD && compat_info != HEAP_LFH)
+        {
+            FIXME( "HeapCompatibilityInformation %u not implemented!\n", compat_info );
+            return STATUS_UNSUCCESSFUL;
+        }
+
+        heap_lock( heap, 0 );
+        if (heap->compat_info == compat_info) status = STATUS_SUCCESS;
+        else if (heap->compat_info != HEAP_STD) status = STATUS_UNSUCCESSFUL;  /* LFH cannot be disabled */
+        else if (!(status = heap_enable_lfh( heap ))) heap->compat_info = compat_info;
+        heap_unlock( heap, 0 );
+        return status;
+
+    default:
+        FIXME( "handle %p, info_class %d, info %p, size %ld stub!\n", handle, info_class, info, size );
+        return STATUS_SUCCESS;
+    }
 }
 
 /***********************************************************************
@@ -2022,7 +2603,9 @@ BOOLEAN WINAPI RtlGetUserInfoHeap( HANDLE handle, ULONG flags, void *ptr, void *
     if (!(heap = unsafe_heap_from_handle( handle ))) return TRUE;
 
     heap_lock( heap, flags );
-    if ((block = unsafe_block_from_ptr( heap, ptr, &subheap )) && !subheap)
+    if ((block = unsafe_block_from_ptr( heap, ptr, &subheap )) && (block_get_flags( block ) & BLOCK_FLAG_LFH))
+        ; /* LFH blocks are never allocated with HEAP_ADD_USER_INFO */
+    else if (block && !subheap)
     {
         const ARENA_LARGE *large = CONTAINING_RECORD( block, ARENA_LARGE, block );
         *user_value = large->user_value;
@@ -2055,6 +2638,7 @@ BOOLEAN WINAPI RtlSetUserValueHeap( HANDLE handle, ULONG flags, void *ptr, void
 
     heap_lock( heap, flags );
     if (!(block = unsafe_block_from_ptr( heap, ptr, &subheap ))) ret = FALSE;
+    else if (block_get_flags( block ) & BLOCK_FLAG_LFH) ret = FALSE;
     else if (!subheap)
     {
         ARENA_LARGE *large = CONTAINING_RECORD( block, ARENA_LARGE, block );
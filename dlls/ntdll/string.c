@@ -350,7 +350,19 @@ size_t __cdecl strcspn( const char *str, const char *reject )
 size_t __cdecl strlen( const char *str )
 {
     const char *s = str;
+
+#ifdef __x86_64__
+    /* Scan aligned 16-byte blocks, which never cross a page boundary. */
+    typedef char vec __attribute__((vector_size(16), __may_alias__));
+    const vec *p = (const vec *)((ULONG_PTR)str & ~15), zero = {0};
+    unsigned int mask;
+
+    mask = __builtin_ia32_pmovmskb128( (vec)(*p == zero) ) & (~0u << ((ULONG_PTR)str & 15));
+    while (!mask) mask = __builtin_ia32_pmovmskb128( (vec)(*++p == zero) );
+    s = (const char *)p + __builtin_ctz( mask );
+#else
     while (*s) s++;
+#endif
     return s - str;
 }
 
@@ -2270,6 +2270,148 @@ static void test_NtRenameKey(void)
     pNtClose(key);
 }
 
+static void test_large_key(void)
+{
+    static const unsigned int count = 500;
+    KEY_BASIC_INFORMATION *info;
+    KEY_FULL_INFORMATION full_info;
+    UNICODE_STRING str;
+    OBJECT_ATTRIBUTES attr;
+    HANDLE key, parent, subkey;
+    WCHAR name[32], prev[32];
+    char buffer[200];
+    NTSTATUS status;
+    DWORD size, data;
+    unsigned int i, j;
+
+    InitializeObjectAttributes(&attr, &winetestpath, 0, 0, 0);
+    status = pNtCreateKey(&parent, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0);
+    ok(!status, "Unexpected status %#lx.\n", status);
+
+    pRtlInitUnicodeString(&str, L"large_key");
+    InitializeObjectAttributes(&attr, &str, OBJ_CASE_INSENSITIVE, parent, NULL);
+    status = pNtCreateKey(&key, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0);
+    ok(!status, "Unexpected status %#lx.\n", status);
+
+    /* create the subkeys and values in a scrambled order */
+    for (i = 0; i < count; i++)
+    {
+        j = (i * 7919) % count;
+        swprintf(name, ARRAY_SIZE(name), L"subkey%04u", j);
+        pRtlInitUnicodeString(&str, name);
+        InitializeObjectAttributes(&attr, &str, OBJ_CASE_INSENSITIVE, key, NULL);
+        status = pNtCreateKey(&subkey, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0);
+        ok(!status, "Unexpected status %#lx.\n", status);
+        pNtClose(subkey);
+
+        swprintf(name, ARRAY_SIZE(name), L"value%04u", j);
+        pRtlInitUnicodeString(&str, name);
+        status = pNtSetValueKey(key, &str, 0, REG_DWORD, &j, sizeof(j));
+        ok(!status, "Unexpected status %#lx.\n", status);
+    }
+
+    status = pNtQueryKey(key, KeyFullInformation, &full_info, sizeof(full_info), &size);
+    ok(!status, "Unexpected status %#lx.\n", status);
+    ok(full_info.SubKeys == count, "got %lu subkeys\n", full_info.SubKeys);
+    ok(full_info.Values == count, "got %lu values\n", full_info.Values);
+
+    /* subkeys are enumerated in alphabetical order */
+    info = (KEY_BASIC_INFORMATION *)buffer;
+    for (i = 0; i < count; i++)
+    {
+        status = pNtEnumerateKey(key, i, KeyBasicInformation, buffer, sizeof(buffer), &size);
+        ok(!status, "Unexpected status %#lx.\n", status);
+        if (status) break;
+        swprintf(name, ARRAY_SIZE(name), L"subkey%04u", i);
+        ok(info->NameLength == wcslen(name) * sizeof(WCHAR) && !memcmp(info->Name, name, info->NameLength),
+           "%u: got %s\n", i, wine_dbgstr_wn(info->Name, info->NameLength / sizeof(WCHAR)));
+    }
+    status = pNtEnumerateKey(key, count, KeyBasicInformation, buffer, sizeof(buffer), &size);
+    ok(status == STATUS_NO_MORE_ENTRIES, "Unexpected status %#lx.\n", status);
+
+    /* lookups are case insensitive */
+    for (i = 0; i < count; i += 7)
+    {
+        swprintf(name, ARRAY_SIZE(name), L"SUBKEY%04u", i);
+        pRtlInitUnicodeString(&str, name);
+        InitializeObjectAttributes(&attr, &str, OBJ_CASE_INSENSITIVE, key, NULL);
+        status = pNtOpenKey(&subkey, KEY_ALL_ACCESS, &attr);
+        ok(!status, "Unexpected status %#lx.\n", status);
+
+        /* delete every other of them */
+        if (i % 2)
+        {
+            status = pNtDeleteKey(subkey);
+            ok(!status, "Unexpected status %#lx.\n", status);
+        }
+        pNtClose(subkey);
+
+        swprintf(name, ARRAY_SIZE(name), L"VALUE%04u", i);
+        pRtlInitUnicodeString(&str, name);
+        status = pNtQueryValueKey(key, &str, KeyValuePartialInformation, buffer, sizeof(buffer), &size);
+        ok(!status, "Unexpected status %#lx.\n", status);
+        memcpy(&data, ((KEY_VALUE_PARTIAL_INFORMATION *)buffer)->Data, sizeof(data));
+        ok(data == i, "got %lu\n", data);
+        if (i % 2)
+        {
+            status = pNtDeleteValueKey(key, &str);
+            ok(!status, "Unexpected status %#lx.\n", status);
+        }
+    }
+
+    /* add new subkeys after the deletions */
+    for (i = count; i < count + 50; i++)
+    {
+        swprintf(name, ARRAY_SIZE(name), L"subkey%04u", 2 * count + count - i);
+        pRtlInitUnicodeString(&str, name);
+        InitializeObjectAttributes(&attr, &str, OBJ_CASE_INSENSITIVE, key, NULL);
+        status = pNtCreateKey(&subkey, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0);
+        ok(!status, "Unexpected status %#lx.\n", status);
+        pNtClose(subkey);
+    }
+
+    prev[0] = 0;
+    for (i = 0; ; i++)
+    {
+        status = pNtEnumerateKey(key, i, KeyBasicInformation, buffer, sizeof(buffer), &size);
+        if (status) break;
+        memcpy(name, info->Name, info->NameLength);
+        name[info->NameLength / sizeof(WCHAR)] = 0;
+        ok(wcscmp(prev, name) < 0, "%u: got %s after %s\n", i, wine_dbgstr_w(name), wine_dbgstr_w(prev));
+        wcscpy(prev, name);
+    }
+    ok(status == STATUS_NO_MORE_ENTRIES, "Unexpected status %#lx.\n", status);
+    ok(i == count + 50 - 36, "got %u subkeys\n", i);
+
+    for (i = 0; ; i++)
+    {
+        status = pNtEnumerateValueKey(key, i, KeyValueBasicInformation, buffer, sizeof(buffer), &size);
+        if (status) break;
+    }
+    ok(status == STATUS_NO_MORE_ENTRIES, "Unexpected status %#lx.\n", status);
+    ok(i == count - 36, "got %u values\n", i);
+
+    for (i = 0; ; i++)
+    {
+        status = pNtEnumerateKey(key, 0, KeyBasicInformation, buffer, sizeof(buffer), &size);
+        if (status) break;
+        memcpy(name, info->Name, info->NameLength);
+        name[info->NameLength / sizeof(WCHAR)] = 0;
+        pRtlInitUnicodeString(&str, name);
+        InitializeObjectAttributes(&attr, &str, OBJ_CASE_INSENSITIVE, key, NULL);
+        status = pNtOpenKey(&subkey, DELETE, &attr);
+        ok(!status, "Unexpected status %#lx.\n", status);
+        pNtDeleteKey(subkey);
+        pNtClose(subkey);
+    }
+    ok(status == STATUS_NO_MORE_ENTRIES, "Unexpected status %#lx.\n", status);
+
+    pNtDeleteKey(key);
+    pNtClose(key);
+    pNtDeleteKey(parent);
+    pNtClose(parent);
+}
+
 static BOOL set_privileges(LPCSTR privilege, BOOL set)
 {
     TOKEN_PRIVILEGES tp;
@@ -2402,6 +2544,7 @@ START_TEST(reg)
     test_symlinks();
     test_redirection();
     test_NtRenameKey();
+    test_large_key();
     test_NtRegLoadKeyEx();
 
     pRtlFreeUnicodeString(&winetestpath);
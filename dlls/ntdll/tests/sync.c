@@ -147,6 +147,76 @@ static void test_event(void)
     pNtClose(event);
 }
 
+static void test_event_wait(void)
+{
+    LARGE_INTEGER zero = {{0}};
+    HANDLE events[2], swapped[2], dup;
+    NTSTATUS status;
+
+    status = pNtCreateEvent( &events[0], GENERIC_ALL, NULL, NotificationEvent, TRUE );
+    ok( status == STATUS_SUCCESS, "NtCreateEvent failed %08lx\n", status );
+    status = pNtCreateEvent( &events[1], GENERIC_ALL, NULL, NotificationEvent, FALSE );
+    ok( status == STATUS_SUCCESS, "NtCreateEvent failed %08lx\n", status );
+    swapped[0] = events[1];
+    swapped[1] = events[0];
+
+    status = NtWaitForSingleObject( events[0], FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForSingleObject( events[1], FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+    status = NtWaitForMultipleObjects( 2, events, TRUE, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForMultipleObjects( 2, swapped, TRUE, FALSE, &zero );
+    ok( status == STATUS_WAIT_0 + 1, "got %08lx\n", status );
+    status = NtWaitForMultipleObjects( 2, events, FALSE, FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+
+    status = pNtSetEvent( events[1], NULL );
+    ok( status == STATUS_SUCCESS, "NtSetEvent failed %08lx\n", status );
+    status = NtWaitForMultipleObjects( 2, events, FALSE, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForMultipleObjects( 2, swapped, TRUE, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+
+    /* a pulse leaves the event non-signaled */
+    status = pNtPulseEvent( events[1], NULL );
+    ok( status == STATUS_SUCCESS, "NtPulseEvent failed %08lx\n", status );
+    status = NtWaitForSingleObject( events[1], FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+
+    /* state changes through another handle are visible */
+    status = NtDuplicateObject( GetCurrentProcess(), events[0], GetCurrentProcess(), &dup,
+                                0, 0, DUPLICATE_SAME_ACCESS );
+    ok( status == STATUS_SUCCESS, "NtDuplicateObject failed %08lx\n", status );
+    status = pNtResetEvent( dup, NULL );
+    ok( status == STATUS_SUCCESS, "NtResetEvent failed %08lx\n", status );
+    status = NtWaitForSingleObject( events[0], FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+    pNtClose( dup );
+
+    /* waiting requires SYNCHRONIZE access */
+    status = pNtSetEvent( events[0], NULL );
+    ok( status == STATUS_SUCCESS, "NtSetEvent failed %08lx\n", status );
+    status = NtDuplicateObject( GetCurrentProcess(), events[0], GetCurrentProcess(), &dup,
+                                EVENT_QUERY_STATE, 0, 0 );
+    ok( status == STATUS_SUCCESS, "NtDuplicateObject failed %08lx\n", status );
+    status = NtWaitForSingleObject( dup, FALSE, &zero );
+    ok( status == STATUS_ACCESS_DENIED, "got %08lx\n", status );
+    status = NtWaitForSingleObject( dup, FALSE, &zero );
+    ok( status == STATUS_ACCESS_DENIED, "got %08lx\n", status );
+    pNtClose( dup );
+
+    /* a reused handle value refers to the new object */
+    pNtClose( events[0] );
+    status = pNtCreateEvent( &events[0], GENERIC_ALL, NULL, NotificationEvent, FALSE );
+    ok( status == STATUS_SUCCESS, "NtCreateEvent failed %08lx\n", status );
+    status = NtWaitForSingleObject( events[0], FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+
+    pNtClose( events[0] );
+    pNtClose( events[1] );
+}
+
 static const WCHAR keyed_nameW[] = L"\\BaseNamedObjects\\WineTestEvent";
 
 static DWORD WINAPI keyed_event_thread( void *arg )
@@ -529,6 +599,174 @@ static void test_semaphore(void)
     NtClose( semaphore );
 }
 
+struct ping_pong
+{
+    HANDLE ping, pong;
+    BOOL   semaphore;
+    LONG   count;
+};
+
+#define PING_PONG_ITERATIONS 10000
+
+static void ping_pong_signal( struct ping_pong *pp, HANDLE handle )
+{
+    NTSTATUS status;
+
+    if (pp->semaphore) status = pNtReleaseSemaphore( handle, 1, NULL );
+    else status = pNtSetEvent( handle, NULL );
+    ok( status == STATUS_SUCCESS, "got %08lx\n", status );
+}
+
+static DWORD WINAPI ping_pong_thread( void *arg )
+{
+    struct ping_pong *pp = arg;
+    NTSTATUS status;
+    unsigned int i;
+
+    for (i = 0; i < PING_PONG_ITERATIONS; i++)
+    {
+        status = NtWaitForSingleObject( pp->ping, FALSE, NULL );
+        ok( status == STATUS_WAIT_0, "%u: got %08lx\n", i, status );
+        ok( pp->count == 2 * i + 1, "%u: got count %ld\n", i, pp->count );
+        pp->count++;
+        ping_pong_signal( pp, pp->pong );
+    }
+    return 0;
+}
+
+static DWORD WINAPI mutex_contention_thread( void *arg )
+{
+    struct ping_pong *pp = arg;
+    NTSTATUS status;
+    unsigned int i;
+    LONG count;
+
+    for (i = 0; i < PING_PONG_ITERATIONS; i++)
+    {
+        status = NtWaitForSingleObject( pp->ping, FALSE, NULL );
+        ok( status == STATUS_WAIT_0, "%u: got %08lx\n", i, status );
+        count = pp->count;
+        if (!(i % 64)) Sleep( 0 );
+        pp->count = count + 1;
+        status = pNtReleaseMutant( pp->ping, NULL );
+        ok( status == STATUS_SUCCESS, "%u: got %08lx\n", i, status );
+    }
+    return 0;
+}
+
+static void run_ping_pong( const char *name, struct ping_pong *pp )
+{
+    LARGE_INTEGER start, end;
+    NTSTATUS status;
+    unsigned int i;
+    HANDLE thread;
+
+    pp->count = 0;
+    pNtQuerySystemTime( &start );
+    thread = CreateThread( NULL, 0, ping_pong_thread, pp, 0, NULL );
+    for (i = 0; i < PING_PONG_ITERATIONS; i++)
+    {
+        pp->count++;
+        ping_pong_signal( pp, pp->ping );
+        status = NtWaitForSingleObject( pp->pong, FALSE, NULL );
+        ok( status == STATUS_WAIT_0, "%u: got %08lx\n", i, status );
+        ok( pp->count == 2 * i + 2, "%u: got count %ld\n", i, pp->count );
+    }
+    pNtQuerySystemTime( &end );
+    ok( !WaitForSingleObject( thread, 10000 ), "wait failed\n" );
+    CloseHandle( thread );
+    if (winetest_debug > 1)
+        trace( "%s: %u round trips in %lu ms\n", name, PING_PONG_ITERATIONS,
+               (ULONG)((end.QuadPart - start.QuadPart) / 10000) );
+}
+
+static void test_sync_ping_pong(void)
+{
+    LARGE_INTEGER zero = {{0}};
+    LARGE_INTEGER start, end;
+    struct ping_pong pp;
+    HANDLE threads[2];
+    NTSTATUS status;
+    unsigned int i;
+
+    /* an auto-reset event is consumed by a wait that doesn't block */
+    status = pNtCreateEvent( &pp.ping, GENERIC_ALL, NULL, SynchronizationEvent, TRUE );
+    ok( status == STATUS_SUCCESS, "NtCreateEvent failed %08lx\n", status );
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+
+    status = pNtCreateEvent( &pp.pong, GENERIC_ALL, NULL, SynchronizationEvent, FALSE );
+    ok( status == STATUS_SUCCESS, "NtCreateEvent failed %08lx\n", status );
+    pp.semaphore = FALSE;
+    run_ping_pong( "events", &pp );
+    pNtClose( pp.ping );
+    pNtClose( pp.pong );
+
+    /* so is a semaphore count, one at a time */
+    status = pNtCreateSemaphore( &pp.ping, GENERIC_ALL, NULL, 2, 2 );
+    ok( status == STATUS_SUCCESS, "NtCreateSemaphore failed %08lx\n", status );
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_TIMEOUT, "got %08lx\n", status );
+
+    status = pNtCreateSemaphore( &pp.pong, GENERIC_ALL, NULL, 0, 1 );
+    ok( status == STATUS_SUCCESS, "NtCreateSemaphore failed %08lx\n", status );
+    pp.semaphore = TRUE;
+    run_ping_pong( "semaphores", &pp );
+    pNtClose( pp.ping );
+    pNtClose( pp.pong );
+
+    /* a mutex is exclusive between threads and recursive within one */
+    status = pNtCreateMutant( &pp.ping, GENERIC_ALL, NULL, FALSE );
+    ok( status == STATUS_SUCCESS, "NtCreateMutant failed %08lx\n", status );
+    for (i = 0; i < 3; i++)
+    {
+        status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+        ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    }
+    threads[0] = CreateThread( NULL, 0, mutant_thread, pp.ping, 0, NULL );
+    ok( WaitForSingleObject( threads[0], 100 ) == WAIT_TIMEOUT, "wait didn't time out\n" );
+    for (i = 0; i < 3; i++)
+    {
+        status = pNtReleaseMutant( pp.ping, NULL );
+        ok( status == STATUS_SUCCESS, "NtReleaseMutant failed %08lx\n", status );
+    }
+    status = pNtReleaseMutant( pp.ping, NULL );
+    ok( status == STATUS_MUTANT_NOT_OWNED, "got %08lx\n", status );
+    ok( !WaitForSingleObject( threads[0], 1000 ), "wait failed\n" );
+    CloseHandle( threads[0] );
+
+    /* the thread exited while owning the mutex */
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_ABANDONED_WAIT_0, "got %08lx\n", status );
+    status = NtWaitForSingleObject( pp.ping, FALSE, &zero );
+    ok( status == STATUS_WAIT_0, "got %08lx\n", status );
+    for (i = 0; i < 2; i++)
+    {
+        status = pNtReleaseMutant( pp.ping, NULL );
+        ok( status == STATUS_SUCCESS, "NtReleaseMutant failed %08lx\n", status );
+    }
+
+    pp.count = 0;
+    pNtQuerySystemTime( &start );
+    threads[0] = CreateThread( NULL, 0, mutex_contention_thread, &pp, 0, NULL );
+    threads[1] = CreateThread( NULL, 0, mutex_contention_thread, &pp, 0, NULL );
+    ok( !WaitForMultipleObjects( 2, threads, TRUE, 10000 ), "wait failed\n" );
+    pNtQuerySystemTime( &end );
+    ok( pp.count == 2 * PING_PONG_ITERATIONS, "got count %ld\n", pp.count );
+    CloseHandle( threads[0] );
+    CloseHandle( threads[1] );
+    if (winetest_debug > 1)
+        trace( "mutex: %u acquisitions in %lu ms\n", 2 * PING_PONG_ITERATIONS,
+               (ULONG)((end.QuadPart - start.QuadPart) / 10000) );
+    pNtClose( pp.ping );
+}
+
 static void test_wait_on_address(void)
 {
     SIZE_T size;
@@ -879,8 +1117,10 @@ START_TEST(sync)
 
     test_wait_on_address();
     test_event();
+    test_event_wait();
     test_mutant();
     test_semaphore();
+    test_sync_ping_pong();
     test_keyed_events();
     test_resource();
     test_tid_alert( argv );
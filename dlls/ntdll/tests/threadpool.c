@@ -1591,7 +1591,6 @@ static void test_tp_window_length(void)
     ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", result);
     ok(info1.ticks != 0 && info2.ticks != 0, "expected that ticks are nonzero\n");
     merged = info2.ticks >= info1.ticks - 50 && info2.ticks <= info1.ticks + 50;
-    todo_wine
     ok(merged || broken(!merged) /* Win 10 */, "expected that timers are merged\n");
 
     /* cleanup */
@@ -1451,6 +1451,136 @@ static void test_NtFreeVirtualMemory(void)
     ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
 }
 
+#define QUERY_THREADS     32
+#define QUERY_ITERATIONS  2000
+
+static void *query_region;
+static HANDLE query_start;
+
+static DWORD WINAPI query_thread( void *arg )
+{
+    MEMORY_BASIC_INFORMATION info;
+    NTSTATUS status;
+    unsigned int i;
+
+    WaitForSingleObject( query_start, INFINITE );
+    for (i = 0; i < QUERY_ITERATIONS; i++)
+    {
+        status = NtQueryVirtualMemory( NtCurrentProcess(), (char *)query_region + page_size,
+                                       MemoryBasicInformation, &info, sizeof(info), NULL );
+        ok( status == STATUS_SUCCESS, "%u: got %08lx\n", i, status );
+        ok( info.AllocationBase == query_region, "%u: got base %p\n", i, info.AllocationBase );
+        ok( info.State == MEM_COMMIT, "%u: got state %lx\n", i, info.State );
+        ok( info.Protect == PAGE_READWRITE, "%u: got protect %lx\n", i, info.Protect );
+        if (status || info.State != MEM_COMMIT) break;
+    }
+    return 0;
+}
+
+static void test_concurrent_query(void)
+{
+    HANDLE threads[QUERY_THREADS];
+    LARGE_INTEGER start, end;
+    NTSTATUS status;
+    unsigned int i;
+    SIZE_T size;
+    DWORD old;
+    void *addr;
+
+    size = 0x10000;
+    query_region = NULL;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &query_region, 0, &size, MEM_COMMIT, PAGE_READWRITE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+
+    query_start = CreateEventA( NULL, TRUE, FALSE, NULL );
+    for (i = 0; i < QUERY_THREADS; i++) threads[i] = CreateThread( NULL, 0, query_thread, NULL, 0, NULL );
+
+    /* the queries must not see the changes made to other regions in the meantime */
+    NtQuerySystemTime( &start );
+    SetEvent( query_start );
+    for (i = 0; i < 200; i++)
+    {
+        size = 0x10000;
+        addr = NULL;
+        status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_COMMIT, PAGE_READWRITE );
+        ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+        ok( VirtualProtect( addr, page_size, PAGE_READONLY, &old ), "VirtualProtect failed\n" );
+        size = 0;
+        status = NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+        ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    }
+    WaitForMultipleObjects( QUERY_THREADS, threads, TRUE, INFINITE );
+    NtQuerySystemTime( &end );
+    if (winetest_debug > 1)
+        trace( "%u threads, %u queries each: %lu ms\n", QUERY_THREADS, QUERY_ITERATIONS,
+               (ULONG)((end.QuadPart - start.QuadPart) / 10000) );
+
+    for (i = 0; i < QUERY_THREADS; i++) CloseHandle( threads[i] );
+    CloseHandle( query_start );
+    size = 0;
+    status = NtFreeVirtualMemory( NtCurrentProcess(), &query_region, &size, MEM_RELEASE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+}
+
+static void test_query_reserved_section(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    LARGE_INTEGER section_size;
+    void *addr, *addr2, *ptr;
+    NTSTATUS status;
+    HANDLE section;
+    SIZE_T size;
+
+    section_size.QuadPart = 0x20000;
+    status = NtCreateSection( &section, SECTION_ALL_ACCESS, NULL, &section_size, PAGE_READWRITE,
+                              SEC_RESERVE, NULL );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+
+    addr = NULL;
+    size = 0;
+    status = NtMapViewOfSection( section, NtCurrentProcess(), &addr, 0, 0, NULL, &size,
+                                 ViewShare, 0, PAGE_READWRITE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    addr2 = NULL;
+    size = 0;
+    status = NtMapViewOfSection( section, NtCurrentProcess(), &addr2, 0, 0, NULL, &size,
+                                 ViewShare, 0, PAGE_READWRITE );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+
+    ptr = VirtualAlloc( (char *)addr + page_size, page_size, MEM_COMMIT, PAGE_READWRITE );
+    ok( ptr == (char *)addr + page_size, "VirtualAlloc returned %p, expected %p.\n",
+        ptr, (char *)addr + page_size );
+
+    /* the other view only learns about the commit from the server */
+    memset( &info, 0, sizeof(info) );
+    status = NtQueryVirtualMemory( NtCurrentProcess(), (char *)addr2 + page_size,
+                                   MemoryBasicInformation, &info, sizeof(info), NULL );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    ok( info.State == MEM_COMMIT, "Unexpected state %#lx.\n", info.State );
+    ok( info.RegionSize == page_size, "Unexpected size %#Ix.\n", info.RegionSize );
+    ok( info.Type == MEM_MAPPED, "Unexpected type %#lx.\n", info.Type );
+
+    memset( &info, 0, sizeof(info) );
+    status = NtQueryVirtualMemory( NtCurrentProcess(), (char *)addr + page_size,
+                                   MemoryBasicInformation, &info, sizeof(info), NULL );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    ok( info.State == MEM_COMMIT, "Unexpected state %#lx.\n", info.State );
+    ok( info.RegionSize == page_size, "Unexpected size %#Ix.\n", info.RegionSize );
+
+    memset( &info, 0, sizeof(info) );
+    status = NtQueryVirtualMemory( NtCurrentProcess(), addr, MemoryBasicInformation,
+                                   &info, sizeof(info), NULL );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    ok( info.State == MEM_RESERVE, "Unexpected state %#lx.\n", info.State );
+    ok( info.RegionSize == page_size, "Unexpected size %#Ix.\n", info.RegionSize );
+
+    status = NtUnmapViewOfSection( NtCurrentProcess(), addr2 );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    status = NtUnmapViewOfSection( NtCurrentProcess(), addr );
+    ok( status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status );
+    NtClose( section );
+}
+
 static void test_prefetch(void)
 {
     NTSTATUS status;
@@ -1613,6 +1743,8 @@ START_TEST(virtual)
     test_NtAllocateVirtualMemory();
     test_NtAllocateVirtualMemoryEx();
     test_NtFreeVirtualMemory();
+    test_concurrent_query();
+    test_query_reserved_section();
     test_RtlCreateUserStack();
     test_NtMapViewOfSection();
     test_NtMapViewOfSectionEx();
@@ -68,6 +68,20 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_compl_debug =
       0, 0, { (DWORD_PTR)(__FILE__ ": threadpool_compl_cs") }
 };
 
+/* binary min-heap of timers, ordered by expiration time */
+struct timer_heap_entry
+{
+    ULONGLONG time;
+    unsigned int index;
+};
+
+struct timer_heap
+{
+    struct timer_heap_entry **entries;
+    unsigned int count;
+    unsigned int capacity;
+};
+
 struct timer_queue;
 struct queue_timer
 {
@@ -78,7 +92,7 @@ struct queue_timer
     PVOID param;
     DWORD period;
     ULONG flags;
-    ULONGLONG expire;
+    struct timer_heap_entry expire;
     BOOL destroy;               /* timer should be deleted; once set, never unset */
     HANDLE event;               /* removal event */
 };
@@ -87,7 +101,8 @@ struct timer_queue
 {
     DWORD magic;
     RTL_CRITICAL_SECTION cs;
-    struct list timers;         /* sorted by expiration time */
+    struct list timers;
+    struct timer_heap heap;     /* timers sorted by expiration time */
     BOOL quit;                  /* queue should be deleted; once set, never unset */
     HANDLE event;
     HANDLE thread;
@@ -98,6 +113,7 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#define THREADPOOL_STARVATION_TIMEOUT 20
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
 /* internal threadpool representation */
@@ -115,6 +131,10 @@ struct threadpool
     int                     min_workers;
     int                     num_workers;
     int                     num_busy_workers;
+    /* worker started beyond the processor count, joins in once the running callbacks stall */
+    BOOL                    standby;
+    RTL_CONDITION_VARIABLE  standby_event;
+    ULONG                   num_completed;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
@@ -178,9 +198,8 @@ struct threadpool_object
             /* information about the timer, locked via timerqueue.cs */
             BOOL            timer_initialized;
             BOOL            timer_pending;
-            struct list     timer_entry;
             BOOL            timer_set;
-            ULONGLONG       timeout;
+            struct timer_heap_entry timeout;
             LONG            period;
             LONG            window_length;
         } timer;
@@ -244,7 +263,8 @@ static struct
     CRITICAL_SECTION        cs;
     LONG                    objcount;
     BOOL                    thread_running;
-    struct list             pending_timers;
+    struct timer_heap       pending_timers;
+    ULONGLONG               window_end;
     RTL_CONDITION_VARIABLE  update_event;
 }
 timerqueue =
@@ -252,7 +272,8 @@ timerqueue =
     { &timerqueue_debug, -1, 0, 0, 0, 0 },      /* cs */
     0,                                          /* objcount */
     FALSE,                                      /* thread_running */
-    LIST_INIT( timerqueue.pending_timers ),     /* pending_timers */
+    { NULL, 0, 0 },                             /* pending_timers */
+    0,                                          /* window_end */
     RTL_CONDITION_VARIABLE_INIT                 /* update_event */
 };
 
@@ -363,6 +384,7 @@ static inline struct threadpool_instance *impl_from_TP_CALLBACK_INSTANCE( TP_CAL
 }
 
 static void CALLBACK threadpool_worker_proc( void *param );
+static void CALLBACK threadpool_standby_proc( void *param );
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled );
 static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread );
 static void tp_object_prepare_shutdown( struct threadpool_object *object );
@@ -396,6 +418,85 @@ static BOOL array_reserve(void **elements, unsigned int *capacity, unsigned int
     return TRUE;
 }
 
+static BOOL timer_heap_reserve( struct timer_heap *heap, unsigned int count )
+{
+    return array_reserve( (void **)&heap->entries, &heap->capacity, count, sizeof(*heap->entries) );
+}
+
+static inline struct timer_heap_entry *timer_heap_head( const struct timer_heap *heap )
+{
+    return heap->count ? heap->entries[0] : NULL;
+}
+
+static inline void timer_heap_set( struct timer_heap *heap, unsigned int index, struct timer_heap_entry *entry )
+{
+    heap->entries[index] = entry;
+    entry->index = index;
+}
+
+static void timer_heap_sift_up( struct timer_heap *heap, struct timer_heap_entry *entry )
+{
+    unsigned int index = entry->index, parent;
+
+    while (index)
+    {
+        parent = (index - 1) / 2;
+        if (heap->entries[parent]->time <= entry->time) break;
+        timer_heap_set( heap, index, heap->entries[parent] );
+        index = parent;
+    }
+    timer_heap_set( heap, index, entry );
+}
+
+static void timer_heap_sift_down( struct timer_heap *heap, struct timer_heap_entry *entry )
+{
+    unsigned int index = entry->index, child;
+
+    while ((child = 2 * index + 1) < heap->count)
+    {
+        if (child + 1 < heap->count && heap->entries[child + 1]->time < heap->entries[child]->time)
+            child++;
+        if (entry->time <= heap->entries[child]->time) break;
+        timer_heap_set( heap, index, heap->entries[child] );
+        index = child;
+    }
+    timer_heap_set( heap, index, entry );
+}
+
+/* space for the new entry has to be reserved with timer_heap_reserve */
+static void timer_heap_insert( struct timer_heap *heap, struct timer_heap_entry *entry, ULONGLONG time )
+{
+    assert( heap->count < heap->capacity );
+    entry->time = time;
+    entry->index = heap->count++;
+    timer_heap_sift_up( heap, entry );
+}
+
+static void timer_heap_remove( struct timer_heap *heap, struct timer_heap_entry *entry )
+{
+    struct timer_heap_entry *last = heap->entries[--heap->count];
+
+    assert( heap->entries[entry->index] == entry );
+    if (last == entry) return;
+
+    timer_heap_set( heap, entry->index, last );
+    if (last->time < entry->time)
+        timer_heap_sift_up( heap, last );
+    else
+        timer_heap_sift_down( heap, last );
+}
+
+static void timer_heap_update( struct timer_heap *heap, struct timer_heap_entry *entry, ULONGLONG time )
+{
+    ULONGLONG old_time = entry->time;
+
+    entry->time = time;
+    if (time < old_time)
+        timer_heap_sift_up( heap, entry );
+    else
+        timer_heap_sift_down( heap, entry );
+}
+
 static void set_thread_name(const WCHAR *name)
 {
     THREAD_NAME_INFORMATION info;
@@ -568,6 +669,7 @@ static void queue_remove_timer(struct queue_timer *t)
     assert(t->destroy);
 
     list_remove(&t->entry);
+    timer_heap_remove(&q->heap, &t->expire);
     if (t->event)
         NtSetEvent(t->event, NULL);
     RtlFreeHeap(GetProcessHeap(), 0, t);
@@ -608,26 +710,18 @@ static inline ULONGLONG queue_current_time(void)
 static void queue_add_timer(struct queue_timer *t, ULONGLONG time,
                             BOOL set_event)
 {
-    /* We MUST hold the queue cs while calling this function.  */
+    /* We MUST hold the queue cs while calling this function, and space
+       for the timer has to be reserved in the heap.  */
     struct timer_queue *q = t->q;
-    struct list *ptr = &q->timers;
 
     assert(!q->quit || (t->destroy && time == EXPIRE_NEVER));
 
-    if (time != EXPIRE_NEVER)
-        LIST_FOR_EACH(ptr, &q->timers)
-        {
-            struct queue_timer *cur = LIST_ENTRY(ptr, struct queue_timer, entry);
-            if (time < cur->expire)
-                break;
-        }
-    list_add_before(ptr, &t->entry);
+    list_add_tail(&q->timers, &t->entry);
+    timer_heap_insert(&q->heap, &t->expire, time);
 
-    t->expire = time;
-
-    /* If we insert at the head of the list, we need to expire sooner
+    /* If we insert at the head of the heap, we need to expire sooner
        than expected.  */
-    if (set_event && &t->entry == list_head(&q->timers))
+    if (set_event && &t->expire == timer_heap_head(&q->heap))
         NtSetEvent(q->event, NULL);
 }
 
@@ -635,25 +729,32 @@ static inline void queue_move_timer(struct queue_timer *t, ULONGLONG time,
                                     BOOL set_event)
 {
     /* We MUST hold the queue cs while calling this function.  */
-    list_remove(&t->entry);
-    queue_add_timer(t, time, set_event);
+    struct timer_queue *q = t->q;
+
+    assert(!q->quit || (t->destroy && time == EXPIRE_NEVER));
+
+    timer_heap_update(&q->heap, &t->expire, time);
+
+    if (set_event && &t->expire == timer_heap_head(&q->heap))
+        NtSetEvent(q->event, NULL);
 }
 
 static void queue_timer_expire(struct timer_queue *q)
 {
+    struct timer_heap_entry *head;
     struct queue_timer *t = NULL;
 
     RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    if ((head = timer_heap_head(&q->heap)))
     {
         ULONGLONG now, next;
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
-        if (!t->destroy && t->expire <= ((now = queue_current_time())))
+        t = CONTAINING_RECORD(head, struct queue_timer, expire);
+        if (!t->destroy && t->expire.time <= ((now = queue_current_time())))
         {
             ++t->runcount;
             if (t->period)
             {
-                next = t->expire + t->period;
+                next = t->expire.time + t->period;
                 /* avoid trigger cascade if overloaded / hibernated */
                 if (next < now)
                     next = now + t->period;
@@ -686,19 +787,20 @@ static void queue_timer_expire(struct timer_queue *q)
 
 static ULONG queue_get_timeout(struct timer_queue *q)
 {
+    struct timer_heap_entry *head;
     struct queue_timer *t;
     ULONG timeout = INFINITE;
 
     RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    if ((head = timer_heap_head(&q->heap)))
     {
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
-        assert(!t->destroy || t->expire == EXPIRE_NEVER);
+        t = CONTAINING_RECORD(head, struct queue_timer, expire);
+        assert(!t->destroy || t->expire.time == EXPIRE_NEVER);
 
-        if (t->expire != EXPIRE_NEVER)
+        if (t->expire.time != EXPIRE_NEVER)
         {
             ULONGLONG time = queue_current_time();
-            timeout = t->expire < time ? 0 : t->expire - time;
+            timeout = t->expire.time < time ? 0 : t->expire.time - time;
         }
     }
     RtlLeaveCriticalSection(&q->cs);
@@ -744,6 +846,7 @@ static void WINAPI timer_queue_thread_proc(LPVOID p)
 
     NtClose(q->event);
     RtlDeleteCriticalSection(&q->cs);
+    RtlFreeHeap(GetProcessHeap(), 0, q->heap.entries);
     q->magic = 0;
     RtlFreeHeap(GetProcessHeap(), 0, q);
     RtlExitUserThread( 0 );
@@ -760,7 +863,7 @@ static void queue_destroy_timer(struct queue_timer *t)
         queue_remove_timer(t);
     else
         /* Make sure no destroyed timer masks an active timer at the head
-           of the sorted list.  */
+           of the heap.  */
         queue_move_timer(t, EXPIRE_NEVER, FALSE);
 }
 
@@ -785,6 +888,9 @@ NTSTATUS WINAPI RtlCreateTimerQueue(PHANDLE NewTimerQueue)
 
     RtlInitializeCriticalSection(&q->cs);
     list_init(&q->timers);
+    q->heap.entries = NULL;
+    q->heap.count = 0;
+    q->heap.capacity = 0;
     q->quit = FALSE;
     q->magic = TIMER_QUEUE_MAGIC;
     status = NtCreateEvent(&q->event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
@@ -944,6 +1050,8 @@ NTSTATUS WINAPI RtlCreateTimer(HANDLE TimerQueue, HANDLE *NewTimer,
     RtlEnterCriticalSection(&q->cs);
     if (q->quit)
         status = STATUS_INVALID_HANDLE;
+    else if (!timer_heap_reserve(&q->heap, q->heap.count + 1))
+        status = STATUS_NO_MEMORY;
     else
         queue_add_timer(t, queue_current_time() + DueTime, TRUE);
     RtlLeaveCriticalSection(&q->cs);
@@ -982,7 +1090,7 @@ NTSTATUS WINAPI RtlUpdateTimer(HANDLE TimerQueue, HANDLE Timer,
 
     RtlEnterCriticalSection(&q->cs);
     /* Can't change a timer if it was once-only or destroyed.  */
-    if (t->expire != EXPIRE_NEVER)
+    if (t->expire.time != EXPIRE_NEVER)
     {
         t->period = Period;
         queue_move_timer(t, queue_current_time() + DueTime, TRUE);
@@ -1050,15 +1158,71 @@ NTSTATUS WINAPI RtlDeleteTimer(HANDLE TimerQueue, HANDLE Timer,
     return status;
 }
 
+static inline struct threadpool_object *timerqueue_get_timer( unsigned int index )
+{
+    return CONTAINING_RECORD( timerqueue.pending_timers.entries[index], struct threadpool_object, u.timer.timeout );
+}
+
+/***********************************************************************
+ *           timerqueue_get_window_end    (internal)
+ *
+ * Returns the earliest end of the window of all timers in the subtree
+ * which expire before timeout_upper, or timeout_upper if there is none.
+ */
+static ULONGLONG timerqueue_get_window_end( unsigned int index, ULONGLONG timeout_upper )
+{
+    struct threadpool_object *timer;
+    ULONGLONG new_timeout;
+
+    if (index >= timerqueue.pending_timers.count)
+        return timeout_upper;
+
+    timer = timerqueue_get_timer( index );
+    assert( timer->type == TP_OBJECT_TYPE_TIMER );
+    if (timer->u.timer.timeout.time >= timeout_upper)
+        return timeout_upper;
+
+    new_timeout = timer->u.timer.timeout.time + (ULONGLONG)timer->u.timer.window_length * 10000;
+    if (new_timeout < timeout_upper)
+        timeout_upper = new_timeout;
+
+    timeout_upper = timerqueue_get_window_end( 2 * index + 1, timeout_upper );
+    return timerqueue_get_window_end( 2 * index + 2, timeout_upper );
+}
+
+/***********************************************************************
+ *           timerqueue_get_last_timeout    (internal)
+ *
+ * Returns the latest expiration time in the subtree which isn't after
+ * timeout_upper, or timeout_lower if there is none.
+ */
+static ULONGLONG timerqueue_get_last_timeout( unsigned int index, ULONGLONG timeout_lower,
+                                              ULONGLONG timeout_upper )
+{
+    struct threadpool_object *timer;
+
+    if (index >= timerqueue.pending_timers.count)
+        return timeout_lower;
+
+    timer = timerqueue_get_timer( index );
+    if (timer->u.timer.timeout.time > timeout_upper)
+        return timeout_lower;
+
+    if (timer->u.timer.timeout.time > timeout_lower)
+        timeout_lower = timer->u.timer.timeout.time;
+
+    timeout_lower = timerqueue_get_last_timeout( 2 * index + 1, timeout_lower, timeout_upper );
+    return timerqueue_get_last_timeout( 2 * index + 2, timeout_lower, timeout_upper );
+}
+
 /***********************************************************************
  *           timerqueue_thread_proc    (internal)
  */
 static void CALLBACK timerqueue_thread_proc( void *param )
 {
-    ULONGLONG timeout_lower, timeout_upper, new_timeout;
-    struct threadpool_object *other_timer;
+    ULONGLONG timeout_lower, timeout_upper;
+    struct timer_heap_entry *head;
     LARGE_INTEGER now, timeout;
-    struct list *ptr;
 
     TRACE( "starting timer queue thread\n" );
     set_thread_name(L"wine_threadpool_timerqueue");
@@ -1069,53 +1233,43 @@ static void CALLBACK timerqueue_thread_proc( void *param )
         NtQuerySystemTime( &now );
 
         /* Check for expired timers. */
-        while ((ptr = list_head( &timerqueue.pending_timers )))
+        while ((head = timer_heap_head( &timerqueue.pending_timers )))
         {
-            struct threadpool_object *timer = LIST_ENTRY( ptr, struct threadpool_object, u.timer.timer_entry );
+            struct threadpool_object *timer = CONTAINING_RECORD( head, struct threadpool_object, u.timer.timeout );
             assert( timer->type == TP_OBJECT_TYPE_TIMER );
             assert( timer->u.timer.timer_pending );
-            if (timer->u.timer.timeout > now.QuadPart)
+            if (timer->u.timer.timeout.time > now.QuadPart)
                 break;
 
             /* Queue a new callback in one of the worker threads. */
-            list_remove( &timer->u.timer.timer_entry );
-            timer->u.timer.timer_pending = FALSE;
             tp_object_submit( timer, FALSE );
 
-            /* Insert the timer back into the queue, except it's marked for shutdown. */
+            /* Move the timer to its next timeout, except it's marked for shutdown. */
             if (timer->u.timer.period && !timer->shutdown)
             {
-                timer->u.timer.timeout += (ULONGLONG)timer->u.timer.period * 10000;
-                if (timer->u.timer.timeout <= now.QuadPart)
-                    timer->u.timer.timeout = now.QuadPart + 1;
+                ULONGLONG next = timer->u.timer.timeout.time + (ULONGLONG)timer->u.timer.period * 10000;
+                if (next <= now.QuadPart)
+                    next = now.QuadPart + 1;
 
-                LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                                     struct threadpool_object, u.timer.timer_entry )
-                {
-                    assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-                    if (timer->u.timer.timeout < other_timer->u.timer.timeout)
-                        break;
-                }
-                list_add_before( &other_timer->u.timer.timer_entry, &timer->u.timer.timer_entry );
-                timer->u.timer.timer_pending = TRUE;
+                timer_heap_update( &timerqueue.pending_timers, &timer->u.timer.timeout, next );
+            }
+            else
+            {
+                timer_heap_remove( &timerqueue.pending_timers, &timer->u.timer.timeout );
+                timer->u.timer.timer_pending = FALSE;
             }
         }
 
+        /* Determine next timeout and use the window length to optimize wakeup
+         * times: wake up for the last timer which expires before the window of
+         * any earlier timer ends, and process all of them at once. */
         timeout_lower = timeout_upper = MAXLONGLONG;
-
-        /* Determine next timeout and use the window length to optimize wakeup times. */
-        LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                             struct threadpool_object, u.timer.timer_entry )
+        if (timerqueue.pending_timers.count)
         {
-            assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-            if (other_timer->u.timer.timeout >= timeout_upper)
-                break;
-
-            timeout_lower = other_timer->u.timer.timeout;
-            new_timeout   = timeout_lower + (ULONGLONG)other_timer->u.timer.window_length * 10000;
-            if (new_timeout < timeout_upper)
-                timeout_upper = new_timeout;
+            timeout_upper = timerqueue_get_window_end( 0, MAXLONGLONG );
+            timeout_lower = timerqueue_get_last_timeout( 0, 0, timeout_upper );
         }
+        timerqueue.window_end = timeout_upper;
 
         /* Wait for timer update events or until the next timer expires. */
         if (timerqueue.objcount)
@@ -1163,6 +1317,41 @@ static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
     return status;
 }
 
+/***********************************************************************
+ *           tp_new_standby_thread    (internal)
+ *
+ * Create and account a standby worker thread for the desired pool. The
+ * thread only starts processing tasks when the busy workers don't make
+ * any progress, for instance because all of them are blocked.
+ */
+static NTSTATUS tp_new_standby_thread( struct threadpool *pool )
+{
+    HANDLE thread;
+    NTSTATUS status;
+
+    status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
+                                  threadpool_standby_proc, pool, &thread, NULL );
+    if (status == STATUS_SUCCESS)
+    {
+        InterlockedIncrement( &pool->refcount );
+        pool->num_workers++;
+        pool->standby = TRUE;
+        NtClose( thread );
+    }
+    return status;
+}
+
+/***********************************************************************
+ *           tp_get_concurrency    (internal)
+ *
+ * Returns the number of workers that can be started without waiting for
+ * the running callbacks to stall.
+ */
+static int tp_get_concurrency( const struct threadpool *pool )
+{
+    return max( pool->min_workers, (int)NtCurrentTeb()->Peb->NumberOfProcessors );
+}
+
 /***********************************************************************
  *           tp_timerqueue_lock    (internal)
  *
@@ -1177,14 +1366,18 @@ static NTSTATUS tp_timerqueue_lock( struct threadpool_object *timer )
     timer->u.timer.timer_initialized    = FALSE;
     timer->u.timer.timer_pending        = FALSE;
     timer->u.timer.timer_set            = FALSE;
-    timer->u.timer.timeout              = 0;
+    timer->u.timer.timeout.time         = 0;
     timer->u.timer.period               = 0;
     timer->u.timer.window_length        = 0;
 
     RtlEnterCriticalSection( &timerqueue.cs );
 
+    /* Make sure that the timer can always be queued. */
+    if (!timer_heap_reserve( &timerqueue.pending_timers, timerqueue.objcount + 1 ))
+        status = STATUS_NO_MEMORY;
+
     /* Make sure that the timerqueue thread is running. */
-    if (!timerqueue.thread_running)
+    if (status == STATUS_SUCCESS && !timerqueue.thread_running)
     {
         HANDLE thread;
         status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
@@ -1221,14 +1414,14 @@ static void tp_timerqueue_unlock( struct threadpool_object *timer )
         /* If timer was pending, remove it. */
         if (timer->u.timer.timer_pending)
         {
-            list_remove( &timer->u.timer.timer_entry );
+            timer_heap_remove( &timerqueue.pending_timers, &timer->u.timer.timeout );
             timer->u.timer.timer_pending = FALSE;
         }
 
         /* If the last timer object was destroyed, then wake up the thread. */
         if (!--timerqueue.objcount)
         {
-            assert( list_empty( &timerqueue.pending_timers ) );
+            assert( !timerqueue.pending_timers.count );
             RtlWakeAllConditionVariable( &timerqueue.update_event );
         }
 
@@ -1681,11 +1874,14 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         list_init( &pool->pools[i] );
     RtlInitializeConditionVariable( &pool->update_event );
+    RtlInitializeConditionVariable( &pool->standby_event );
 
     pool->max_workers             = 500;
     pool->min_workers             = 0;
     pool->num_workers             = 0;
     pool->num_busy_workers        = 0;
+    pool->standby                 = FALSE;
+    pool->num_completed           = 0;
     pool->stack_info.StackReserve = nt->OptionalHeader.SizeOfStackReserve;
     pool->stack_info.StackCommit  = nt->OptionalHeader.SizeOfStackCommit;
 
@@ -1708,6 +1904,7 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
 
     pool->shutdown = TRUE;
     RtlWakeAllConditionVariable( &pool->update_event );
+    RtlWakeAllConditionVariable( &pool->standby_event );
 }
 
 /***********************************************************************
@@ -1989,10 +2186,16 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 
     RtlEnterCriticalSection( &pool->cs );
 
-    /* Start new worker threads if required. */
+    /* Start new worker threads if required. Once there is a worker for each
+     * processor, further workers only join in when the busy ones stall. */
     if (pool->num_busy_workers >= pool->num_workers &&
         pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    {
+        if (object->may_run_long || pool->num_workers - pool->standby < tp_get_concurrency( pool ))
+            status = tp_new_worker_thread( pool );
+        else if (!pool->standby)
+            tp_new_standby_thread( pool );
+    }
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
@@ -2326,18 +2529,16 @@ skip_cleanup:
 }
 
 /***********************************************************************
- *           threadpool_worker_proc    (internal)
+ *           threadpool_worker_loop    (internal)
+ *
+ * Processes tasks until the worker thread should terminate, pool->cs
+ * has to be held.
  */
-static void CALLBACK threadpool_worker_proc( void *param )
+static void threadpool_worker_loop( struct threadpool *pool )
 {
-    struct threadpool *pool = param;
     LARGE_INTEGER timeout;
     struct list *ptr;
 
-    TRACE( "starting worker thread for pool %p\n", pool );
-    set_thread_name(L"wine_threadpool_worker");
-
-    RtlEnterCriticalSection( &pool->cs );
     for (;;)
     {
         while ((ptr = threadpool_get_next_item( pool )))
@@ -2355,6 +2556,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
 
             assert(pool->num_busy_workers);
             pool->num_busy_workers--;
+            pool->num_completed++;
 
             tp_object_release( object );
         }
@@ -2367,15 +2569,73 @@ static void CALLBACK threadpool_worker_proc( void *param )
          * when no new tasks are available, and the number of threads can be
          * decreased without violating the min_workers limit. An exception is when
          * min_workers == 0, then objcount is used to detect if the last thread
-         * can be terminated. */
+         * can be terminated. The standby worker doesn't count, as it terminates
+         * on its own. */
         timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
         if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
+            !threadpool_get_next_item( pool ) &&
+            (pool->num_workers - pool->standby > max( pool->min_workers, 1 ) ||
             (!pool->min_workers && !pool->objcount)))
         {
             break;
         }
     }
+}
+
+/***********************************************************************
+ *           threadpool_worker_proc    (internal)
+ */
+static void CALLBACK threadpool_worker_proc( void *param )
+{
+    struct threadpool *pool = param;
+
+    TRACE( "starting worker thread for pool %p\n", pool );
+    set_thread_name(L"wine_threadpool_worker");
+
+    RtlEnterCriticalSection( &pool->cs );
+    threadpool_worker_loop( pool );
+    pool->num_workers--;
+    RtlLeaveCriticalSection( &pool->cs );
+
+    TRACE( "terminating worker thread for pool %p\n", pool );
+    tp_threadpool_release( pool );
+    RtlExitUserThread( 0 );
+}
+
+/***********************************************************************
+ *           threadpool_standby_proc    (internal)
+ */
+static void CALLBACK threadpool_standby_proc( void *param )
+{
+    struct threadpool *pool = param;
+    LARGE_INTEGER timeout;
+    ULONG num_completed;
+
+    TRACE( "starting standby worker thread for pool %p\n", pool );
+    set_thread_name(L"wine_threadpool_worker");
+
+    /* Wait as long as queued tasks remain and the busy workers keep completing
+     * callbacks. When the queue drains the standby worker is no longer needed. */
+    RtlEnterCriticalSection( &pool->cs );
+    timeout.QuadPart = (ULONGLONG)THREADPOOL_STARVATION_TIMEOUT * -10000;
+    do
+    {
+        num_completed = pool->num_completed;
+        RtlSleepConditionVariableCS( &pool->standby_event, &pool->cs, &timeout );
+    }
+    while (!pool->shutdown && threadpool_get_next_item( pool ) && pool->num_completed != num_completed);
+    pool->standby = FALSE;
+
+    if (threadpool_get_next_item( pool ))
+    {
+        TRACE( "workers of pool %p stalled, activating standby worker\n", pool );
+
+        /* Keep another standby worker around if tasks remain uncovered. */
+        if (pool->num_busy_workers > pool->num_workers && pool->num_workers < pool->max_workers)
+            tp_new_standby_thread( pool );
+
+        threadpool_worker_loop( pool );
+    }
     pool->num_workers--;
     RtlLeaveCriticalSection( &pool->cs );
 
@@ -2969,7 +3229,6 @@ BOOL WINAPI TpSetPoolMinThreads( TP_POOL *pool, DWORD minimum )
 VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LONG window_length )
 {
     struct threadpool_object *this = impl_from_TP_TIMER( timer );
-    struct threadpool_object *other_timer;
     BOOL submit_timer = FALSE;
     ULONGLONG timestamp;
 
@@ -3008,28 +3267,23 @@ VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LO
     /* First remove existing timeout. */
     if (this->u.timer.timer_pending)
     {
-        list_remove( &this->u.timer.timer_entry );
+        timer_heap_remove( &timerqueue.pending_timers, &this->u.timer.timeout );
         this->u.timer.timer_pending = FALSE;
     }
 
     /* If the timer was enabled, then add it back to the queue. */
     if (timeout)
     {
-        this->u.timer.timeout       = timestamp;
         this->u.timer.period        = period;
         this->u.timer.window_length = window_length;
 
-        LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                             struct threadpool_object, u.timer.timer_entry )
-        {
-            assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-            if (this->u.timer.timeout < other_timer->u.timer.timeout)
-                break;
-        }
-        list_add_before( &other_timer->u.timer.timer_entry, &this->u.timer.timer_entry );
+        timer_heap_insert( &timerqueue.pending_timers, &this->u.timer.timeout, timestamp );
 
-        /* Wake up the timer thread when the timeout has to be updated. */
-        if (list_head( &timerqueue.pending_timers ) == &this->u.timer.timer_entry )
+        /* Wake up the timer thread when the timeout has to be updated, either
+         * because the timer expires first or because it can be merged with the
+         * timers processed on the next wakeup. */
+        if (timer_heap_head( &timerqueue.pending_timers ) == &this->u.timer.timeout ||
+            timestamp <= timerqueue.window_end)
             RtlWakeAllConditionVariable( &timerqueue.update_event );
 
         this->u.timer.timer_pending = TRUE;
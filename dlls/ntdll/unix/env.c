@@ -1706,18 +1706,11 @@ static inline void dup_unicode_string( const UNICODE_STRING *src, WCHAR **dst, U
 /*************************************************************************
  *		get_dword_option
  */
-static ULONG get_dword_option( HANDLE key, const WCHAR *name, ULONG defval )
+static ULONG get_dword_option( const struct key_value_query *query, ULONG defval )
 {
-    UNICODE_STRING str;
-    ULONG size;
-    WCHAR buffer[64];
-    KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buffer;
-
-    init_unicode_string( &str, name );
-    size = sizeof(buffer) - sizeof(WCHAR);
-    if (NtQueryValueKey( key, &str, KeyValuePartialInformation, buffer, size, &size )) return defval;
-    if (info->Type != REG_DWORD) return defval;
-    return *(ULONG *)info->Data;
+    if (query->status) return defval;
+    if (query->info->Type != REG_DWORD) return defval;
+    return *(ULONG *)query->info->Data;
 }
 
 
@@ -1741,37 +1734,48 @@ static void load_global_options( const UNICODE_STRING *image )
     static const WCHAR heapcommitW[] = {'H','e','a','p','S','e','g','m','e','n','t','C','o','m','m','i','t',0};
     static const WCHAR heapdecommittotalW[] = {'H','e','a','p','D','e','C','o','m','m','i','t','T','o','t','a','l','F','r','e','e','T','h','r','e','s','h','o','l','d',0};
     static const WCHAR heapdecommitblockW[] = {'H','e','a','p','D','e','C','o','m','m','i','t','F','r','e','e','B','l','o','c','k','T','h','r','e','s','h','o','l','d',0};
+    static const WCHAR * const session_options[] =
+    {
+        globalflagW, critsectionW, heapreserveW, heapcommitW, heapdecommittotalW, heapdecommitblockW
+    };
+    struct key_value_query queries[ARRAY_SIZE(session_options)];
+    ULONG buffers[ARRAY_SIZE(session_options)][16];
     OBJECT_ATTRIBUTES attr;
     UNICODE_STRING nameW;
-    HANDLE key;
-    ULONG i;
+    WCHAR *name;
+    ULONG i, len;
 
-    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, 0, NULL );
-    init_unicode_string( &nameW, sessionW );
-    if (!NtOpenKey( &key, KEY_QUERY_VALUE, &attr ))
-    {
-        peb->NtGlobalFlag = get_dword_option( key, globalflagW, 0 );
-        peb->CriticalSectionTimeout.QuadPart = get_dword_option( key, critsectionW, 30 * 24 * 60 * 60 ) * (ULONGLONG)-10000000;
-        peb->HeapSegmentReserve = get_dword_option( key, heapreserveW, 0x100000 );
-        peb->HeapSegmentCommit = get_dword_option( key, heapcommitW, 0x10000 );
-        peb->HeapDeCommitTotalFreeThreshold = get_dword_option( key, heapdecommittotalW, 0x10000 );
-        peb->HeapDeCommitFreeBlockThreshold = get_dword_option( key, heapdecommitblockW, 0x1000 );
-        NtClose( key );
-    }
-    init_unicode_string( &nameW, optionsW );
-    if (!NtOpenKey( &key, KEY_QUERY_VALUE, &attr ))
+    for (i = 0; i < ARRAY_SIZE(queries); i++)
     {
-        attr.RootDirectory = key;
-        for (i = image->Length / sizeof(WCHAR); i; i--) if (image->Buffer[i - 1] == '\\') break;
-        nameW.Buffer = image->Buffer + i;
-        nameW.Length = image->Length - i * sizeof(WCHAR);
-        if (!NtOpenKey( &key, KEY_QUERY_VALUE, &attr ))
-        {
-            peb->NtGlobalFlag = get_dword_option( key, globalflagW, peb->NtGlobalFlag );
-            NtClose( key );
-        }
-        NtClose( attr.RootDirectory );
+        init_unicode_string( &queries[i].name, session_options[i] );
+        queries[i].info = (KEY_VALUE_PARTIAL_INFORMATION *)buffers[i];
+        queries[i].size = sizeof(buffers[i]);
     }
+
+    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, 0, NULL );
+    init_unicode_string( &nameW, sessionW );
+    if (!query_key_values( &attr, KEY_QUERY_VALUE, queries, ARRAY_SIZE(queries) ))
+    {
+        peb->NtGlobalFlag = get_dword_option( &queries[0], 0 );
+        peb->CriticalSectionTimeout.QuadPart = get_dword_option( &queries[1], 30 * 24 * 60 * 60 ) * (ULONGLONG)-10000000;
+        peb->HeapSegmentReserve = get_dword_option( &queries[2], 0x100000 );
+        peb->HeapSegmentCommit = get_dword_option( &queries[3], 0x10000 );
+        peb->HeapDeCommitTotalFreeThreshold = get_dword_option( &queries[4], 0x10000 );
+        peb->HeapDeCommitFreeBlockThreshold = get_dword_option( &queries[5], 0x1000 );
+    }
+
+    for (i = image->Length / sizeof(WCHAR); i; i--) if (image->Buffer[i - 1] == '\\') break;
+    len = wcslen( optionsW );
+    if (!(name = malloc( (len + 1) * sizeof(WCHAR) + image->Length - i * sizeof(WCHAR) ))) return;
+    memcpy( name, optionsW, len * sizeof(WCHAR) );
+    if (i < image->Length / sizeof(WCHAR)) name[len++] = '\\';
+    memcpy( name + len, image->Buffer + i, image->Length - i * sizeof(WCHAR) );
+    nameW.Buffer = name;
+    nameW.Length = nameW.MaximumLength = len * sizeof(WCHAR) + image->Length - i * sizeof(WCHAR);
+    queries[0].size = sizeof(buffers[0]);
+    if (!query_key_values( &attr, KEY_QUERY_VALUE, queries, 1 ))
+        peb->NtGlobalFlag = get_dword_option( &queries[0], peb->NtGlobalFlag );
+    free( name );
 }
 
 
@@ -2511,6 +2511,256 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* case-insensitive name lookup cache for directories, keyed by identity and modification time */
+
+struct dir_lookup_name
+{
+    unsigned int   next;      /* index + 1 of the next name in the hash chain */
+    unsigned int   hash;      /* hash of the upcased name */
+    unsigned int   offset;    /* offset of the upcased name, followed by the unix name */
+    unsigned short len;       /* length of the upcased name in chars */
+};
+
+struct dir_lookup
+{
+    struct list             entry;      /* entry in the LRU list */
+    struct file_identity    id;         /* directory file identity */
+    time_t                  mtime;      /* directory modification time */
+    long                    mtime_nsec;
+    unsigned int            count;      /* count of names */
+    unsigned int            size;       /* size of the names array */
+    unsigned int            hash_size;  /* size of the hash table, a power of 2 */
+    unsigned int           *buckets;    /* hash table of index + 1 of the first name in chain */
+    struct dir_lookup_name *names;      /* names array */
+    char                   *data;       /* names data */
+    unsigned int            data_pos;   /* used size of the data buffer */
+    unsigned int            data_size;  /* allocated size of the data buffer */
+};
+
+#define MAX_DIR_LOOKUP_CACHE 128
+
+static struct list dir_lookup_cache = LIST_INIT( dir_lookup_cache );
+static unsigned int dir_lookup_cache_count;
+static pthread_mutex_t dir_lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* statistics, only maintained when tracing */
+static struct
+{
+    unsigned int lookups;     /* lookups that needed a directory scan */
+    unsigned int hits;        /* lookups satisfied by the cache */
+    unsigned int scans;       /* directories scanned to fill the cache */
+    ULONGLONG    scan_time;   /* total time spent scanning, in 100ns units */
+} dir_lookup_stats;
+
+static inline unsigned int hash_dir_lookup_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 0;
+    for (i = 0; i < len; i++) hash = hash * 65599 + name[i];
+    return hash;
+}
+
+static inline const WCHAR *get_dir_lookup_nameW( const struct dir_lookup *dir, const struct dir_lookup_name *name )
+{
+    return (const WCHAR *)(dir->data + name->offset);
+}
+
+static inline const char *get_dir_lookup_unix_name( const struct dir_lookup *dir,
+                                                    const struct dir_lookup_name *name )
+{
+    return dir->data + name->offset + name->len * sizeof(WCHAR);
+}
+
+static void free_dir_lookup( struct dir_lookup *dir )
+{
+    list_remove( &dir->entry );
+    dir_lookup_cache_count--;
+    free( dir->buckets );
+    free( dir->names );
+    free( dir->data );
+    free( dir );
+}
+
+static BOOL add_dir_lookup_name( struct dir_lookup *dir, const WCHAR *nameW, unsigned int len,
+                                 const char *unix_name )
+{
+    unsigned int unix_len = strlen( unix_name ) + 1;
+    unsigned int size = (len * sizeof(WCHAR) + unix_len + 1) & ~1;  /* keep names aligned */
+    struct dir_lookup_name *name;
+
+    if (dir->count == dir->size)
+    {
+        unsigned int new_size = max( 64, dir->size * 2 );
+        if (!(name = realloc( dir->names, new_size * sizeof(*name) ))) return FALSE;
+        dir->names = name;
+        dir->size = new_size;
+    }
+    if (dir->data_size - dir->data_pos < size)
+    {
+        unsigned int new_size = max( max( 4096, dir->data_size * 2 ), dir->data_pos + size );
+        char *data;
+
+        if (!(data = realloc( dir->data, new_size ))) return FALSE;
+        dir->data = data;
+        dir->data_size = new_size;
+    }
+    name = &dir->names[dir->count++];
+    name->offset = dir->data_pos;
+    name->len = len;
+    name->hash = hash_dir_lookup_name( nameW, len );
+    memcpy( dir->data + dir->data_pos, nameW, len * sizeof(WCHAR) );
+    memcpy( dir->data + dir->data_pos + len * sizeof(WCHAR), unix_name, unix_len );
+    dir->data_pos += size;
+    return TRUE;
+}
+
+/* read all the names of a directory; unix_name is the directory path */
+static struct dir_lookup *create_dir_lookup( const char *unix_name, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_lookup *dir;
+    struct dirent *de;
+    LARGE_INTEGER start, end;
+    unsigned int i;
+    DIR *dirp;
+    int len;
+
+    if (TRACE_ON(file)) NtQueryPerformanceCounter( &start, NULL );
+    if (!(dirp = opendir( unix_name ))) return NULL;
+    if (!(dir = calloc( 1, sizeof(*dir) ))) goto error;
+    list_add_head( &dir_lookup_cache, &dir->entry );
+    dir_lookup_cache_count++;
+
+    dir->id.dev = st->st_dev;
+    dir->id.ino = st->st_ino;
+    dir->mtime = st->st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    dir->mtime_nsec = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    dir->mtime_nsec = st->st_mtimespec.tv_nsec;
+#endif
+
+    while ((de = readdir( dirp )))
+    {
+        len = ntdll_umbstowcs( de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN );
+        for (i = 0; i < len; i++) buffer[i] = towupper( buffer[i] );
+        if (!add_dir_lookup_name( dir, buffer, len, de->d_name )) goto error;
+    }
+    closedir( dirp );
+    dirp = NULL;
+
+    for (dir->hash_size = 64; dir->hash_size < dir->count * 2; dir->hash_size *= 2) /* nothing */;
+    if (!(dir->buckets = calloc( dir->hash_size, sizeof(*dir->buckets) ))) goto error;
+    /* insert in reverse order so that the first entry returned by readdir wins, as in a scan */
+    for (i = dir->count; i > 0; i--)
+    {
+        unsigned int *bucket = &dir->buckets[dir->names[i - 1].hash & (dir->hash_size - 1)];
+        dir->names[i - 1].next = *bucket;
+        *bucket = i;
+    }
+
+    if (TRACE_ON(file))
+    {
+        NtQueryPerformanceCounter( &end, NULL );
+        dir_lookup_stats.scans++;
+        dir_lookup_stats.scan_time += end.QuadPart - start.QuadPart;
+    }
+    return dir;
+
+error:
+    if (dirp) closedir( dirp );
+    if (dir) free_dir_lookup( dir );
+    return NULL;
+}
+
+/***********************************************************************
+ *           lookup_cached_dir_name
+ *
+ * Look for a name in the lookup cache of a directory, filling it if needed.
+ * unix_name is the directory path, and the found name is appended at pos.
+ * Returns STATUS_MORE_PROCESSING_REQUIRED if the directory must be scanned.
+ */
+static NTSTATUS lookup_cached_dir_name( char *unix_name, int pos, const WCHAR *name, int length,
+                                        BOOLEAN is_name_8_dot_3 )
+{
+    WCHAR nameW[MAX_DIR_ENTRY_LEN];
+    struct dir_lookup *dir = NULL, *cur;
+    struct stat st;
+    unsigned int hash, idx;
+    long mtime_nsec = 0;
+    NTSTATUS status = STATUS_MORE_PROCESSING_REQUIRED;
+    int i;
+
+    if (length > MAX_DIR_ENTRY_LEN) return status;
+    if (stat( unix_name, &st ) == -1) return status;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime_nsec = st.st_mtimespec.tv_nsec;
+#endif
+
+    for (i = 0; i < length; i++) nameW[i] = towupper( name[i] );
+    hash = hash_dir_lookup_name( nameW, length );
+
+    mutex_lock( &dir_lookup_mutex );
+
+    LIST_FOR_EACH_ENTRY( cur, &dir_lookup_cache, struct dir_lookup, entry )
+    {
+        if (cur->id.dev != st.st_dev || cur->id.ino != st.st_ino) continue;
+        if (cur->mtime == st.st_mtime && cur->mtime_nsec == mtime_nsec) dir = cur;
+        else free_dir_lookup( cur );  /* the directory has been modified */
+        break;
+    }
+
+    if (dir)
+    {
+        list_remove( &dir->entry );
+        list_add_head( &dir_lookup_cache, &dir->entry );
+    }
+    /* only cache directories that haven't been modified recently, so that a
+     * modification is guaranteed to change the mtime even with coarse timestamps */
+    else if (time( NULL ) > st.st_mtime + 1)
+    {
+        if (dir_lookup_cache_count >= MAX_DIR_LOOKUP_CACHE)
+            free_dir_lookup( LIST_ENTRY( list_tail( &dir_lookup_cache ), struct dir_lookup, entry ));
+        dir = create_dir_lookup( unix_name, &st );
+    }
+
+    if (dir)
+    {
+        for (idx = dir->buckets[hash & (dir->hash_size - 1)]; idx; idx = dir->names[idx - 1].next)
+        {
+            const struct dir_lookup_name *entry = &dir->names[idx - 1];
+
+            if (entry->hash != hash || entry->len != length) continue;
+            if (memcmp( get_dir_lookup_nameW( dir, entry ), nameW, length * sizeof(WCHAR) )) continue;
+            unix_name[pos - 1] = '/';
+            strcpy( unix_name + pos, get_dir_lookup_unix_name( dir, entry ));
+            status = STATUS_SUCCESS;
+            break;
+        }
+        /* short names are not cached, those still need a scan */
+        if (status && !is_name_8_dot_3) status = STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+
+    if (TRACE_ON(file))
+    {
+        if (status != STATUS_MORE_PROCESSING_REQUIRED) dir_lookup_stats.hits++;
+        if (!(++dir_lookup_stats.lookups % 1024) && dir_lookup_stats.scans)
+        {
+            unsigned int scan_time = dir_lookup_stats.scan_time / dir_lookup_stats.scans / 10;
+            unsigned int saved = dir_lookup_stats.hits > dir_lookup_stats.scans ?
+                                 dir_lookup_stats.hits - dir_lookup_stats.scans : 0;
+            TRACE( "%u lookups, %u cache hits, %u scans of %u us, about %u ms saved\n",
+                   dir_lookup_stats.lookups, dir_lookup_stats.hits, dir_lookup_stats.scans,
+                   scan_time, (unsigned int)((ULONGLONG)saved * scan_time / 1000) );
+        }
+    }
+
+    mutex_unlock( &dir_lookup_mutex );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2601,6 +2851,13 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (lookup_cached_dir_name( unix_name, pos, name, length, is_name_8_dot_3 ))
+    {
+    case STATUS_SUCCESS: return STATUS_SUCCESS;
+    case STATUS_OBJECT_NAME_NOT_FOUND: goto not_found;
+    default: break;
+    }
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
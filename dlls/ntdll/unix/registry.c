@@ -69,6 +69,82 @@ NTSTATUS open_hkcu_key( const char *path, HANDLE *key )
 }
 
 
+/******************************************************************************
+ *              query_key_values
+ *
+ * Open a key, query some of its values and close it again, all in a single
+ * server round trip. Returns the status of opening the key.
+ */
+NTSTATUS query_key_values( const OBJECT_ATTRIBUTES *attr, ACCESS_MASK access,
+                           struct key_value_query *queries, ULONG count )
+{
+    const ULONG fixed_size = offsetof( KEY_VALUE_PARTIAL_INFORMATION, Data );
+    struct __server_request_info *reqs;
+    struct batch_request *batch;
+    NTSTATUS ret;
+    ULONG i;
+
+    if (attr->Length != sizeof(*attr)) return STATUS_INVALID_PARAMETER;
+    if (attr->ObjectName->Length & 1) return STATUS_OBJECT_NAME_INVALID;
+
+    if (!(reqs = calloc( count + 2, sizeof(*reqs) ))) return STATUS_NO_MEMORY;
+    if (!(batch = calloc( count + 2, sizeof(*batch) )))
+    {
+        free( reqs );
+        return STATUS_NO_MEMORY;
+    }
+
+    reqs[0].u.req.request_header.req = REQ_open_key;
+    reqs[0].u.req.open_key_request.parent     = wine_server_obj_handle( attr->RootDirectory );
+    reqs[0].u.req.open_key_request.access     = access;
+    reqs[0].u.req.open_key_request.attributes = attr->Attributes | OBJ_CASE_INSENSITIVE;
+    wine_server_add_data( &reqs[0], attr->ObjectName->Buffer, attr->ObjectName->Length );
+
+    for (i = 0; i < count; i++)
+    {
+        struct __server_request_info *req = &reqs[i + 1];
+
+        req->u.req.request_header.req = REQ_get_key_value;
+        wine_server_add_data( req, queries[i].name.Buffer, queries[i].name.Length );
+        if (queries[i].size > fixed_size)
+            wine_server_set_reply( req, queries[i].info->Data, queries[i].size - fixed_size );
+        batch[i + 1].handle_offset = offsetof( struct get_key_value_request, hkey );
+        batch[i + 1].handle_source = offsetof( struct open_key_reply, hkey );
+        batch[i + 1].handle_index  = 0;
+    }
+
+    reqs[count + 1].u.req.request_header.req = REQ_close_handle;
+    batch[count + 1].handle_offset = offsetof( struct close_handle_request, handle );
+    batch[count + 1].handle_source = offsetof( struct open_key_reply, hkey );
+    batch[count + 1].handle_index  = 0;
+
+    if (!(ret = server_call_batch( reqs, batch, count + 2 ))) ret = reqs[0].u.reply.reply_header.error;
+
+    for (i = 0; i < count; i++)
+    {
+        const struct get_key_value_reply *reply = &reqs[i + 1].u.reply.get_key_value_reply;
+
+        if (ret) queries[i].status = ret;
+        else if (!(queries[i].status = reply->__header.error))
+        {
+            if (queries[i].size >= fixed_size)
+            {
+                queries[i].info->TitleIndex = 0;
+                queries[i].info->Type = reply->type;
+                queries[i].info->DataLength = reply->total;
+            }
+            if (queries[i].size < fixed_size) queries[i].status = STATUS_BUFFER_TOO_SMALL;
+            else if (queries[i].size < fixed_size + reply->total) queries[i].status = STATUS_BUFFER_OVERFLOW;
+            queries[i].size = fixed_size + reply->total;
+        }
+    }
+
+    free( batch );
+    free( reqs );
+    return ret;
+}
+
+
 /******************************************************************************
  *              NtCreateKey  (NTDLL.@)
  */
@@ -825,38 +901,34 @@ NTSTATUS WINAPI NtQueryLicenseValue( const UNICODE_STRING *name, ULONG *type,
                                   'W','i','n','e','\\','L','i','c','e','n','s','e',
                                   'I','n','f','o','r','m','a','t','i','o','n',0};
     UNICODE_STRING keyW = { sizeof(nameW) - sizeof(WCHAR), sizeof(nameW), (WCHAR *)nameW };
-    KEY_VALUE_PARTIAL_INFORMATION *info;
-    NTSTATUS status = STATUS_OBJECT_NAME_NOT_FOUND;
-    DWORD info_length, count;
+    struct key_value_query query;
+    NTSTATUS status;
     OBJECT_ATTRIBUTES attr;
-    HANDLE key;
 
     if (!name || !name->Buffer || !name->Length || !retlen) return STATUS_INVALID_PARAMETER;
 
-    info_length = FIELD_OFFSET( KEY_VALUE_PARTIAL_INFORMATION, Data ) + length;
-    if (!(info = malloc( info_length ))) return STATUS_NO_MEMORY;
+    query.name = *name;
+    query.size = FIELD_OFFSET( KEY_VALUE_PARTIAL_INFORMATION, Data ) + length;
+    if (!(query.info = malloc( query.size ))) return STATUS_NO_MEMORY;
 
     InitializeObjectAttributes( &attr, &keyW, 0, 0, NULL );
 
     /* @@ Wine registry key: HKLM\Software\Wine\LicenseInformation */
-    if (!NtOpenKey( &key, KEY_READ, &attr ))
+    if (query_key_values( &attr, KEY_READ, &query, 1 )) status = STATUS_OBJECT_NAME_NOT_FOUND;
+    else status = query.status;
+    if (!status || status == STATUS_BUFFER_OVERFLOW)
     {
-        status = NtQueryValueKey( key, name, KeyValuePartialInformation, info, info_length, &count );
-        if (!status || status == STATUS_BUFFER_OVERFLOW)
-        {
-            if (type) *type = info->Type;
-            *retlen = info->DataLength;
-            if (status == STATUS_BUFFER_OVERFLOW)
-                status = STATUS_BUFFER_TOO_SMALL;
-            else
-                memcpy( data, info->Data, info->DataLength );
-        }
-        NtClose( key );
+        if (type) *type = query.info->Type;
+        *retlen = query.info->DataLength;
+        if (status == STATUS_BUFFER_OVERFLOW)
+            status = STATUS_BUFFER_TOO_SMALL;
+        else
+            memcpy( data, query.info->Data, query.info->DataLength );
     }
 
     if (status == STATUS_OBJECT_NAME_NOT_FOUND)
         FIXME( "License key %s not found\n", debugstr_w(name->Buffer) );
 
-    free( info );
+    free( query.info );
     return status;
 }
@@ -28,6 +28,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #ifdef HAVE_LWP_H
 #include <lwp.h>
 #endif
@@ -269,6 +270,70 @@ unsigned int server_call_unlocked( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           server_call_batch
+ *
+ * Perform several server calls in a single round trip. batch, if non-NULL,
+ * specifies for each request the earlier request it gets a handle from.
+ * The status of each request is returned in its reply header.
+ */
+unsigned int server_call_batch( struct __server_request_info *reqs, const struct batch_request *batch,
+                                unsigned int count )
+{
+    static const struct batch_request no_handle;
+    data_size_t size = 0, reply_size = 0, len;
+    unsigned int i, j, ret, done = 0;
+    char *buffer, *ptr;
+
+    for (i = 0; i < count; i++)
+    {
+        size += sizeof(*batch) + sizeof(reqs[i].u.req) + ((reqs[i].u.req.request_header.request_size + 7) & ~7);
+        reply_size += sizeof(reqs[i].u.reply) + ((reqs[i].u.req.request_header.reply_size + 7) & ~7);
+    }
+    if (!(buffer = calloc( 1, size + reply_size ))) return STATUS_NO_MEMORY;
+
+    for (i = 0, ptr = buffer; i < count; i++)
+    {
+        memcpy( ptr, batch ? &batch[i] : &no_handle, sizeof(*batch) );
+        ptr += sizeof(*batch);
+        memcpy( ptr, &reqs[i].u.req, sizeof(reqs[i].u.req) );
+        ptr += sizeof(reqs[i].u.req);
+        for (j = 0; j < reqs[i].data_count; j++)
+        {
+            memcpy( ptr, reqs[i].data[j].ptr, reqs[i].data[j].size );
+            ptr += reqs[i].data[j].size;
+        }
+        ptr = buffer + ((ptr - buffer + 7) & ~7);
+    }
+
+    SERVER_START_REQ( batch_requests )
+    {
+        wine_server_add_data( req, buffer, size );
+        wine_server_set_reply( req, buffer + size, reply_size );
+        if (!(ret = wine_server_call( req ))) done = reply->count;
+    }
+    SERVER_END_REQ;
+
+    for (i = 0, ptr = buffer + size; i < done; i++)
+    {
+        memcpy( &reqs[i].u.reply, ptr, sizeof(reqs[i].u.reply) );
+        ptr += sizeof(reqs[i].u.reply);
+        if ((len = reqs[i].u.reply.reply_header.reply_size))
+        {
+            memcpy( reqs[i].reply_data, ptr, len );
+            ptr += (len + 7) & ~7;
+        }
+    }
+    for ( ; i < count; i++)
+    {
+        memset( &reqs[i].u.reply, 0, sizeof(reqs[i].u.reply) );
+        reqs[i].u.reply.reply_header.error = ret;
+    }
+    free( buffer );
+    return ret;
+}
+
+
 /***********************************************************************
  *           wine_server_call
  *
@@ -977,6 +1042,237 @@ static int remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************/
+/* fast sync slot cache support */
+
+union fast_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        int          slot : 24;  /* slot + 1, or -1 if the object has no slot */
+        unsigned int type : 8;   /* enum fast_sync_type */
+        unsigned int serial;
+    } s;
+};
+
+C_ASSERT( sizeof(union fast_sync_cache_entry) == sizeof(LONG64) );
+
+static union fast_sync_cache_entry *fast_sync_cache[FD_CACHE_ENTRIES];
+
+
+/***********************************************************************
+ *           remove_fast_sync_from_cache
+ */
+static void remove_fast_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && fast_sync_cache[entry])
+        interlocked_xchg64( &fast_sync_cache[entry][idx].data, 0 );
+}
+
+
+/***********************************************************************
+ *           server_get_fast_sync_slot
+ *
+ * Retrieve the slot of an object in the shared fast sync state.
+ * Returns FALSE if the object doesn't have one.
+ */
+BOOL server_get_fast_sync_slot( HANDLE handle, unsigned int *slot, unsigned int *serial, unsigned int *type )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fast_sync_cache_entry cache;
+    sigset_t sigset;
+    NTSTATUS ret;
+
+    if (entry >= FD_CACHE_ENTRIES) return FALSE;
+
+    if (fast_sync_cache[entry])
+    {
+        cache.data = InterlockedCompareExchange64( &fast_sync_cache[entry][idx].data, 0, 0 );
+        if (cache.data) goto done;
+    }
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (!fast_sync_cache[entry])
+    {
+        void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union fast_sync_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr != MAP_FAILED) fast_sync_cache[entry] = ptr;
+    }
+    cache.data = 0;
+    if (fast_sync_cache[entry] && !(cache.data = fast_sync_cache[entry][idx].data))
+    {
+        SERVER_START_REQ( get_fast_sync_slot )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(ret = wine_server_call( req )))
+            {
+                cache.s.slot = reply->slot == FAST_SYNC_NO_SLOT ? -1 : reply->slot + 1;
+                cache.s.type = reply->type;
+                cache.s.serial = reply->serial;
+            }
+            /* the handle access rights can't change, remember that we can't wait on it */
+            else if (ret == STATUS_ACCESS_DENIED) cache.s.slot = -1;
+        }
+        SERVER_END_REQ;
+        if (cache.data) interlocked_xchg64( &fast_sync_cache[entry][idx].data, cache.data );
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+done:
+    if (cache.s.slot <= 0) return FALSE;
+    *slot = cache.s.slot - 1;
+    *serial = cache.s.serial;
+    *type = cache.s.type;
+    return TRUE;
+}
+
+
+/***********************************************************************/
+/* process memory access cache support */
+
+#define PROCESS_VM_CACHE_READ   1
+#define PROCESS_VM_CACHE_WRITE  2
+
+union process_vm_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        int          pid;          /* Unix pid of the process */
+        unsigned int pidfd  : 30;  /* pidfd + 1, to find out when the process terminates */
+        unsigned int access : 2;   /* PROCESS_VM_CACHE_* accesses checked by the server */
+    } s;
+};
+
+C_ASSERT( sizeof(union process_vm_cache_entry) == sizeof(LONG64) );
+
+static union process_vm_cache_entry *process_vm_cache[FD_CACHE_ENTRIES];
+
+
+/***********************************************************************
+ *           remove_process_vm_from_cache
+ */
+static void remove_process_vm_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union process_vm_cache_entry cache;
+
+    if (entry >= FD_CACHE_ENTRIES || !process_vm_cache[entry]) return;
+    cache.data = interlocked_xchg64( &process_vm_cache[entry][idx].data, 0 );
+    if (cache.data) close( cache.s.pidfd - 1 );
+}
+
+
+/***********************************************************************
+ *           process_vm_cache_alive
+ *
+ * Check that the process of a cache entry is still running; the pid can be reused
+ * once the process is gone, and the pidfd then becomes readable.
+ */
+static BOOL process_vm_cache_alive( union process_vm_cache_entry *ptr, union process_vm_cache_entry cache )
+{
+    struct pollfd pfd;
+
+    pfd.fd = cache.s.pidfd - 1;
+    pfd.events = POLLIN;
+    if (!poll( &pfd, 1, 0 )) return TRUE;
+    if (InterlockedCompareExchange64( &ptr->data, 0, cache.data ) == cache.data) close( pfd.fd );
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           server_get_process_vm_pid
+ *
+ * Retrieve the Unix pid of a process to access its memory directly, once the server
+ * has checked the PROCESS_VM_READ or PROCESS_VM_WRITE access of the handle.
+ * Returns -1 if the memory has to be accessed through the server.
+ */
+int server_get_process_vm_pid( HANDLE process, unsigned int access )
+{
+    unsigned int entry, idx = handle_to_index( process, &entry );
+    unsigned int mask = access == PROCESS_VM_WRITE ? PROCESS_VM_CACHE_WRITE : PROCESS_VM_CACHE_READ;
+    union process_vm_cache_entry cache;
+    sigset_t sigset;
+    int pid = -1;
+
+    if (entry < FD_CACHE_ENTRIES && process_vm_cache[entry])
+    {
+        cache.data = InterlockedCompareExchange64( &process_vm_cache[entry][idx].data, 0, 0 );
+        if (cache.data && (cache.s.access & mask))
+            return process_vm_cache_alive( &process_vm_cache[entry][idx], cache ) ? cache.s.pid : -1;
+    }
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    SERVER_START_REQ( get_process_vm_pid )
+    {
+        req->handle = wine_server_obj_handle( process );
+        req->access = access;
+        if (!wine_server_call( req )) pid = reply->unix_pid;
+    }
+    SERVER_END_REQ;
+
+    if (pid != -1 && entry < FD_CACHE_ENTRIES)
+    {
+        if (!process_vm_cache[entry])
+        {
+            void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union process_vm_cache_entry),
+                                         PROT_READ | PROT_WRITE );
+            if (ptr != MAP_FAILED) process_vm_cache[entry] = ptr;
+        }
+        if (process_vm_cache[entry])
+        {
+            cache.data = process_vm_cache[entry][idx].data;
+            if (cache.data && cache.s.pid == pid)
+            {
+                cache.s.access |= mask;
+                interlocked_xchg64( &process_vm_cache[entry][idx].data, cache.data );
+            }
+#ifdef __NR_pidfd_open
+            else if (!cache.data)
+            {
+                int pidfd = syscall( __NR_pidfd_open, pid, 0 );
+
+                if (pidfd != -1)
+                {
+                    cache.s.pid = pid;
+                    cache.s.pidfd = pidfd + 1;
+                    cache.s.access = mask;
+                    interlocked_xchg64( &process_vm_cache[entry][idx].data, cache.data );
+                }
+            }
+#endif
+        }
+    }
+
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return pid;
+}
+
+
+/***********************************************************************
+ *           server_check_process_vm_pid
+ *
+ * Check after a direct memory access that the pid returned by server_get_process_vm_pid
+ * still belongs to the process, so that the access didn't hit a process reusing it.
+ * Returns FALSE if the memory has to be accessed through the server instead.
+ */
+BOOL server_check_process_vm_pid( HANDLE process, int pid )
+{
+    unsigned int entry, idx = handle_to_index( process, &entry );
+    union process_vm_cache_entry cache;
+
+    if (entry >= FD_CACHE_ENTRIES || !process_vm_cache[entry]) return FALSE;
+    cache.data = InterlockedCompareExchange64( &process_vm_cache[entry][idx].data, 0, 0 );
+    if (!cache.data || cache.s.pid != pid) return FALSE;
+    return process_vm_cache_alive( &process_vm_cache[entry][idx], cache );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1651,7 +1947,11 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        remove_fast_sync_from_cache( source );
+        remove_process_vm_from_cache( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1712,6 +2012,8 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    remove_fast_sync_from_cache( handle );
+    remove_process_vm_from_cache( handle );
 
     SERVER_START_REQ( close_handle )
     {
@@ -27,7 +27,11 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
 #endif
@@ -149,6 +153,8 @@ struct async_transmit_ioctl
     unsigned int head_len;
     unsigned int tail_len;
     LARGE_INTEGER offset;
+    BOOL use_sendfile;          /* file data can be sent with sendfile() */
+    BOOL stream;                /* socket is connection-oriented; data can be coalesced */
 };
 
 static NTSTATUS sock_errno_to_status( int err )
@@ -848,8 +854,23 @@ static BOOL is_icmp_over_dgram( int fd )
 #endif
 }
 
+/* Check whether a request can be done directly on the unix fd, without going
+ * through the server. The server only allows it when the operation can't affect
+ * the socket state it keeps track of, and we only try it when nothing needs to
+ * be reported through the server if the request completes immediately.
+ * sync_event is set when the caller only waits on the event if the request
+ * pends, as ws2_32 does for its synchronous calls. */
+static BOOL sock_can_bypass_server( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                                    int force_async, BOOL sync_event, unsigned int flag )
+{
+    unsigned int flags;
+
+    if (force_async || apc || apc_user || (event && !sync_event)) return FALSE;
+    return get_fast_sync_flags( handle, &flags ) && (flags & flag);
+}
+
 static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user, IO_STATUS_BLOCK *io,
-                           int fd, struct async_recv_ioctl *async, int force_async )
+                           int fd, struct async_recv_ioctl *async, int force_async, BOOL sync_event )
 {
     BOOL nonblocking, alerted;
     ULONG_PTR information;
@@ -867,6 +888,23 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         }
     }
 
+    if (!(async->unix_flags & MSG_OOB) && !async->icmp_over_dgram &&
+        sock_can_bypass_server( handle, event, apc, apc_user, force_async, sync_event, FAST_SYNC_SOCKET_RECV ))
+    {
+        /* only go through the server if we would have to wait for data */
+        status = try_recv( fd, async, &information );
+        if (status != STATUS_DEVICE_NOT_READY)
+        {
+            if (!NT_ERROR(status))
+            {
+                io->Status = status;
+                io->Information = information;
+            }
+            release_fileio( &async->io );
+            return status;
+        }
+    }
+
     SERVER_START_REQ( recv_socket )
     {
         req->force_async = force_async;
@@ -905,7 +943,8 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
 
 static NTSTATUS sock_ioctl_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user, IO_STATUS_BLOCK *io,
                                  int fd, const void *buffers_ptr, unsigned int count, WSABUF *control,
-                                 struct WS_sockaddr *addr, int *addr_len, DWORD *ret_flags, int unix_flags, int force_async )
+                                 struct WS_sockaddr *addr, int *addr_len, DWORD *ret_flags, int unix_flags,
+                                 int force_async, BOOL sync_event )
 {
     struct async_recv_ioctl *async;
     DWORD async_size;
@@ -952,7 +991,7 @@ static NTSTATUS sock_ioctl_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
     async->ret_flags = ret_flags;
     async->icmp_over_dgram = is_icmp_over_dgram( fd );
 
-    return sock_recv( handle, event, apc, apc_user, io, fd, async, force_async );
+    return sock_recv( handle, event, apc, apc_user, io, fd, async, force_async, sync_event );
 }
 
 
@@ -975,7 +1014,7 @@ NTSTATUS sock_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
     async->ret_flags = NULL;
     async->icmp_over_dgram = is_icmp_over_dgram( fd );
 
-    return sock_recv( handle, event, apc, apc_user, io, fd, async, 1 );
+    return sock_recv( handle, event, apc, apc_user, io, fd, async, 1, FALSE );
 }
 
 
@@ -1095,7 +1134,8 @@ static void sock_save_icmp_id( struct async_send_ioctl *async )
 }
 
 static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
-                           IO_STATUS_BLOCK *io, int fd, struct async_send_ioctl *async, int force_async )
+                           IO_STATUS_BLOCK *io, int fd, struct async_send_ioctl *async, int force_async,
+                           BOOL sync_event )
 {
     BOOL nonblocking, alerted;
     ULONG_PTR information;
@@ -1103,6 +1143,25 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
     NTSTATUS status;
     ULONG options;
 
+    if (!(async->unix_flags & MSG_OOB) &&
+        sock_can_bypass_server( handle, event, apc, apc_user, force_async, sync_event, FAST_SYNC_SOCKET_SEND ) &&
+        !is_icmp_over_dgram( fd ))
+    {
+        /* a partial send goes through the server, which knows whether to wait
+         * for the rest; it continues from where we stopped */
+        status = try_send( fd, async );
+        if (status != STATUS_DEVICE_NOT_READY)
+        {
+            if (!NT_ERROR(status))
+            {
+                io->Status = status;
+                io->Information = async->sent_len;
+            }
+            release_fileio( &async->io );
+            return status;
+        }
+    }
+
     SERVER_START_REQ( send_socket )
     {
         req->force_async = force_async;
@@ -1151,7 +1210,8 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
 
 static NTSTATUS sock_ioctl_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
                                  IO_STATUS_BLOCK *io, int fd, const void *buffers_ptr, unsigned int count,
-                                 const struct WS_sockaddr *addr, unsigned int addr_len, int unix_flags, int force_async )
+                                 const struct WS_sockaddr *addr, unsigned int addr_len, int unix_flags,
+                                 int force_async, BOOL sync_event )
 {
     struct async_send_ioctl *async;
     DWORD async_size;
@@ -1189,7 +1249,7 @@ static NTSTATUS sock_ioctl_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
     async->iov_cursor = 0;
     async->sent_len = 0;
 
-    return sock_send( handle, event, apc, apc_user, io, fd, async, force_async );
+    return sock_send( handle, event, apc, apc_user, io, fd, async, force_async, sync_event );
 }
 
 
@@ -1211,7 +1271,7 @@ NTSTATUS sock_write( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
     async->iov_cursor = 0;
     async->sent_len = 0;
 
-    return sock_send( handle, event, apc, apc_user, io, fd, async, 1 );
+    return sock_send( handle, event, apc, apc_user, io, fd, async, 1, FALSE );
 }
 
 
@@ -1223,15 +1283,96 @@ static ssize_t do_send( int fd, const void *buffer, size_t len, int flags )
     return ret;
 }
 
+/* ask the kernel to hold back partial segments if more data follows the data being sent,
+ * i.e. some file data after the buffered one, or the tail; this would merge datagrams,
+ * so only do it for stream sockets */
+static int transmit_more_flag( const struct async_transmit_ioctl *async, int file_fd )
+{
+#ifdef MSG_MORE
+    struct stat st;
+    off_t pos;
+
+    if (!async->stream) return 0;
+    if (async->tail_cursor < async->tail_len) return MSG_MORE;
+    if (!async->file) return 0;
+    if (async->file_len)
+        return async->file_cursor + async->read_len - async->buffer_cursor < async->file_len ? MSG_MORE : 0;
+
+    /* sending the whole file, the data read so far ends at the current position */
+    if (async->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION) pos = async->offset.QuadPart;
+    else if ((pos = lseek( file_fd, 0, SEEK_CUR )) == -1) return 0;
+    if (fstat( file_fd, &st ) == -1 || pos >= st.st_size) return 0;
+    return MSG_MORE;
+#else
+    return 0;
+#endif
+}
+
+/* send file data directly from the page cache, without copying it through the
+ * transmit buffer; returns STATUS_NOT_SUPPORTED if the buffered path must be used */
+static NTSTATUS try_transmit_sendfile( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
+{
+#ifdef __linux__
+    ssize_t ret;
+
+    while (async->file)
+    {
+        size_t count = async->buffer_size;
+        off_t offset;
+
+        if (async->file_len)
+            count = min( count, async->file_len - async->file_cursor );
+
+        TRACE( "sending %zu bytes of file data with sendfile\n", count );
+        do
+        {
+            if (async->offset.QuadPart == FILE_USE_FILE_POINTER_POSITION)
+                ret = sendfile( sock_fd, file_fd, NULL, count );
+            else
+            {
+                offset = async->offset.QuadPart;
+                ret = sendfile( sock_fd, file_fd, &offset, count );
+            }
+        } while (ret < 0 && errno == EINTR);
+
+        if (ret < 0)
+        {
+            if ((errno == EINVAL || errno == ENOSYS) && !async->file_cursor)
+            {
+                TRACE( "sendfile not supported, falling back to buffered transmit\n" );
+                async->use_sendfile = FALSE;
+                return STATUS_NOT_SUPPORTED;
+            }
+            if (errno != EWOULDBLOCK) WARN( "sendfile: %s\n", strerror( errno ) );
+            return sock_errno_to_status( errno );
+        }
+        TRACE( "sendfile returned %zd\n", ret );
+
+        async->file_cursor += ret;
+        if (async->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            async->offset.QuadPart += ret;
+
+        if (!ret || (async->file_len && async->file_cursor == async->file_len))
+            async->file = NULL;
+    }
+    return STATUS_SUCCESS;
+#else
+    async->use_sendfile = FALSE;
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
 static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
 {
+    NTSTATUS status;
     ssize_t ret;
 
     while (async->head_cursor < async->head_len)
     {
         TRACE( "sending %u bytes of header data\n", async->head_len - async->head_cursor );
         ret = do_send( sock_fd, async->head + async->head_cursor,
-                       async->head_len - async->head_cursor, 0 );
+                       async->head_len - async->head_cursor,
+                       transmit_more_flag( async, file_fd ) );
         if (ret < 0) return sock_errno_to_status( errno );
         TRACE( "send returned %zd\n", ret );
         async->head_cursor += ret;
@@ -1241,13 +1382,20 @@ static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_io
     {
         TRACE( "sending %u bytes of file data\n", async->read_len - async->buffer_cursor );
         ret = do_send( sock_fd, async->buffer + async->buffer_cursor,
-                       async->read_len - async->buffer_cursor, 0 );
+                       async->read_len - async->buffer_cursor,
+                       transmit_more_flag( async, file_fd ) );
         if (ret < 0) return sock_errno_to_status( errno );
         TRACE( "send returned %zd\n", ret );
         async->buffer_cursor += ret;
         async->file_cursor += ret;
     }
 
+    if (async->file && async->use_sendfile)
+    {
+        status = try_transmit_sendfile( sock_fd, file_fd, async );
+        if (status != STATUS_SUCCESS && status != STATUS_NOT_SUPPORTED) return status;
+    }
+
     if (async->file && async->buffer_cursor == async->read_len)
     {
         unsigned int read_size = async->buffer_size;
@@ -1328,7 +1476,10 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     struct async_transmit_ioctl *async;
     enum server_fd_type file_type;
     union unix_sockaddr addr;
-    socklen_t addr_len;
+    socklen_t addr_len, type_len;
+    BOOL use_sendfile = FALSE;
+    int sock_type;
+    struct stat st;
     HANDLE wait_handle;
     NTSTATUS status;
     ULONG_PTR information;
@@ -1343,6 +1494,7 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     {
         if ((status = server_get_unix_fd( ULongToHandle( params->file ), 0, &file_fd, &file_needs_close, &file_type, NULL )))
             return status;
+        use_sendfile = !fstat( file_fd, &st ) && S_ISREG( st.st_mode );
         if (file_needs_close) close( file_fd );
 
         if (file_type != FD_TYPE_FILE)
@@ -1352,6 +1504,10 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
         }
     }
 
+    type_len = sizeof(sock_type);
+    if (getsockopt( fd, SOL_SOCKET, SO_TYPE, (char *)&sock_type, &type_len ) != 0)
+        sock_type = SOCK_DGRAM;
+
     if (!(async = (struct async_transmit_ioctl *)alloc_fileio( sizeof(*async), async_transmit_proc, handle )))
         return STATUS_NO_MEMORY;
 
@@ -1374,6 +1530,8 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     async->tail = u64_to_user_ptr(params->tail_ptr);
     async->tail_len = params->tail_len;
     async->offset = params->offset;
+    async->use_sendfile = use_sendfile;
+    async->stream = sock_type == SOCK_STREAM;
 
     SERVER_START_REQ( send_socket )
     {
@@ -1599,7 +1757,8 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
             if (params.msg_flags & AFD_MSG_WAITALL)
                 FIXME( "MSG_WAITALL is not supported\n" );
             status = sock_ioctl_recv( handle, event, apc, apc_user, io, fd, params.buffers, params.count, NULL,
-                                      NULL, NULL, NULL, unix_flags, !!(params.recv_flags & AFD_RECV_FORCE_ASYNC) );
+                                      NULL, NULL, NULL, unix_flags, !!(params.recv_flags & AFD_RECV_FORCE_ASYNC),
+                                      FALSE );
             if (needs_close) close( fd );
             return status;
         }
@@ -1628,7 +1787,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
             status = sock_ioctl_recv( handle, event, apc, apc_user, io, fd, u64_to_user_ptr(params->buffers_ptr),
                                       params->count, u64_to_user_ptr(params->control_ptr),
                                       u64_to_user_ptr(params->addr_ptr), u64_to_user_ptr(params->addr_len_ptr),
-                                      ws_flags, unix_flags, params->force_async );
+                                      ws_flags, unix_flags, params->force_async, TRUE );
             if (needs_close) close( fd );
             return status;
         }
@@ -1655,7 +1814,7 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
                 FIXME( "unknown flags %#x\n", params->ws_flags );
             status = sock_ioctl_send( handle, event, apc, apc_user, io, fd, u64_to_user_ptr( params->buffers_ptr ),
                                       params->count, u64_to_user_ptr( params->addr_ptr ), params->addr_len,
-                                      unix_flags, params->force_async );
+                                      unix_flags, params->force_async, TRUE );
             if (needs_close) close( fd );
             return status;
         }
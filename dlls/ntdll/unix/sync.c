@@ -1411,6 +1411,139 @@ NTSTATUS WINAPI NtQueryTimer( HANDLE handle, TIMER_INFORMATION_CLASS class,
 }
 
 
+/* map the shared state of synchronization objects and sockets maintained by the server */
+static fast_sync_slot_t *get_fast_sync_state(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','f','a','s','t','_','s','y','n','c',0};
+    static fast_sync_slot_t *fast_sync_state;
+    static BOOL failed;
+    UNICODE_STRING name_str = { sizeof(nameW) - sizeof(WCHAR), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr = { sizeof(attr), 0, &name_str };
+    size_t size = FAST_SYNC_SLOTS * sizeof(*fast_sync_state);
+    HANDLE section;
+    void *ptr = MAP_FAILED;
+    int fd, needs_close;
+
+    if (fast_sync_state || failed) return fast_sync_state;
+
+    if (!NtOpenSection( &section, SECTION_MAP_READ | SECTION_MAP_WRITE, &attr ))
+    {
+        if (!server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+        {
+            ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            if (needs_close) close( fd );
+        }
+        NtClose( section );
+    }
+    if (ptr == MAP_FAILED)
+    {
+        WARN( "fast sync state not available\n" );
+        failed = TRUE;
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&fast_sync_state, ptr, NULL )) munmap( ptr, size );
+    return fast_sync_state;
+}
+
+/* get the state of an object in the fast sync state, return NULL if it isn't available */
+static fast_sync_slot_t *get_fast_sync( HANDLE handle, unsigned int *serial, unsigned int *type )
+{
+    fast_sync_slot_t *state;
+    unsigned int slot;
+
+    if (!server_get_fast_sync_slot( handle, &slot, serial, type )) return NULL;
+    if (!(state = get_fast_sync_state())) return NULL;
+    return &state[slot];
+}
+
+/* get the FAST_SYNC_SOCKET_* flags of a socket, return FALSE if they aren't available */
+BOOL get_fast_sync_flags( HANDLE handle, unsigned int *flags )
+{
+    fast_sync_slot_t *sync;
+    unsigned int serial, type;
+    LONG64 state;
+
+    if (!(sync = get_fast_sync( handle, &serial, &type )) || type != FAST_SYNC_SOCKET) return FALSE;
+    state = InterlockedCompareExchange64( (LONG64 *)&sync->state, 0, 0 );
+    /* the slot has been reused, the handle must have been closed behind our back */
+    if ((ULONG)(state >> 32) != serial) return FALSE;
+    *flags = (ULONG)state & ~FAST_SYNC_LOCKED;
+    return TRUE;
+}
+
+/* try to acquire an object through the fast sync state; returns STATUS_TIMEOUT if
+ * it isn't signaled, and STATUS_NOT_IMPLEMENTED if the server has to be asked */
+static NTSTATUS fast_sync_acquire( HANDLE handle )
+{
+    ULONG tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    fast_sync_slot_t *sync;
+    unsigned int serial, type, value;
+    LONG64 old, new;
+
+    if (!(sync = get_fast_sync( handle, &serial, &type ))) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = InterlockedCompareExchange64( (LONG64 *)&sync->state, 0, 0 );
+        /* the slot has been reused, the handle must have been closed behind our back */
+        if ((ULONG)(old >> 32) != serial) return STATUS_NOT_IMPLEMENTED;
+        /* the server is checking a wait on the object */
+        if ((value = (ULONG)old) & FAST_SYNC_LOCKED) return STATUS_NOT_IMPLEMENTED;
+
+        switch (type)
+        {
+        case FAST_SYNC_MANUAL_EVENT:
+            return value ? STATUS_SUCCESS : STATUS_TIMEOUT;
+        case FAST_SYNC_AUTO_EVENT:
+        case FAST_SYNC_SEMAPHORE:
+            if (!value) return STATUS_TIMEOUT;
+            new = old - 1;
+            break;
+        case FAST_SYNC_MUTEX:
+            if (value == tid)
+            {
+                /* only the owner modifies the recursion count, let the server handle overflows */
+                if (sync->count >= 0x7fffffff) return STATUS_NOT_IMPLEMENTED;
+                sync->count++;
+                return STATUS_SUCCESS;
+            }
+            if (value) return STATUS_TIMEOUT;
+            new = old | tid;
+            break;
+        default:
+            return STATUS_NOT_IMPLEMENTED;
+        }
+    } while (InterlockedCompareExchange64( (LONG64 *)&sync->state, new, old ) != old);
+
+    if (type != FAST_SYNC_MUTEX) return STATUS_SUCCESS;
+    sync->count = 1;
+    return InterlockedExchange( (LONG *)&sync->abandoned, 0 ) ? STATUS_ABANDONED : STATUS_SUCCESS;
+}
+
+/* try to satisfy a wait without a server round trip */
+static BOOL fast_sync_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any, BOOLEAN alertable,
+                            NTSTATUS *ret )
+{
+    NTSTATUS status;
+    UINT i;
+
+    /* the server has to deliver the pending user APCs first */
+    if (alertable) return FALSE;
+    /* the objects can't be checked all at once, so leave wait-all to the server */
+    if (!wait_any && count > 1) return FALSE;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((status = fast_sync_acquire( handles[i] )) == STATUS_NOT_IMPLEMENTED) return FALSE;
+        if (status == STATUS_TIMEOUT) continue;
+        *ret = (status == STATUS_ABANDONED ? STATUS_ABANDONED_WAIT_0 : STATUS_WAIT_0) + i;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
 /******************************************************************
  *		NtWaitForMultipleObjects (NTDLL.@)
  */
@@ -1419,9 +1552,16 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if (fast_sync_wait( count, handles, wait_any, alertable, &ret ))
+    {
+        TRACE( "%u objects, wait satisfied without a server call\n", count );
+        return ret;
+    }
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
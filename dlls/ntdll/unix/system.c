@@ -2098,21 +2098,11 @@ static BOOL match_tz_name( const char *tz_name, const RTL_DYNAMIC_TIME_ZONE_INFO
     return TRUE;
 }
 
-static BOOL reg_query_value( HKEY key, LPCWSTR name, DWORD type, void *data, DWORD count )
+static BOOL get_tz_value( const struct key_value_query *query, DWORD type, void *data, DWORD count )
 {
-    char buf[256];
-    UNICODE_STRING nameW;
-    KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buf;
-
-    if (count > sizeof(buf) - offsetof(KEY_VALUE_PARTIAL_INFORMATION, Data)) return FALSE;
-
-    nameW.Buffer = (WCHAR *)name;
-    nameW.Length = wcslen( name ) * sizeof(WCHAR);
-    if (NtQueryValueKey( key, &nameW, KeyValuePartialInformation, buf, sizeof(buf), &count ))
-        return FALSE;
-
-    if (info->Type != type) return FALSE;
-    memcpy( data, info->Data, info->DataLength );
+    if (query->status) return FALSE;
+    if (query->info->Type != type || query->info->DataLength > count) return FALSE;
+    memcpy( data, query->info->Data, query->info->DataLength );
     return TRUE;
 }
 
@@ -2130,13 +2120,16 @@ static void find_reg_tz_info(RTL_DYNAMIC_TIME_ZONE_INFORMATION *tzi, const char*
         'W','i','n','d','o','w','s',' ','N','T','\\',
         'C','u','r','r','e','n','t','V','e','r','s','i','o','n','\\',
         'T','i','m','e',' ','Z','o','n','e','s',0 };
-    static const WCHAR Dynamic_DstW[] = { 'D','y','n','a','m','i','c',' ','D','S','T',0 };
+    static const WCHAR Dynamic_DstW[] = { '\\','D','y','n','a','m','i','c',' ','D','S','T',0 };
+    static const WCHAR * const value_names[] = { mui_stdW, stdW, mui_dltW, dltW, tziW };
     RTL_DYNAMIC_TIME_ZONE_INFORMATION reg_tzi;
-    HANDLE key, subkey, subkey_dyn = 0;
-    ULONG idx, len;
+    struct key_value_query queries[ARRAY_SIZE(value_names)], dyn_query;
+    ULONG buffers[ARRAY_SIZE(value_names) + 1][64];
+    HANDLE key;
+    ULONG i, idx, len;
     OBJECT_ATTRIBUTES attr;
     UNICODE_STRING nameW;
-    WCHAR yearW[16];
+    WCHAR yearW[16], dyn_name[64 + ARRAY_SIZE(Dynamic_DstW)];
     char buffer[128];
     KEY_BASIC_INFORMATION *info = (KEY_BASIC_INFORMATION *)buffer;
 
@@ -2146,6 +2139,14 @@ static void find_reg_tz_info(RTL_DYNAMIC_TIME_ZONE_INFORMATION *tzi, const char*
     InitializeObjectAttributes( &attr, &nameW, 0, 0, NULL );
     if (NtOpenKey( &key, KEY_READ, &attr )) return;
 
+    for (i = 0; i < ARRAY_SIZE(value_names); i++)
+    {
+        init_unicode_string( &queries[i].name, value_names[i] );
+        queries[i].info = (KEY_VALUE_PARTIAL_INFORMATION *)buffers[i];
+    }
+    init_unicode_string( &dyn_query.name, yearW );
+    dyn_query.info = (KEY_VALUE_PARTIAL_INFORMATION *)buffers[i];
+
     idx = 0;
     while (!NtEnumerateKey( key, idx++, KeyBasicInformation, buffer, sizeof(buffer), &len ))
     {
@@ -2159,34 +2160,38 @@ static void find_reg_tz_info(RTL_DYNAMIC_TIME_ZONE_INFORMATION *tzi, const char*
         } tz_data;
         BOOL is_dynamic = FALSE;
 
+        /* open the zone key, read all its values and close it in a single round trip */
+        for (i = 0; i < ARRAY_SIZE(queries); i++) queries[i].size = sizeof(buffers[i]);
         nameW.Buffer = info->Name;
         nameW.Length = info->NameLength;
         attr.RootDirectory = key;
-        if (NtOpenKey( &subkey, KEY_READ, &attr )) continue;
+        if (query_key_values( &attr, KEY_READ, queries, ARRAY_SIZE(queries) )) continue;
 
         memset( &reg_tzi, 0, sizeof(reg_tzi) );
         memcpy(reg_tzi.TimeZoneKeyName, nameW.Buffer, nameW.Length);
         reg_tzi.TimeZoneKeyName[nameW.Length/sizeof(WCHAR)] = 0;
 
-        if (!reg_query_value(subkey, mui_stdW, REG_SZ, reg_tzi.StandardName, sizeof(reg_tzi.StandardName)) &&
-            !reg_query_value(subkey, stdW, REG_SZ, reg_tzi.StandardName, sizeof(reg_tzi.StandardName)))
-            goto next;
+        if (!get_tz_value( &queries[0], REG_SZ, reg_tzi.StandardName, sizeof(reg_tzi.StandardName) ) &&
+            !get_tz_value( &queries[1], REG_SZ, reg_tzi.StandardName, sizeof(reg_tzi.StandardName) ))
+            continue;
 
-        if (!reg_query_value(subkey, mui_dltW, REG_SZ, reg_tzi.DaylightName, sizeof(reg_tzi.DaylightName)) &&
-            !reg_query_value(subkey, dltW, REG_SZ, reg_tzi.DaylightName, sizeof(reg_tzi.DaylightName)))
-            goto next;
+        if (!get_tz_value( &queries[2], REG_SZ, reg_tzi.DaylightName, sizeof(reg_tzi.DaylightName) ) &&
+            !get_tz_value( &queries[3], REG_SZ, reg_tzi.DaylightName, sizeof(reg_tzi.DaylightName) ))
+            continue;
 
         /* Check for Dynamic DST entry first */
-        nameW.Buffer = (WCHAR *)Dynamic_DstW;
-        nameW.Length = sizeof(Dynamic_DstW) - sizeof(WCHAR);
-        attr.RootDirectory = subkey;
-        if (!NtOpenKey( &subkey_dyn, KEY_READ, &attr ))
+        if (nameW.Length < sizeof(dyn_name) - sizeof(Dynamic_DstW))
         {
-            is_dynamic = reg_query_value( subkey_dyn, yearW, REG_BINARY, &tz_data, sizeof(tz_data) );
-            NtClose( subkey_dyn );
+            memcpy( dyn_name, nameW.Buffer, nameW.Length );
+            memcpy( dyn_name + nameW.Length / sizeof(WCHAR), Dynamic_DstW, sizeof(Dynamic_DstW) );
+            nameW.Buffer = dyn_name;
+            nameW.Length += sizeof(Dynamic_DstW) - sizeof(WCHAR);
+            dyn_query.size = sizeof(buffers[0]);
+            if (!query_key_values( &attr, KEY_READ, &dyn_query, 1 ))
+                is_dynamic = get_tz_value( &dyn_query, REG_BINARY, &tz_data, sizeof(tz_data) );
         }
-        if (!is_dynamic && !reg_query_value( subkey, tziW, REG_BINARY, &tz_data, sizeof(tz_data) ))
-            goto next;
+        if (!is_dynamic && !get_tz_value( &queries[4], REG_BINARY, &tz_data, sizeof(tz_data) ))
+            continue;
 
         reg_tzi.Bias = tz_data.bias;
         reg_tzi.StandardBias = tz_data.std_bias;
@@ -2194,7 +2199,7 @@ static void find_reg_tz_info(RTL_DYNAMIC_TIME_ZONE_INFORMATION *tzi, const char*
         reg_tzi.StandardDate = tz_data.std_date;
         reg_tzi.DaylightDate = tz_data.dlt_date;
 
-        TRACE("%s: bias %d\n", debugstr_us(&nameW), reg_tzi.Bias);
+        TRACE("%s: bias %d\n", debugstr_w(reg_tzi.TimeZoneKeyName), reg_tzi.Bias);
         TRACE("std (d/m/y): %u/%02u/%04u day of week %u %u:%02u:%02u.%03u bias %d\n",
               reg_tzi.StandardDate.wDay, reg_tzi.StandardDate.wMonth,
               reg_tzi.StandardDate.wYear, reg_tzi.StandardDate.wDayOfWeek,
@@ -2211,12 +2216,9 @@ static void find_reg_tz_info(RTL_DYNAMIC_TIME_ZONE_INFORMATION *tzi, const char*
         if (match_tz_info( tzi, &reg_tzi ) && match_tz_name( tz_name, &reg_tzi ))
         {
             *tzi = reg_tzi;
-            NtClose( subkey );
             NtClose( key );
             return;
         }
-    next:
-        NtClose( subkey );
     }
     NtClose( key );
 
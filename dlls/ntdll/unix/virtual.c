@@ -54,6 +54,15 @@
 #ifdef HAVE_LIBPROCSTAT_H
 # include <libprocstat.h>
 #endif
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <sys/uio.h>
+#endif
+#ifdef HAVE_LINUX_USERFAULTFD_H
+# include <sys/ioctl.h>
+# include <linux/fs.h>
+# include <linux/userfaultfd.h>
+#endif
 #include <unistd.h>
 #include <dlfcn.h>
 #ifdef HAVE_VALGRIND_VALGRIND_H
@@ -121,6 +130,7 @@ struct file_view
 #define VPROT_WRITEWATCH 0x40
 /* per-mapping protection flags */
 #define VPROT_SYSTEM     0x0200  /* system view (underlying mmap not under our control) */
+#define VPROT_KERNEL_WRITEWATCH 0x0400  /* written pages are tracked by the kernel */
 
 /* Conversion from VPROT_* to Win32 flags */
 static const BYTE VIRTUAL_Win32Flags[16] =
@@ -144,7 +154,15 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 };
 
 static struct wine_rb_tree views_tree;
-static pthread_mutex_t virtual_mutex;
+static pthread_mutex_t virtual_mutex;  /* serializes changes to the views and page protections */
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+static pthread_rwlock_t virtual_rwlock = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+#else
+static pthread_rwlock_t virtual_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+static unsigned int virtual_update_depth;  /* nesting of views updates, protected by virtual_mutex */
+static unsigned int startup_lock_depth;  /* depth of the virtual lock before the first TEB is set up */
+static BOOL teb_lock_depth;  /* whether the depth of the virtual lock is stored in the TEB */
 
 static const UINT page_shift = 12;
 static const UINT_PTR page_mask = 0xfff;
@@ -215,6 +233,116 @@ static struct range_entry *free_ranges;
 static struct range_entry *free_ranges_end;
 
 
+/* The views, the page protections and the reserved areas are modified with virtual_mutex held,
+ * and additionally with virtual_rwlock write-locked while the structures are being updated.
+ * Shared sections only read-lock virtual_rwlock, so they don't wait for the slow parts of the
+ * exclusive sections (mapping files, server calls); they can see an operation of another thread
+ * half done, but never an inconsistent views tree. Since a shared section holds virtual_rwlock,
+ * it must not take the lock exclusively, which means that it must not touch any memory that can
+ * fault into virtual_handle_fault. */
+
+#define VIRTUAL_LOCK_SHARED     0x00001  /* one level of shared lock */
+#define VIRTUAL_LOCK_EXCLUSIVE  0x10000  /* one level of exclusive lock */
+
+/* the depth is also needed in the fault handler, so it's kept in the thread data rather than
+ * in pthread specific data; the first thread uses the lock before its TEB is set up */
+static inline unsigned int *virtual_lock_depth(void)
+{
+    if (!teb_lock_depth) return &startup_lock_depth;
+    return &ntdll_get_thread_data()->virtual_lock_depth;
+}
+
+
+/***********************************************************************
+ *           virtual_lock_exclusive
+ *
+ * Take the virtual lock for modifying the views or the page protections.
+ * Signals are blocked unless sigset is NULL (inside a signal handler).
+ */
+static void virtual_lock_exclusive( sigset_t *sigset )
+{
+    unsigned int *depth;
+
+    if (sigset) pthread_sigmask( SIG_BLOCK, &server_block_set, sigset );
+    if (process_exiting) return;
+    depth = virtual_lock_depth();
+    /* upgrading a shared lock would deadlock on the first update */
+    assert( !*depth || *depth >= VIRTUAL_LOCK_EXCLUSIVE );
+    pthread_mutex_lock( &virtual_mutex );
+    *depth += VIRTUAL_LOCK_EXCLUSIVE;
+}
+
+
+/***********************************************************************
+ *           virtual_unlock_exclusive
+ */
+static void virtual_unlock_exclusive( sigset_t *sigset )
+{
+    if (!process_exiting)
+    {
+        *virtual_lock_depth() -= VIRTUAL_LOCK_EXCLUSIVE;
+        pthread_mutex_unlock( &virtual_mutex );
+    }
+    if (sigset) pthread_sigmask( SIG_SETMASK, sigset, NULL );
+}
+
+
+/***********************************************************************
+ *           virtual_lock_shared
+ *
+ * Take the virtual lock for only looking at the views and the page protections.
+ * Nested in an exclusive or shared section of the same thread, it has nothing to lock.
+ */
+static void virtual_lock_shared( sigset_t *sigset )
+{
+    unsigned int *depth;
+
+    if (sigset) pthread_sigmask( SIG_BLOCK, &server_block_set, sigset );
+    if (process_exiting) return;
+    depth = virtual_lock_depth();
+    if (!*depth) pthread_rwlock_rdlock( &virtual_rwlock );
+    *depth += VIRTUAL_LOCK_SHARED;
+}
+
+
+/***********************************************************************
+ *           virtual_unlock_shared
+ */
+static void virtual_unlock_shared( sigset_t *sigset )
+{
+    unsigned int *depth;
+
+    if (!process_exiting)
+    {
+        depth = virtual_lock_depth();
+        *depth -= VIRTUAL_LOCK_SHARED;
+        if (!*depth) pthread_rwlock_unlock( &virtual_rwlock );
+    }
+    if (sigset) pthread_sigmask( SIG_SETMASK, sigset, NULL );
+}
+
+
+/***********************************************************************
+ *           views_update_begin
+ *
+ * Start modifying the views, the page protections or the reserved areas.
+ * virtual_mutex must be held by caller.
+ */
+static void views_update_begin(void)
+{
+    if (!virtual_update_depth++) pthread_rwlock_wrlock( &virtual_rwlock );
+}
+
+
+/***********************************************************************
+ *           views_update_end
+ */
+static void views_update_end(void)
+{
+    if (!--virtual_update_depth) pthread_rwlock_unlock( &virtual_rwlock );
+}
+
+
 static inline BOOL is_beyond_limit( const void *addr, size_t size, const void *limit )
 {
     return (addr >= limit || (const char *)addr + size > (const char *)limit);
@@ -619,7 +747,7 @@ void *get_builtin_so_handle( void *module )
     void *ret = NULL;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -627,7 +755,7 @@ void *get_builtin_so_handle( void *module )
         if (ret) builtin->refcount++;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return ret;
 }
 
@@ -642,7 +770,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, void **funcs )
     NTSTATUS status = STATUS_DLL_NOT_FOUND;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -653,7 +781,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, void **funcs )
         }
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
@@ -669,7 +797,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
     struct builtin_module *builtin;
 
     if (!(handle = dlopen( name, RTLD_NOW ))) return status;
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -681,7 +809,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
         else status = STATUS_IMAGE_ALREADY_LOADED;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     if (status) dlclose( handle );
     return status;
 }
@@ -938,6 +1066,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    views_update_begin();
 #ifdef _WIN64
     while (idx >> pages_vprot_shift != end >> pages_vprot_shift)
     {
@@ -949,6 +1078,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
 #else
     memset( pages_vprot + idx, vprot, end - idx );
 #endif
+    views_update_end();
 }
 
 
@@ -962,6 +1092,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    views_update_begin();
 #ifdef _WIN64
     for ( ; idx < end; idx++)
     {
@@ -971,6 +1102,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
 #else
     for ( ; idx < end; idx++) pages_vprot[idx] = (pages_vprot[idx] & ~clear) | set;
 #endif
+    views_update_end();
 }
 
 
@@ -993,7 +1125,9 @@ static BOOL alloc_pages_vprot( const void *addr, size_t size )
         if (pages_vprot[i]) continue;
         if ((ptr = anon_mmap_alloc( pages_vprot_mask + 1, PROT_READ | PROT_WRITE )) == MAP_FAILED)
             return FALSE;
+        views_update_begin();
         pages_vprot[i] = ptr;
+        views_update_end();
     }
 #endif
     return TRUE;
@@ -1099,12 +1233,12 @@ static void VIRTUAL_Dump(void)
     struct file_view *view;
 
     TRACE( "Dump of all virtual memory views:\n" );
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
     {
         dump_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 }
 #endif
 
@@ -1391,7 +1525,9 @@ static void add_reserved_area( void *addr, size_t size )
     }
     /* blow away existing mappings */
     anon_mmap_fixed( addr, size, PROT_NONE, MAP_NORESERVE );
+    views_update_begin();
     mmap_add_reserved_area( addr, size );
+    views_update_end();
 }
 
 
@@ -1406,7 +1542,9 @@ static void remove_reserved_area( void *addr, size_t size )
     struct file_view *view;
 
     TRACE( "removing %p-%p\n", addr, (char *)addr + size );
+    views_update_begin();
     mmap_remove_reserved_area( addr, size );
+    views_update_end();
 
     /* unmap areas not covered by an existing view */
     WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
@@ -1527,10 +1665,12 @@ static struct file_view *alloc_view(void)
 static void delete_view( struct file_view *view ) /* [in] View */
 {
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
+    views_update_begin();
     set_page_vprot( view->base, view->size, 0 );
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_remove_view( view );
     wine_rb_remove( &views_tree, &view->entry );
+    views_update_end();
     *(struct file_view **)view = next_free_view;
     next_free_view = view;
 }
@@ -1574,11 +1714,13 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
     view->base    = base;
     view->size    = size;
     view->protect = vprot;
-    set_page_vprot( base, size, vprot );
 
+    views_update_begin();
+    set_page_vprot( base, size, vprot );
     wine_rb_put( &views_tree, view->base, &view->entry );
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_insert_view( view );
+    views_update_end();
 
     *view_ret = view;
 
@@ -1745,6 +1887,199 @@ static NTSTATUS set_protection( struct file_view *view, void *base, SIZE_T size,
 }
 
 
+#if defined(HAVE_LINUX_USERFAULTFD_H) && defined(UFFD_FEATURE_WP_ASYNC) && defined(PAGEMAP_SCAN)
+
+static int uffd_fd = -1;
+static int pagemap_scan_fd = -1;
+
+/***********************************************************************
+ *           kernel_writewatch_init
+ *
+ * Check for userfaultfd asynchronous write protection and the pagemap
+ * scan ioctl, which let the kernel track written pages without a signal
+ * for each first write.
+ */
+static void kernel_writewatch_init(void)
+{
+    struct uffdio_api uffdio_api;
+    int fd;
+
+    if ((fd = syscall( __NR_userfaultfd, UFFD_USER_MODE_ONLY | O_CLOEXEC | O_NONBLOCK )) == -1) return;
+
+    uffdio_api.api = UFFD_API;
+    uffdio_api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    if (ioctl( fd, UFFDIO_API, &uffdio_api ) == -1 || uffdio_api.api != UFFD_API)
+    {
+        close( fd );
+        return;
+    }
+    if ((pagemap_scan_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1)
+    {
+        close( fd );
+        return;
+    }
+    uffd_fd = fd;
+    TRACE( "using kernel write watches\n" );
+}
+
+/***********************************************************************
+ *           kernel_writewatch_protect
+ *
+ * Mark all pages in a registered range as not written.
+ */
+static BOOL kernel_writewatch_protect( void *base, size_t size )
+{
+    struct uffdio_writeprotect wp;
+
+    wp.range.start = (UINT_PTR)base;
+    wp.range.len = size;
+    wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp ) == -1)
+    {
+        ERR( "failed to write protect %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           kernel_writewatch_register
+ *
+ * Register a range for kernel write tracking, with all pages marked as
+ * not written.
+ */
+static BOOL kernel_writewatch_register( void *base, size_t size )
+{
+    struct uffdio_register uffdio_register;
+
+    if (uffd_fd == -1) return FALSE;
+
+    /* huge pages would be reported as written as a whole */
+    madvise( base, size, MADV_NOHUGEPAGE );
+
+    uffdio_register.range.start = (UINT_PTR)base;
+    uffdio_register.range.len = size;
+    uffdio_register.mode = UFFDIO_REGISTER_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_REGISTER, &uffdio_register ) == -1)
+    {
+        WARN( "failed to register %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+        return FALSE;
+    }
+    if (!kernel_writewatch_protect( base, size ))
+    {
+        ioctl( uffd_fd, UFFDIO_UNREGISTER, &uffdio_register.range );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           kernel_get_write_watches
+ *
+ * Retrieve the written pages of a range, and optionally mark them as
+ * not written again.
+ */
+static void kernel_get_write_watches( void *base, size_t size, void **addresses, ULONG_PTR *count,
+                                      BOOL reset )
+{
+    struct page_region regions[64];
+    struct pm_scan_arg arg;
+    char *addr = base, *end = addr + size;
+    ULONG_PTR pos = 0;
+    UINT64 page;
+    int i, ret;
+
+    memset( &arg, 0, sizeof(arg) );
+    arg.size = sizeof(arg);
+    arg.flags = reset ? PM_SCAN_WP_MATCHING : 0;
+    arg.vec = (UINT_PTR)regions;
+    arg.vec_len = ARRAY_SIZE(regions);
+    arg.category_mask = PAGE_IS_WRITTEN;
+    arg.return_mask = PAGE_IS_WRITTEN;
+
+    while (pos < *count && addr < end)
+    {
+        arg.start = (UINT_PTR)addr;
+        arg.end = (UINT_PTR)end;
+        arg.max_pages = *count - pos;
+        if ((ret = ioctl( pagemap_scan_fd, PAGEMAP_SCAN, &arg )) == -1)
+        {
+            ERR( "failed to scan %p-%p: %s\n", addr, end, strerror( errno ));
+            break;
+        }
+        for (i = 0; i < ret; i++)
+            for (page = regions[i].start; page < regions[i].end; page += page_size)
+                addresses[pos++] = (void *)(UINT_PTR)page;
+        addr = (char *)(UINT_PTR)arg.walk_end;
+    }
+    *count = pos;
+}
+
+/***********************************************************************
+ *           kernel_reset_write_watches
+ */
+static void kernel_reset_write_watches( void *base, size_t size )
+{
+    struct pm_scan_arg arg;
+
+    memset( &arg, 0, sizeof(arg) );
+    arg.size = sizeof(arg);
+    arg.flags = PM_SCAN_WP_MATCHING;
+    arg.start = (UINT_PTR)base;
+    arg.end = (UINT_PTR)base + size;
+    arg.category_mask = PAGE_IS_WRITTEN;
+    arg.return_mask = PAGE_IS_WRITTEN;
+    if (ioctl( pagemap_scan_fd, PAGEMAP_SCAN, &arg ) == -1)
+        ERR( "failed to reset %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+}
+
+#else  /* HAVE_LINUX_USERFAULTFD_H */
+
+static void kernel_writewatch_init(void)
+{
+}
+
+static BOOL kernel_writewatch_protect( void *base, size_t size )
+{
+    return FALSE;
+}
+
+static BOOL kernel_writewatch_register( void *base, size_t size )
+{
+    return FALSE;
+}
+
+static void kernel_get_write_watches( void *base, size_t size, void **addresses, ULONG_PTR *count,
+                                      BOOL reset )
+{
+    *count = 0;
+}
+
+static void kernel_reset_write_watches( void *base, size_t size )
+{
+}
+
+#endif  /* HAVE_LINUX_USERFAULTFD_H */
+
+
+/***********************************************************************
+ *           enable_kernel_write_watches
+ *
+ * Switch a write watch view to kernel tracking when available; the
+ * pages then stay writable instead of faulting on the first write.
+ */
+static void enable_kernel_write_watches( struct file_view *view )
+{
+    if (!kernel_writewatch_register( view->base, view->size )) return;
+
+    views_update_begin();
+    view->protect |= VPROT_KERNEL_WRITEWATCH;
+    views_update_end();
+    set_page_vprot_bits( view->base, view->size, 0, VPROT_WRITEWATCH );
+    mprotect_range( view->base, view->size, 0, 0 );
+}
+
+
 /***********************************************************************
  *           update_write_watches
  */
@@ -2029,6 +2364,7 @@ done:
  *
  * Get the size of the committed range with equal masked vprot bytes starting at base.
  * Also return the protections for the first page.
+ * The lock must be held exclusively for SEC_RESERVE views.
  */
 static SIZE_T get_committed_size( struct file_view *view, void *base, BYTE *vprot, BYTE vprot_mask )
 {
@@ -2079,6 +2415,9 @@ static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t siz
     if (anon_mmap_fixed( (char *)view->base + start, size, PROT_NONE, 0 ) != MAP_FAILED)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
+        /* the new mapping has to be registered again */
+        if (view->protect & VPROT_KERNEL_WRITEWATCH)
+            kernel_writewatch_register( (char *)view->base + start, size );
         return STATUS_SUCCESS;
     }
     return STATUS_NO_MEMORY;
@@ -2445,7 +2784,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     }
 
     status = STATUS_INVALID_PARAMETER;
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
     base = wine_server_get_ptr( image_info->base );
     if ((ULONG_PTR)base != image_info->base) base = NULL;
@@ -2480,7 +2819,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
     return status;
@@ -2574,7 +2913,7 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
 
     if ((res = server_get_unix_fd( handle, 0, &unix_handle, &needs_close, NULL, NULL ))) return res;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
     res = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
     if (res) goto done;
@@ -2605,7 +2944,7 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     if (needs_close) close( unix_handle );
     return res;
 }
@@ -2663,6 +3002,7 @@ void virtual_init(void)
             mmap_add_reserved_area( (*preload_info)[i].addr, (*preload_info)[i].size );
 
     mmap_init( preload_info ? *preload_info : NULL );
+    kernel_writewatch_init();
 
     if ((preload = getenv("WINEPRELOADRESERVE")))
     {
@@ -2820,7 +3160,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
     void *base = wine_server_get_ptr( info->base );
     int i;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     status = create_view( &view, base, size, SEC_IMAGE | SEC_FILE | VPROT_SYSTEM |
                           VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY | VPROT_EXEC );
     if (!status)
@@ -2859,7 +3199,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
         }
         else delete_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 
     return status;
 }
@@ -2966,7 +3306,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
     SIZE_T block_size = signal_stack_mask + 1;
     BOOL is_wow = !!NtCurrentTeb()->WowTebOffset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if (next_free_teb)
     {
         ptr = next_free_teb;
@@ -2982,7 +3322,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
             if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, is_win64 && is_wow ? 0x7fffffff : 0,
                                                    &total, MEM_RESERVE, PAGE_READWRITE )))
             {
-                server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                virtual_unlock_exclusive( &sigset );
                 return status;
             }
             teb_block = ptr;
@@ -2993,14 +3333,14 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
                                  MEM_COMMIT, PAGE_READWRITE );
     }
     *ret_teb = teb = init_teb( ptr, is_wow );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 
     if ((status = signal_alloc_thread( teb )))
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock_exclusive( &sigset );
         *(void **)ptr = next_free_teb;
         next_free_teb = ptr;
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock_exclusive( &sigset );
     }
     return status;
 }
@@ -3034,13 +3374,13 @@ void virtual_free_teb( TEB *teb )
         NtFreeVirtualMemory( GetCurrentProcess(), &ptr, &size, MEM_RELEASE );
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     list_remove( &thread_data->entry );
     ptr = teb;
     if (!is_win64) ptr = (char *)ptr - teb_offset;
     *(void **)ptr = next_free_teb;
     next_free_teb = ptr;
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 }
 
 
@@ -3054,7 +3394,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 
     if (index < TLS_MINIMUM_AVAILABLE)
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock_exclusive( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( thread_data, TEB, GdiTebBatch );
@@ -3065,14 +3405,14 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             teb->TlsSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock_exclusive( &sigset );
     }
     else
     {
         index -= TLS_MINIMUM_AVAILABLE;
         if (index >= 8 * sizeof(peb->TlsExpansionBitmapBits)) return STATUS_INVALID_PARAMETER;
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock_exclusive( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( thread_data, TEB, GdiTebBatch );
@@ -3087,7 +3427,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             if (teb->TlsExpansionSlots) teb->TlsExpansionSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock_exclusive( &sigset );
     }
     return STATUS_SUCCESS;
 }
@@ -3111,7 +3451,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     if (size < 1024 * 1024) size = 1024 * 1024;  /* Xlib needs a large stack */
     size = (size + 0xffff) & ~0xffff;  /* round to 64K boundary */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
     if ((status = map_view( &view, NULL, size + extra_size, FALSE,
                             VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, zero_bits )) != STATUS_SUCCESS)
@@ -3152,7 +3492,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     stack->StackBase = (char *)view->base + view->size;
     stack->StackLimit = (char *)view->base + 2 * page_size;
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
@@ -3170,6 +3510,10 @@ void virtual_map_user_shared_data(void)
     HANDLE section;
     int res, fd, needs_close;
 
+    /* the TEB of the main thread is set up by now, and no other thread exists yet */
+    assert( !startup_lock_depth );
+    teb_lock_depth = TRUE;
+
     if ((status = NtOpenSection( &section, SECTION_ALL_ACCESS, &attr )))
     {
         ERR( "failed to open the USD section: %08x\n", status );
@@ -3260,7 +3604,22 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
     char *page = ROUND_ADDR( addr, page_mask );
     BYTE vprot;
 
-    mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+    /* faults that don't change the page state only need the shared lock */
+    virtual_lock_shared( NULL );  /* no need for signal masking inside signal handler */
+    vprot = get_page_vprot( page );
+    if ((is_inside_signal_stack( stack ) || !(vprot & VPROT_GUARD)) &&
+        !((err & EXCEPTION_WRITE_FAULT) && (vprot & VPROT_WRITEWATCH)))
+    {
+        /* ignore fault if page is writable now */
+        if ((err & EXCEPTION_WRITE_FAULT) && (get_unix_prot( vprot ) & PROT_WRITE) &&
+            is_write_watch_range( page, page_size ))
+            ret = STATUS_SUCCESS;
+        virtual_unlock_shared( NULL );
+        return ret;
+    }
+    virtual_unlock_shared( NULL );
+
+    virtual_lock_exclusive( NULL );
     vprot = get_page_vprot( page );
     if (!is_inside_signal_stack( stack ) && (vprot & VPROT_GUARD))
     {
@@ -3287,7 +3646,7 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
                 ret = STATUS_SUCCESS;
         }
     }
-    mutex_unlock( &virtual_mutex );
+    virtual_unlock_exclusive( NULL );
     return ret;
 }
 
@@ -3327,14 +3686,14 @@ void *virtual_setup_exception( void *stack_ptr, size_t size, EXCEPTION_RECORD *r
     }
     else if (stack < stack_info.limit)
     {
-        mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+        virtual_lock_exclusive( NULL );  /* no need for signal masking inside signal handler */
         if ((get_page_vprot( stack ) & VPROT_GUARD) &&
             grow_thread_stack( ROUND_ADDR( stack, page_mask ), &stack_info ))
         {
             rec->ExceptionCode = STATUS_STACK_OVERFLOW;
             rec->NumberParameters = 0;
         }
-        mutex_unlock( &virtual_mutex );
+        virtual_unlock_exclusive( NULL );
     }
 #if defined(VALGRIND_MAKE_MEM_UNDEFINED)
     VALGRIND_MAKE_MEM_UNDEFINED( stack, size );
@@ -3369,6 +3728,29 @@ static NTSTATUS check_write_access( void *base, size_t size, BOOL *has_write_wat
 }
 
 
+/***********************************************************************
+ *           lock_write_access_range
+ *
+ * Take the virtual lock before calling check_write_access on a range. The lock
+ * is only taken exclusively if the range has write watches that need to be disabled.
+ * Returns TRUE if the lock was taken exclusively.
+ */
+static BOOL lock_write_access_range( void *base, size_t size, sigset_t *sigset )
+{
+    size_t i;
+    char *addr = ROUND_ADDR( base, page_mask );
+
+    virtual_lock_shared( sigset );
+    size = ROUND_SIZE( base, size );
+    for (i = 0; i < size; i += page_size)
+        if (get_page_vprot( addr + i ) & VPROT_WRITEWATCH) break;
+    if (i >= size) return FALSE;
+    virtual_unlock_shared( sigset );
+    virtual_lock_exclusive( sigset );
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           virtual_locked_server_call
  */
@@ -3378,19 +3760,20 @@ unsigned int virtual_locked_server_call( void *req_ptr )
     sigset_t sigset;
     void *addr = req->reply_data;
     data_size_t size = req->u.req.request_header.reply_size;
-    BOOL has_write_watch = FALSE;
+    BOOL has_write_watch = FALSE, exclusive;
     unsigned int ret = STATUS_ACCESS_VIOLATION;
 
     if (!size) return wine_server_call( req_ptr );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    exclusive = lock_write_access_range( addr, size, &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         ret = server_call_unlocked( req );
         if (has_write_watch) update_write_watches( addr, size, wine_server_reply_size( req ));
     }
     else memset( &req->u.reply, 0, sizeof(req->u.reply) );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    if (exclusive) virtual_unlock_exclusive( &sigset );
+    else virtual_unlock_shared( &sigset );
     return ret;
 }
 
@@ -3407,14 +3790,14 @@ ssize_t virtual_locked_read( int fd, void *addr, size_t size )
     ssize_t ret = read( fd, addr, size );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = read( fd, addr, size );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     errno = err;
     return ret;
 }
@@ -3432,14 +3815,14 @@ ssize_t virtual_locked_pread( int fd, void *addr, size_t size, off_t offset )
     ssize_t ret = pread( fd, addr, size, offset );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = pread( fd, addr, size, offset );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     errno = err;
     return ret;
 }
@@ -3458,7 +3841,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     ssize_t ret = recvmsg( fd, hdr, flags );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     for (i = 0; i < hdr->msg_iovlen; i++)
         if (check_write_access( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, &has_write_watch ))
             break;
@@ -3470,7 +3853,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     if (has_write_watch)
         while (i--) update_write_watches( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, 0 );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     errno = err;
     return ret;
 }
@@ -3485,10 +3868,10 @@ BOOL virtual_is_valid_code_address( const void *addr, SIZE_T size )
     BOOL ret = FALSE;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_shared( &sigset );
     if ((view = find_view( addr, size )))
         ret = !(view->protect & VPROT_SYSTEM);  /* system views are not visible to the app */
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_shared( &sigset );
     return ret;
 }
 
@@ -3575,7 +3958,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
 
     if (!size) return 0;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if ((view = find_view( addr, size )))
     {
         if (!(view->protect & VPROT_SYSTEM))
@@ -3591,7 +3974,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
             }
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return bytes_read;
 }
 
@@ -3605,19 +3988,20 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
  */
 NTSTATUS virtual_uninterrupted_write_memory( void *addr, const void *buffer, SIZE_T size )
 {
-    BOOL has_write_watch = FALSE;
+    BOOL has_write_watch = FALSE, exclusive;
     sigset_t sigset;
     NTSTATUS ret;
 
     if (!size) return STATUS_SUCCESS;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    exclusive = lock_write_access_range( addr, size, &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         memcpy( addr, buffer, size );
         if (has_write_watch) update_write_watches( addr, size, size );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    if (exclusive) virtual_unlock_exclusive( &sigset );
+    else virtual_unlock_shared( &sigset );
     return ret;
 }
 
@@ -3632,7 +4016,7 @@ void virtual_set_force_exec( BOOL enable )
     struct file_view *view;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if (!force_exec_prot != !enable)  /* change all existing views */
     {
         force_exec_prot = enable;
@@ -3645,7 +4029,7 @@ void virtual_set_force_exec( BOOL enable )
             mprotect_range( view->base, view->size, commit, 0 );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 }
 
 struct free_range
@@ -3803,7 +4187,7 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
 
     /* Reserve the memory */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
     if ((type & MEM_RESERVE) || !base)
     {
@@ -3817,13 +4201,22 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
             else if (is_dos_memory) status = allocate_dos_memory( &view, vprot );
             else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, zero_bits );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (vprot & VPROT_WRITEWATCH) enable_kernel_write_watches( view );
+            }
         }
     }
     else if (type & MEM_RESET)
     {
         if (!(view = find_view( base, size ))) status = STATUS_NOT_MAPPED_VIEW;
-        else madvise( base, size, MADV_DONTNEED );
+        else
+        {
+            madvise( base, size, MADV_DONTNEED );
+            /* discarded pages would be reported as written otherwise */
+            if (view->protect & VPROT_KERNEL_WRITEWATCH) kernel_writewatch_protect( base, size );
+        }
     }
     else  /* commit the pages */
     {
@@ -3844,7 +4237,7 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -3912,7 +4305,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
     if (size) size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
     /* avoid freeing the DOS area when a broken app passes a NULL pointer */
     if (!base)
@@ -3954,7 +4347,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
         status = STATUS_INVALID_PARAMETER;
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
@@ -4008,7 +4401,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
     size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
     if ((view = find_view( base, size )))
     {
@@ -4024,7 +4417,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4088,6 +4481,8 @@ static NTSTATUS get_basic_memory_info( HANDLE process, LPCVOID addr,
     struct file_view *view;
     char *base, *alloc_base = 0, *alloc_end = working_set_limit;
     struct wine_rb_entry *ptr;
+    MEMORY_BASIC_INFORMATION mbi;
+    BOOL exclusive = FALSE;
     sigset_t sigset;
 
     if (len < sizeof(MEMORY_BASIC_INFORMATION))
@@ -4128,56 +4523,67 @@ static NTSTATUS get_basic_memory_info( HANDLE process, LPCVOID addr,
 
     /* Find the view containing the address */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
-    ptr = views_tree.root;
-    while (ptr)
+    virtual_lock_shared( &sigset );
+    for (;;)
     {
-        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
-        if ((char *)view->base > base)
-        {
-            alloc_end = view->base;
-            ptr = ptr->left;
-        }
-        else if ((char *)view->base + view->size <= base)
-        {
-            alloc_base = (char *)view->base + view->size;
-            ptr = ptr->right;
-        }
-        else
+        ptr = views_tree.root;
+        while (ptr)
         {
-            alloc_base = view->base;
-            alloc_end = (char *)view->base + view->size;
-            break;
+            view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+            if ((char *)view->base > base)
+            {
+                alloc_end = view->base;
+                ptr = ptr->left;
+            }
+            else if ((char *)view->base + view->size <= base)
+            {
+                alloc_base = (char *)view->base + view->size;
+                ptr = ptr->right;
+            }
+            else
+            {
+                alloc_base = view->base;
+                alloc_end = (char *)view->base + view->size;
+                break;
+            }
         }
+        /* get_committed_size() updates the page protections of SEC_RESERVE views,
+         * which needs the exclusive lock; the view may go away while switching */
+        if (exclusive || !ptr || !(view->protect & SEC_RESERVE)) break;
+        virtual_unlock_shared( &sigset );
+        virtual_lock_exclusive( &sigset );
+        exclusive = TRUE;
+        alloc_base = 0;
+        alloc_end = working_set_limit;
     }
 
-    /* Fill the info structure */
+    /* Fill the info structure; it is copied to the caller's buffer outside of the lock */
 
-    info->AllocationBase = alloc_base;
-    info->BaseAddress    = base;
-    info->RegionSize     = alloc_end - base;
+    mbi.AllocationBase = alloc_base;
+    mbi.BaseAddress    = base;
+    mbi.RegionSize     = alloc_end - base;
 
     if (!ptr)
     {
-        if (!mmap_enum_reserved_areas( get_free_mem_state_callback, info, 0 ))
+        if (!mmap_enum_reserved_areas( get_free_mem_state_callback, &mbi, 0 ))
         {
             /* not in a reserved area at all, pretend it's allocated */
 #ifdef __i386__
             if (base >= (char *)address_space_start)
             {
-                info->State             = MEM_RESERVE;
-                info->Protect           = PAGE_NOACCESS;
-                info->AllocationProtect = PAGE_NOACCESS;
-                info->Type              = MEM_PRIVATE;
+                mbi.State             = MEM_RESERVE;
+                mbi.Protect           = PAGE_NOACCESS;
+                mbi.AllocationProtect = PAGE_NOACCESS;
+                mbi.Type              = MEM_PRIVATE;
             }
             else
 #endif
             {
-                info->State             = MEM_FREE;
-                info->Protect           = PAGE_NOACCESS;
-                info->AllocationBase    = 0;
-                info->AllocationProtect = 0;
-                info->Type              = 0;
+                mbi.State             = MEM_FREE;
+                mbi.Protect           = PAGE_NOACCESS;
+                mbi.AllocationBase    = 0;
+                mbi.AllocationProtect = 0;
+                mbi.Type              = 0;
             }
         }
     }
@@ -4185,15 +4591,18 @@ static NTSTATUS get_basic_memory_info( HANDLE process, LPCVOID addr,
     {
         BYTE vprot;
 
-        info->RegionSize = get_committed_size( view, base, &vprot, ~VPROT_WRITEWATCH );
-        info->State = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
-        info->Protect = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, view->protect ) : 0;
-        info->AllocationProtect = get_win32_prot( view->protect, view->protect );
-        if (view->protect & SEC_IMAGE) info->Type = MEM_IMAGE;
-        else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
-        else info->Type = MEM_PRIVATE;
+        mbi.RegionSize = get_committed_size( view, base, &vprot, ~VPROT_WRITEWATCH );
+        mbi.State = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
+        mbi.Protect = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, view->protect ) : 0;
+        mbi.AllocationProtect = get_win32_prot( view->protect, view->protect );
+        if (view->protect & SEC_IMAGE) mbi.Type = MEM_IMAGE;
+        else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) mbi.Type = MEM_MAPPED;
+        else mbi.Type = MEM_PRIVATE;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    if (exclusive) virtual_unlock_exclusive( &sigset );
+    else virtual_unlock_shared( &sigset );
+
+    *info = mbi;
 
     if (res_len) *res_len = sizeof(*info);
     return STATUS_SUCCESS;
@@ -4231,7 +4640,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
         if (vmentries == NULL)
             WARN( "couldn't get process vmmap, errno %d\n", errno );
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock_exclusive( &sigset );
         for (p = info; (UINT_PTR)(p + 1) <= (UINT_PTR)info + len; p++)
         {
              int i;
@@ -4258,7 +4667,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                      p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
              }
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock_exclusive( &sigset );
 
         if (vmentries)
             procstat_freevmmap( pstat, vmentries );
@@ -4268,7 +4677,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
             procstat_close( pstat );
     }
 #else
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if (pagemap_fd == -2)
     {
 #ifdef O_CLOEXEC
@@ -4307,7 +4716,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
 #endif
 
     if (res_len)
@@ -4578,7 +4987,7 @@ NTSTATUS WINAPI NtUnmapViewOfSection( HANDLE process, PVOID addr )
         return status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if ((view = find_view( addr, 0 )) && !is_view_valloc( view ))
     {
         if (view->protect & VPROT_SYSTEM)
@@ -4592,7 +5001,7 @@ NTSTATUS WINAPI NtUnmapViewOfSection( HANDLE process, PVOID addr )
                 {
                     TRACE( "not freeing in-use builtin %p\n", view->base );
                     builtin->refcount--;
-                    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                    virtual_unlock_exclusive( &sigset );
                     return STATUS_SUCCESS;
                 }
             }
@@ -4611,7 +5020,7 @@ NTSTATUS WINAPI NtUnmapViewOfSection( HANDLE process, PVOID addr )
         }
         else FIXME( "failed to unmap %p %x\n", view->base, status );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
@@ -4746,7 +5155,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         return result.virtual_flush.status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
     if (!(view = find_view( addr, *size_ptr ))) status = STATUS_INVALID_PARAMETER;
     else
     {
@@ -4756,7 +5165,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         if (msync( addr, *size_ptr, MS_ASYNC )) status = STATUS_NOT_MAPPED_DATA;
 #endif
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
@@ -4769,6 +5178,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
                                  ULONG_PTR *count, ULONG *granularity )
 {
     NTSTATUS status = STATUS_SUCCESS;
+    struct file_view *view;
     sigset_t sigset;
 
     size = ROUND_SIZE( base, size );
@@ -4783,9 +5193,14 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     TRACE( "%p %x %p-%p %p %lu\n", process, flags, base, (char *)base + size,
            addresses, *count );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
-    if (is_write_watch_range( base, size ))
+    if ((view = find_view( base, size )) && (view->protect & VPROT_KERNEL_WRITEWATCH))
+    {
+        kernel_get_write_watches( base, size, addresses, count, flags & WRITE_WATCH_FLAG_RESET );
+        *granularity = page_size;
+    }
+    else if (view && (view->protect & VPROT_WRITEWATCH))
     {
         ULONG_PTR pos = 0;
         char *addr = base;
@@ -4802,7 +5217,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     }
     else status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
@@ -4814,6 +5229,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
 NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 {
     NTSTATUS status = STATUS_SUCCESS;
+    struct file_view *view;
     sigset_t sigset;
 
     size = ROUND_SIZE( base, size );
@@ -4823,18 +5239,77 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 
     if (!size) return STATUS_INVALID_PARAMETER;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_exclusive( &sigset );
 
-    if (is_write_watch_range( base, size ))
+    if ((view = find_view( base, size )) && (view->protect & VPROT_KERNEL_WRITEWATCH))
+        kernel_reset_write_watches( base, size );
+    else if (view && (view->protect & VPROT_WRITEWATCH))
         reset_write_watches( base, size );
     else
         status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_exclusive( &sigset );
     return status;
 }
 
 
+#if defined(__linux__) && defined(__NR_process_vm_readv) && defined(__NR_process_vm_writev)
+
+static BOOL process_vm_disabled;
+
+/***********************************************************************
+ *           direct_process_memory_copy
+ *
+ * Copy memory from or to another process with process_vm_readv/writev, once
+ * the server has checked the access rights. Returns FALSE when the copy
+ * couldn't be done completely or the process has exited meanwhile, in which
+ * case the caller falls back to the server request.
+ */
+static BOOL direct_process_memory_copy( HANDLE process, void *addr, void *buffer, SIZE_T size, BOOL write )
+{
+    struct iovec local, remote;
+    ssize_t ret;
+    int pid;
+
+    if (process_vm_disabled || !size) return FALSE;
+    if ((pid = server_get_process_vm_pid( process, write ? PROCESS_VM_WRITE : PROCESS_VM_READ )) == -1)
+        return FALSE;
+
+    local.iov_base  = buffer;
+    local.iov_len   = size;
+    remote.iov_base = addr;
+    remote.iov_len  = size;
+    if (write) ret = syscall( __NR_process_vm_writev, pid, &local, 1, &remote, 1, 0 );
+    else ret = syscall( __NR_process_vm_readv, pid, &local, 1, &remote, 1, 0 );
+
+    /* other errors, like EPERM for a process we aren't allowed to trace, only concern the target process */
+    if (ret == -1 && errno == ENOSYS)
+    {
+        TRACE( "process_vm_%sv not usable (%s), using the server\n", write ? "write" : "read",
+               strerror( errno ));
+        process_vm_disabled = TRUE;
+        return FALSE;
+    }
+
+    /* the process may have exited and its pid been reused during the copy, so check its pidfd
+     * again; without a pidfd this can't be verified, and the server is used instead */
+    if (!server_check_process_vm_pid( process, pid ))
+    {
+        TRACE( "process %p (pid %d) not verified after the copy, using the server\n", process, pid );
+        return FALSE;
+    }
+    return ret == size;
+}
+
+#else
+
+static BOOL direct_process_memory_copy( HANDLE process, void *addr, void *buffer, SIZE_T size, BOOL write )
+{
+    return FALSE;
+}
+
+#endif
+
 /***********************************************************************
  *             NtReadVirtualMemory   (NTDLL.@)
  *             ZwReadVirtualMemory   (NTDLL.@)
@@ -4846,6 +5321,11 @@ NTSTATUS WINAPI NtReadVirtualMemory( HANDLE process, const void *addr, void *buf
 
     if (virtual_check_buffer_for_write( buffer, size ))
     {
+        if (direct_process_memory_copy( process, (void *)addr, buffer, size, FALSE ))
+        {
+            if (bytes_read) *bytes_read = size;
+            return STATUS_SUCCESS;
+        }
         SERVER_START_REQ( read_process_memory )
         {
             req->handle = wine_server_obj_handle( process );
@@ -4876,6 +5356,11 @@ NTSTATUS WINAPI NtWriteVirtualMemory( HANDLE process, void *addr, const void *bu
 
     if (virtual_check_buffer_for_read( buffer, size ))
     {
+        if (direct_process_memory_copy( process, addr, (void *)buffer, size, TRUE ))
+        {
+            if (bytes_written) *bytes_written = size;
+            return STATUS_SUCCESS;
+        }
         SERVER_START_REQ( write_process_memory )
         {
             req->handle     = wine_server_obj_handle( process );
@@ -4907,7 +5392,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
 
     TRACE("%p %p\n", addr1, addr2);
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock_shared( &sigset );
 
     view1 = find_view( addr1, 0 );
     view2 = find_view( addr2, 0 );
@@ -4931,7 +5416,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
         SERVER_END_REQ;
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock_shared( &sigset );
     return status;
 }
 
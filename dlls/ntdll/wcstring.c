@@ -215,6 +215,22 @@ errno_t __cdecl wcscpy_s( wchar_t *dst, size_t len, const wchar_t *src )
 size_t __cdecl wcslen( LPCWSTR str )
 {
     const WCHAR *s = str;
+
+#ifdef __x86_64__
+    /* Scan aligned 16-byte blocks, which never cross a page boundary. This
+     * only lines up with the characters when the string is 2-byte aligned. */
+    if (!((ULONG_PTR)str & 1))
+    {
+        typedef short vec __attribute__((vector_size(16), __may_alias__));
+        typedef char vec_b __attribute__((vector_size(16)));
+        const vec *p = (const vec *)((ULONG_PTR)str & ~15), zero = {0};
+        unsigned int mask;
+
+        mask = __builtin_ia32_pmovmskb128( (vec_b)(*p == zero) ) & (~0u << ((ULONG_PTR)str & 15));
+        while (!mask) mask = __builtin_ia32_pmovmskb128( (vec_b)(*++p == zero) );
+        return ((const char *)p + __builtin_ctz( mask ) - (const char *)str) / sizeof(WCHAR);
+    }
+#endif
     while (*s) s++;
     return s - str;
 }
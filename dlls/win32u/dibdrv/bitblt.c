@@ -470,6 +470,29 @@ static int get_overlap( const dib_info *dst, const RECT *dst_rect,
     return ret;
 }
 
+struct copy_rect_params
+{
+    dib_info       *dst;
+    const RECT     *dst_rect;
+    const dib_info *src;
+    const RECT     *src_rect;
+    INT             rop2;
+};
+
+static void copy_rect_band( int count, const RECT *rects, void *ctx )
+{
+    const struct copy_rect_params *params = ctx;
+    POINT origin;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        origin.x = params->src_rect->left + rects[i].left - params->dst_rect->left;
+        origin.y = params->src_rect->top  + rects[i].top  - params->dst_rect->top;
+        params->dst->funcs->copy_rect( params->dst, &rects[i], params->src, &origin, params->rop2, 0 );
+    }
+}
+
 static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                         const struct clipped_rects *clipped_rects, INT rop2 )
 {
@@ -545,6 +568,12 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
             }
         }
     }
+    else if (!overlap)  /* no ordering constraints */
+    {
+        struct copy_rect_params params = { dst, dst_rect, src, src_rect, rop2 };
+
+        render_rects_in_bands( count, rects, copy_rect_band, &params );
+    }
     else  /* left to right, top to bottom */
     {
         for (i = 0; i < count; i++)
@@ -585,17 +614,35 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+struct blend_rect_params
+{
+    dib_info       *dst;
+    const dib_info *src;
+    POINT           offset;
+    BLENDFUNCTION   blend;
+};
+
+static void blend_rect_band( int count, const RECT *rects, void *ctx )
+{
+    const struct blend_rect_params *params = ctx;
+
+    params->dst->funcs->blend_rects( params->dst, count, rects, params->src, &params->offset, params->blend );
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT offset;
+    struct blend_rect_params params;
     struct clipped_rects clipped_rects;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
-    offset.x = src_rect->left - dst_rect->left;
-    offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+    params.dst = dst;
+    params.src = src;
+    params.offset.x = src_rect->left - dst_rect->left;
+    params.offset.y = src_rect->top  - dst_rect->top;
+    params.blend = blend;
+    render_rects_in_bands( clipped_rects.count, clipped_rects.rects, blend_rect_band, &params );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -680,19 +727,36 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
-static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+struct gradient_rect_params
+{
+    dib_info        *dib;
+    const TRIVERTEX *v;
+    int              mode;
+    LONG             failed;
+};
+
+static void gradient_rect_band( int count, const RECT *rects, void *ctx )
 {
+    struct gradient_rect_params *params = ctx;
     int i;
-    struct clipped_rects clipped_rects;
-    BOOL ret = TRUE;
 
-    if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+    for (i = 0; i < count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        if (params->dib->funcs->gradient_rect( params->dib, &rects[i], params->v, params->mode )) continue;
+        InterlockedExchange( &params->failed, TRUE );
+        break;
     }
+}
+
+static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+{
+    struct gradient_rect_params params = { dib, v, mode, FALSE };
+    struct clipped_rects clipped_rects;
+
+    if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
+    render_rects_in_bands( clipped_rects.count, clipped_rects.rects, gradient_rect_band, &params );
     free_clipped_rects( &clipped_rects );
-    return ret;
+    return !params.failed;
 }
 
 static DWORD copy_src_bits( dib_info *src, RECT *src_rect )
@@ -23,6 +23,8 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -302,6 +304,168 @@ int get_clipped_rects( const dib_info *dib, const RECT *rc, HRGN clip, struct cl
     return clip_rects->count;
 }
 
+/* Large operations can optionally be split into horizontal bands that are rendered by a small
+ * pool of worker threads. The primitive functions only touch the pixels inside the rectangles
+ * they are given, so the result doesn't depend on how the rectangles are split. This is only
+ * enabled when the RenderThreads value of HKCU\Software\Wine\DIB is set to the number of
+ * workers to start.
+ *
+ * The workers are plain pthreads that never run Windows code, and they run with all signals
+ * blocked. Exceptions can't be handled on them: a fault while rendering to application memory,
+ * such as a write watch or a guard page in a DIB section, kills the whole process. */
+
+#define BAND_MAX_THREADS 16
+#define BAND_MIN_PIXELS  (256 * 256)  /* smaller operations are always done inline */
+#define BAND_MIN_ROWS    16
+
+struct band_job
+{
+    band_rects_func func;
+    void           *ctx;
+    const RECT     *rects;
+    int             count;
+    int             top;      /* top of the first band */
+    int             height;   /* height of each band */
+    int             bands;    /* total number of bands */
+    int             next;     /* next band to render */
+    int             pending;  /* bands not yet completed */
+};
+
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t band_init_once = PTHREAD_ONCE_INIT;
+static struct band_job *band_job;  /* current job, protected by band_mutex */
+static unsigned int band_threads;
+
+static void render_band( const struct band_job *job, int band )
+{
+    RECT rects[32], *out = rects;
+    int i, top = job->top + band * job->height, bottom = top + job->height;
+
+    for (i = 0; i < job->count; i++)
+    {
+        if (job->rects[i].bottom <= top || job->rects[i].top >= bottom) continue;
+        *out = job->rects[i];
+        out->top = max( out->top, top );
+        out->bottom = min( out->bottom, bottom );
+        if (++out == rects + ARRAY_SIZE(rects))
+        {
+            job->func( out - rects, rects, job->ctx );
+            out = rects;
+        }
+    }
+    if (out != rects) job->func( out - rects, rects, job->ctx );
+}
+
+/* grab and render bands of the current job until none is left; called with band_mutex held */
+static void render_pending_bands( struct band_job *job )
+{
+    int band;
+
+    while (job->next < job->bands)
+    {
+        band = job->next++;
+        pthread_mutex_unlock( &band_mutex );
+        render_band( job, band );
+        pthread_mutex_lock( &band_mutex );
+        if (!--job->pending) pthread_cond_signal( &band_done_cond );
+    }
+}
+
+static void *band_thread( void *arg )
+{
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        if (band_job && band_job->next < band_job->bands) render_pending_bands( band_job );
+        else pthread_cond_wait( &band_start_cond, &band_mutex );
+    }
+    return NULL;
+}
+
+static void init_band_threads(void)
+{
+    sigset_t sigset, old_sigset;
+    pthread_attr_t attr;
+    pthread_t thread;
+    DWORD count = 0;
+    HKEY key;
+
+    /* @@ Wine registry key: HKCU\Software\Wine\DIB */
+    if ((key = reg_open_hkcu_key( "Software\\Wine\\DIB" )))
+    {
+        get_key_value( key, "RenderThreads", &count );
+        NtClose( key );
+    }
+    if (!count) return;
+    count = min( count, BAND_MAX_THREADS );
+
+    /* keep the workers out of signal delivery */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    while (band_threads < count && !pthread_create( &thread, &attr, band_thread, NULL )) band_threads++;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+
+    TRACE( "started %u band threads\n", band_threads );
+}
+
+/***********************************************************************
+ *           render_rects_in_bands
+ *
+ * Call func for the given rectangles, splitting them across the band threads if the
+ * operation is large enough. Returns once all the rectangles have been rendered.
+ */
+void render_rects_in_bands( int count, const RECT *rects, band_rects_func func, void *ctx )
+{
+    struct band_job job;
+    int i, top = INT_MAX, bottom = INT_MIN;
+    ULONGLONG pixels = 0;
+
+    pthread_once( &band_init_once, init_band_threads );
+    if (!band_threads) goto single;
+
+    for (i = 0; i < count; i++)
+    {
+        pixels += (ULONGLONG)(rects[i].right - rects[i].left) * (rects[i].bottom - rects[i].top);
+        top = min( top, rects[i].top );
+        bottom = max( bottom, rects[i].bottom );
+    }
+    if (pixels < BAND_MIN_PIXELS) goto single;
+
+    job.bands = min( band_threads + 1, (bottom - top) / BAND_MIN_ROWS );
+    if (job.bands < 2) goto single;
+
+    job.func    = func;
+    job.ctx     = ctx;
+    job.rects   = rects;
+    job.count   = count;
+    job.top     = top;
+    job.height  = (bottom - top + job.bands - 1) / job.bands;
+    job.next    = 0;
+    job.pending = job.bands;
+
+    pthread_mutex_lock( &band_mutex );
+    if (band_job)  /* the workers are busy with another thread's job */
+    {
+        pthread_mutex_unlock( &band_mutex );
+        goto single;
+    }
+    band_job = &job;
+    pthread_cond_broadcast( &band_start_cond );
+    render_pending_bands( &job );
+    while (job.pending) pthread_cond_wait( &band_done_cond, &band_mutex );
+    band_job = NULL;
+    pthread_mutex_unlock( &band_mutex );
+    return;
+
+single:
+    func( count, rects, ctx );
+}
+
 void add_clipped_bounds( dibdrv_physdev *dev, const RECT *rect, HRGN clip )
 {
     const WINEREGION *region;
@@ -1790,12 +1790,26 @@ COLORREF CDECL dibdrv_SetDCPenColor( PHYSDEV dev, COLORREF color )
  *
  * Fill a number of rectangles with a given pixel color and rop mode
  */
+struct solid_rects_params
+{
+    dib_info *dib;
+    rop_mask  mask;
+};
+
+static void solid_rects_band( int count, const RECT *rects, void *ctx )
+{
+    const struct solid_rects_params *params = ctx;
+
+    params->dib->funcs->solid_rects( params->dib, count, rects, params->mask.and, params->mask.xor );
+}
+
 BOOL fill_with_pixel( DC *dc, dib_info *dib, DWORD pixel, int num, const RECT *rects, INT rop )
 {
-    rop_mask mask;
+    struct solid_rects_params params;
 
-    calc_rop_masks( rop, pixel, &mask );
-    dib->funcs->solid_rects( dib, num, rects, mask.and, mask.xor );
+    params.dib = dib;
+    calc_rop_masks( rop, pixel, &params.mask );
+    render_rects_in_bands( num, rects, solid_rects_band, &params );
     return TRUE;
 }
 
@@ -2030,6 +2044,21 @@ static BOOL select_pattern_brush( dibdrv_physdev *pdev, dib_brush *brush, BOOL *
     return TRUE;
 }
 
+struct pattern_rects_params
+{
+    dib_info        *dib;
+    const POINT     *brush_org;
+    const dib_brush *brush;
+};
+
+static void pattern_rects_band( int count, const RECT *rects, void *ctx )
+{
+    const struct pattern_rects_params *params = ctx;
+
+    params->dib->funcs->pattern_rects( params->dib, count, rects, params->brush_org,
+                                       &params->brush->dib, &params->brush->masks );
+}
+
 /**********************************************************************
  *             pattern_brush
  *
@@ -2039,6 +2068,7 @@ static BOOL select_pattern_brush( dibdrv_physdev *pdev, dib_brush *brush, BOOL *
 static BOOL pattern_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
                           int num, const RECT *rects, const POINT *brush_org, INT rop)
 {
+    struct pattern_rects_params params;
     BOOL needs_reselect = FALSE;
 
     if (rop != brush->rop)
@@ -2074,7 +2104,10 @@ static BOOL pattern_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
         }
     }
 
-    dib->funcs->pattern_rects( dib, num, rects, brush_org, &brush->dib, &brush->masks );
+    params.dib = dib;
+    params.brush_org = brush_org;
+    params.brush = brush;
+    render_rects_in_bands( num, rects, pattern_rects_band, &params );
 
     if (needs_reselect) free_pattern_brush( brush );
     return TRUE;
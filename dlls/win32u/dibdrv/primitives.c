@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -31,6 +34,32 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
+/* SSE2 is always available on x86-64; on i386 the SSE2 code is compiled
+ * with a target attribute and only used if the CPU supports it */
+#if defined(__i386__) || defined(__x86_64__)
+#define SSE2_PRIMITIVES
+#ifdef __i386__
+#define SSE2_FUNC __attribute__((target("sse2")))
+#else
+#define SSE2_FUNC
+#endif
+
+static BOOL use_sse2(void)
+{
+#ifdef __x86_64__
+    return TRUE;
+#else
+    static int supported = -1;
+    SYSTEM_CPU_INFORMATION info;
+
+    if (supported == -1)
+        supported = !NtQuerySystemInformation( SystemCpuInformation, &info, sizeof(info), NULL ) &&
+                    (info.ProcessorFeatureBits & CPU_FEATURE_SSE2);
+    return supported;
+#endif
+}
+#endif
+
 /* Bayer matrices for dithering */
 
 static const BYTE bayer_4x4[4][4] =
@@ -2219,6 +2248,51 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+#ifdef SSE2_PRIMITIVES
+static inline SSE2_FUNC __m128i convert_555_to_8888_sse2( __m128i val )
+{
+    return _mm_or_si128(
+        _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 9 ), _mm_set1_epi32( 0xf80000 )),
+                                    _mm_and_si128( _mm_slli_epi32( val, 4 ), _mm_set1_epi32( 0x070000 ))),
+                      _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 6 ), _mm_set1_epi32( 0x00f800 )),
+                                    _mm_and_si128( _mm_slli_epi32( val, 1 ), _mm_set1_epi32( 0x000700 )))),
+        _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 3 ), _mm_set1_epi32( 0x0000f8 )),
+                      _mm_and_si128( _mm_srli_epi32( val, 2 ), _mm_set1_epi32( 0x000007 ))));
+}
+
+/* convert the pixels of a row eight at a time, and return the number converted */
+static SSE2_FUNC int convert_row_555_to_8888_sse2( DWORD *dst, const WORD *src, int len )
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m128i val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), convert_555_to_8888_sse2( _mm_unpacklo_epi16( val, zero )));
+        _mm_storeu_si128( (__m128i *)(dst + x + 4), convert_555_to_8888_sse2( _mm_unpackhi_epi16( val, zero )));
+    }
+    return x;
+}
+#endif
+
+static void convert_row_555_to_8888( DWORD *dst, const WORD *src, int len )
+{
+    DWORD src_val;
+    int x = 0;
+
+#ifdef SSE2_PRIMITIVES
+    if (use_sse2()) x = convert_row_555_to_8888_sse2( dst, src, len );
+#endif
+    for (; x < len; x++)
+    {
+        src_val = src[x];
+        dst[x] = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
+                 ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
+                 ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
+    }
+}
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -2314,16 +2388,8 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
-                                   ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
-                                   ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                convert_row_555_to_8888( dst_start, src_start, src_rect->right - src_rect->left );
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
                 dst_start += dst->stride / 4;
                 src_start += src->stride / 2;
             }
@@ -4682,35 +4748,194 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef SSE2_PRIMITIVES
+
+/* SSE2 versions of the blend helpers, working on four pixels at a time with each
+ * channel in a 16-bit lane, and giving exactly the same results. */
+
+/* (x + 127) / 255 for each lane, exact for x <= 255 * 255 */
+static inline SSE2_FUNC __m128i div255_epi16( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ) );
+    x = _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( x, 8 ));
+    return _mm_srli_epi16( x, 8 );
+}
+
+/* replicate the alpha channel of each pixel to all its lanes */
+static inline SSE2_FUNC __m128i alpha_epi16( __m128i x )
+{
+    x = _mm_shufflelo_epi16( x, _MM_SHUFFLE( 3, 3, 3, 3 ));
+    return _mm_shufflehi_epi16( x, _MM_SHUFFLE( 3, 3, 3, 3 ));
+}
+
+/* dst * (255 - alpha) / 255 for each channel, with alpha taken from the src lanes */
+static inline SSE2_FUNC __m128i scale_dst_epi16( __m128i dst, __m128i src )
+{
+    return div255_epi16( _mm_mullo_epi16( dst, _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha_epi16( src ))));
+}
+
+/* combine 9-bit channel sums into pixels, with the same overflow as the scalar code */
+static inline SSE2_FUNC __m128i pack_sums_epi16( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i bits = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ));
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+
+    return _mm_or_si128( bits, _mm_slli_epi32( carry, 8 ));
+}
+
+static inline SSE2_FUNC __m128i blend_color_epi16( __m128i dst, __m128i src, __m128i alpha, __m128i inv_alpha )
+{
+    return div255_epi16( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+static inline SSE2_FUNC __m128i blend_argb_sse2( __m128i dst, __m128i src )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i src_lo = _mm_unpacklo_epi8( src, zero );
+    __m128i src_hi = _mm_unpackhi_epi8( src, zero );
+    __m128i lo = _mm_add_epi16( src_lo, scale_dst_epi16( _mm_unpacklo_epi8( dst, zero ), src_lo ));
+    __m128i hi = _mm_add_epi16( src_hi, scale_dst_epi16( _mm_unpackhi_epi8( dst, zero ), src_hi ));
+
+    return pack_sums_epi16( lo, hi );
+}
+
+static inline SSE2_FUNC __m128i blend_argb_alpha_sse2( __m128i dst, __m128i src, __m128i alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i src_lo = div255_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( src, zero ), alpha ));
+    __m128i src_hi = div255_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( src, zero ), alpha ));
+    __m128i lo = _mm_add_epi16( src_lo, scale_dst_epi16( _mm_unpacklo_epi8( dst, zero ), src_lo ));
+    __m128i hi = _mm_add_epi16( src_hi, scale_dst_epi16( _mm_unpackhi_epi8( dst, zero ), src_hi ));
+
+    return pack_sums_epi16( lo, hi );
+}
+
+static inline SSE2_FUNC __m128i blend_argb_constant_alpha_sse2( __m128i dst, __m128i src, __m128i alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    __m128i lo = blend_color_epi16( _mm_unpacklo_epi8( dst, zero ), _mm_unpacklo_epi8( src, zero ),
+                                    alpha, inv_alpha );
+    __m128i hi = blend_color_epi16( _mm_unpackhi_epi8( dst, zero ), _mm_unpackhi_epi8( src, zero ),
+                                    alpha, inv_alpha );
+
+    return _mm_packus_epi16( lo, hi );
+}
+
+/* blend the pixels of a row four at a time, and return the number blended */
+static SSE2_FUNC int blend_row_argb_sse2( DWORD *dst, const DWORD *src, int len )
+{
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), blend_argb_sse2( d, s ));
+    }
+    return x;
+}
+
+static SSE2_FUNC int blend_row_argb_alpha_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    __m128i alpha_vec = _mm_set1_epi16( alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), blend_argb_alpha_sse2( d, s, alpha_vec ));
+    }
+    return x;
+}
+
+/* src_alpha is or'ed into the source pixels */
+static SSE2_FUNC int blend_row_argb_constant_alpha_sse2( DWORD *dst, const DWORD *src, int len,
+                                                         DWORD alpha, DWORD src_alpha )
+{
+    __m128i alpha_vec = _mm_set1_epi16( alpha );
+    __m128i src_alpha_vec = _mm_set1_epi32( src_alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), src_alpha_vec );
+        _mm_storeu_si128( (__m128i *)(dst + x), blend_argb_constant_alpha_sse2( d, s, alpha_vec ));
+    }
+    return x;
+}
+
+#endif  /* SSE2_PRIMITIVES */
+
+static void blend_row_argb( DWORD *dst, const DWORD *src, int len )
+{
+    int x = 0;
+
+#ifdef SSE2_PRIMITIVES
+    if (use_sse2()) x = blend_row_argb_sse2( dst, src, len );
+#endif
+    for (; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+}
+
+static void blend_row_argb_alpha( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef SSE2_PRIMITIVES
+    if (use_sse2()) x = blend_row_argb_alpha_sse2( dst, src, len, alpha );
+#endif
+    for (; x < len; x++) dst[x] = blend_argb_alpha( dst[x], src[x], alpha );
+}
+
+static void blend_row_argb_constant_alpha( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef SSE2_PRIMITIVES
+    if (use_sse2()) x = blend_row_argb_constant_alpha_sse2( dst, src, len, alpha, 0 );
+#endif
+    for (; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+}
+
+static void blend_row_argb_no_src_alpha( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef SSE2_PRIMITIVES
+    if (use_sse2()) x = blend_row_argb_constant_alpha_sse2( dst, src, len, alpha, 0xff000000 );
+#endif
+    for (; x < len; x++) dst[x] = blend_argb_no_src_alpha( dst[x], src[x], alpha );
+}
+
 static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
                              const dib_info *src, const POINT *offset, BLENDFUNCTION blend)
 {
-    int i, x, y;
+    int i, y;
 
     for (i = 0; i < num; i++, rc++)
     {
         DWORD *src_ptr = get_pixel_ptr_32( src, rc->left + offset->x, rc->top + offset->y );
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+        int len = rc->right - rc->left;
 
         if (blend.AlphaFormat & AC_SRC_ALPHA)
         {
             if (blend.SourceConstantAlpha == 255)
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+                    blend_row_argb( dst_ptr, src_ptr, len );
             else
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                    blend_row_argb_alpha( dst_ptr, src_ptr, len, blend.SourceConstantAlpha );
         }
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_row_argb_constant_alpha( dst_ptr, src_ptr, len, blend.SourceConstantAlpha );
         else
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_row_argb_no_src_alpha( dst_ptr, src_ptr, len, blend.SourceConstantAlpha );
     }
 }
 
@@ -5443,6 +5668,49 @@ static BOOL gradient_rect_null( const dib_info *dib, const RECT *rc, const TRIVE
     return TRUE;
 }
 
+#ifdef SSE2_PRIMITIVES
+/* apply the rop to a row of pixels, with the and/xor masks selected by the bits of a 1-bpp
+ * source starting at bit pos; eight pixels are done at a time once pos is byte aligned */
+static SSE2_FUNC void mask_row_32_sse2( DWORD *dst, const BYTE *src, int pos, int len,
+                                        const DWORD *and_colors, const DWORD *xor_colors )
+{
+    const __m128i bits_hi = _mm_set_epi32( 0x10, 0x20, 0x40, 0x80 );
+    const __m128i bits_lo = _mm_set_epi32( 0x01, 0x02, 0x04, 0x08 );
+    const __m128i and0 = _mm_set1_epi32( and_colors[0] );
+    const __m128i and_diff = _mm_set1_epi32( and_colors[0] ^ and_colors[1] );
+    const __m128i xor0 = _mm_set1_epi32( xor_colors[0] );
+    const __m128i xor_diff = _mm_set1_epi32( xor_colors[0] ^ xor_colors[1] );
+    __m128i val, mask, d;
+    DWORD bit_val;
+    int x = 0;
+
+    for (; x < len && (pos & 7); x++, pos++)
+    {
+        bit_val = (src[pos / 8] & pixel_masks_1[pos % 8]) ? 1 : 0;
+        do_rop_32( dst + x, and_colors[bit_val], xor_colors[bit_val] );
+    }
+    for (; x + 8 <= len; x += 8, pos += 8)
+    {
+        val = _mm_set1_epi32( src[pos / 8] );
+
+        mask = _mm_cmpeq_epi32( _mm_and_si128( val, bits_hi ), bits_hi );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        d = _mm_and_si128( d, _mm_xor_si128( and0, _mm_and_si128( mask, and_diff )));
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_xor_si128( d, _mm_xor_si128( xor0, _mm_and_si128( mask, xor_diff ))));
+
+        mask = _mm_cmpeq_epi32( _mm_and_si128( val, bits_lo ), bits_lo );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x + 4) );
+        d = _mm_and_si128( d, _mm_xor_si128( and0, _mm_and_si128( mask, and_diff )));
+        _mm_storeu_si128( (__m128i *)(dst + x + 4), _mm_xor_si128( d, _mm_xor_si128( xor0, _mm_and_si128( mask, xor_diff ))));
+    }
+    for (; x < len; x++, pos++)
+    {
+        bit_val = (src[pos / 8] & pixel_masks_1[pos % 8]) ? 1 : 0;
+        do_rop_32( dst + x, and_colors[bit_val], xor_colors[bit_val] );
+    }
+}
+#endif
+
 static void mask_rect_32( const dib_info *dst, const RECT *rc,
                           const dib_info *src, const POINT *origin, int rop2 )
 {
@@ -5485,6 +5753,29 @@ static void mask_rect_32( const dib_info *dst, const RECT *rc,
         return;
     }
 
+#ifdef SSE2_PRIMITIVES
+    if (use_sse2())
+    {
+        struct rop_codes codes;
+        DWORD and_colors[2], xor_colors[2];
+
+        get_rop_codes( rop2, &codes );
+        for (i = 0; i < 2; i++)
+        {
+            and_colors[i] = (dst_colors[i] & codes.a1) ^ codes.a2;
+            xor_colors[i] = (dst_colors[i] & codes.x1) ^ codes.x2;
+        }
+        for (y = rc->top; y < rc->bottom; y++)
+        {
+            mask_row_32_sse2( dst_start, src_start, origin->x & 7, rc->right - rc->left,
+                              and_colors, xor_colors );
+            dst_start += dst->stride / 4;
+            src_start += src->stride;
+        }
+        return;
+    }
+#endif
+
     full = ((rc->right - rc->left) - ((8 - (origin->x & 7)) & 7)) / 8;
 
 #define LOOP( op )                                                      \
@@ -6133,6 +6424,49 @@ static inline DWORD aa_rgb( BYTE r_dst, BYTE g_dst, BYTE b_dst, DWORD text, cons
             aa_color( r_dst, text >> 16, range->r_min, range->r_max ) << 16);
 }
 
+#ifdef SSE2_PRIMITIVES
+/* draw sixteen glyph pixels at a time: the opaque ones are stored with a vector select,
+ * and the antialiased ones, which need per-channel divisions, are left to aa_rgb();
+ * returns the number of pixels done */
+static SSE2_FUNC int draw_glyph_row_8888_sse2( DWORD *dst, const BYTE *glyph, int len, DWORD text_pixel,
+                                               const struct intensity_range *ranges )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i text = _mm_set1_epi32( text_pixel );
+    __m128i val, opaque, mask;
+    int x, i, aa;
+
+    for (x = 0; x + 16 <= len; x += 16)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(glyph + x) );
+        /* val >= 16 and val >= 2 */
+        opaque = _mm_xor_si128( _mm_cmpeq_epi8( _mm_subs_epu8( val, _mm_set1_epi8( 15 )), zero ),
+                                _mm_set1_epi8( -1 ));
+        aa = _mm_movemask_epi8( _mm_andnot_si128( opaque, _mm_xor_si128(
+                 _mm_cmpeq_epi8( _mm_subs_epu8( val, _mm_set1_epi8( 1 )), zero ), _mm_set1_epi8( -1 ))));
+
+        if (_mm_movemask_epi8( opaque ))
+        {
+            for (i = 0; i < 16; i += 4)
+            {
+                mask = _mm_unpacklo_epi8( opaque, opaque );
+                mask = _mm_unpacklo_epi16( mask, mask );
+                opaque = _mm_srli_si128( opaque, 4 );
+                _mm_storeu_si128( (__m128i *)(dst + x + i),
+                                  _mm_or_si128( _mm_and_si128( mask, text ),
+                                                _mm_andnot_si128( mask, _mm_loadu_si128( (const __m128i *)(dst + x + i) ))));
+            }
+        }
+        for (i = x; aa; i++, aa >>= 1)
+        {
+            if (!(aa & 1)) continue;
+            dst[i] = aa_rgb( dst[i] >> 16, dst[i] >> 8, dst[i], text_pixel, ranges + glyph[i] );
+        }
+    }
+    return x;
+}
+#endif
+
 static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                              const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
@@ -6142,7 +6476,12 @@ static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_in
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        x = 0;
+#ifdef SSE2_PRIMITIVES
+        if (use_sse2()) x = draw_glyph_row_8888_sse2( dst_ptr, glyph_ptr, rect->right - rect->left,
+                                                      text_pixel, ranges );
+#endif
+        for (; x < rect->right - rect->left; x++)
         {
             if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
@@ -6897,6 +7236,8 @@ static inline void rop_codes_from_stretch_mode( int mode, struct rop_codes *code
     return;
 }
 
+/* There is no SSE2 version of this one: the source pixel of each destination pixel is
+ * chosen by the error term, so the loads are a gather that SSE2 can't vectorize. */
 static void stretch_row_32(const dib_info *dst_dib, const POINT *dst_start,
                            const dib_info *src_dib, const POINT *src_start,
                            const struct stretch_params *params, int mode,
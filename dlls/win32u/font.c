@@ -198,6 +198,10 @@ static struct font_gamma_ramp font_gamma_ramp;
 
 static void add_face_to_cache( struct gdi_font_face *face );
 static void remove_face_from_cache( struct gdi_font_face *face );
+static void add_face_to_dir_cache( const WCHAR *family_name, const WCHAR *second_name,
+                                   const WCHAR *style, const WCHAR *fullname, const WCHAR *file,
+                                   UINT index, FONTSIGNATURE fs, DWORD ntmflags, DWORD version,
+                                   DWORD flags, const struct bitmap_font_size *size );
 
 static CPTABLEINFO utf8_cp;
 static CPTABLEINFO oem_cp;
@@ -1197,6 +1201,9 @@ int add_gdi_face( const WCHAR *family_name, const WCHAR *second_name,
     struct gdi_font_family *family;
     int ret = 0;
 
+    if (!data_ptr) add_face_to_dir_cache( family_name, second_name, style, fullname, file,
+                                          index, fs, ntmflags, version, flags, size );
+
     if ((family = find_family_from_name( family_name ))) family->refcount++;
     else if (!(family = create_family( family_name, second_name ))) return ret;
 
@@ -1411,6 +1418,323 @@ static void remove_face_from_cache( struct gdi_font_face *face )
     NtClose( hkey_family );
 }
 
+/* font directory cache
+ *
+ * The faces found when scanning the font directories are stored in a file that is mapped
+ * by the next processes, so that they can skip opening and parsing every font file as
+ * long as the directory hasn't been modified since. Only the directories scanned by
+ * load_file_system_fonts are cached; the fonts listed by fontconfig are still opened
+ * one by one.
+ */
+
+#define FONT_DIR_CACHE_MAGIC   0x43444657  /* "WFDC" */
+#define FONT_DIR_CACHE_VERSION 1
+
+struct font_dir_cache_header
+{
+    DWORD                   magic;
+    DWORD                   version;
+    DWORD                   size;        /* total size of the data */
+    DWORD                   count;       /* number of directories */
+};
+
+struct font_dir_cache_dir
+{
+    DWORD                   size;        /* size of the entry, including the faces that follow it */
+    DWORD                   flags;       /* flags passed to load_directory_fonts */
+    LONGLONG                write_time;  /* last write time of the directory */
+    DWORD                   face_count;
+    DWORD                   path_len;    /* path length in characters */
+    WCHAR                   path[1];
+};
+
+struct font_dir_cache_face
+{
+    DWORD                   size;
+    DWORD                   index;
+    DWORD                   flags;
+    DWORD                   ntmflags;
+    DWORD                   version;
+    DWORD                   scalable;
+    struct bitmap_font_size bitmap_size;
+    FONTSIGNATURE           fs;
+    WCHAR                   names[1];    /* family, second, style, full and file names */
+};
+
+#define FONT_DIR_CACHE_ALIGN(size) (((size) + 7) & ~7)
+
+static const char *font_dir_cache_view;  /* mapping of the cache file */
+static SIZE_T font_dir_cache_view_size;
+static char *font_dir_cache_data;        /* updated cache contents */
+static SIZE_T font_dir_cache_size;
+static SIZE_T font_dir_cache_alloc;
+static SIZE_T font_dir_cache_record;     /* offset of the directory being recorded, or 0 */
+static BOOL font_dir_cache_dirty;
+
+static const WCHAR font_dir_cache_fileW[] =
+    {'\\','?','?','\\','C',':','\\','w','i','n','d','o','w','s','\\',
+     's','y','s','t','e','m','3','2','\\','F','N','T','C','A','C','H','E','.','D','A','T'};
+
+static void *append_font_dir_cache( SIZE_T size )
+{
+    void *ptr;
+
+    size = FONT_DIR_CACHE_ALIGN( size );
+    if (font_dir_cache_size + size > font_dir_cache_alloc)
+    {
+        SIZE_T new_size = max( font_dir_cache_alloc * 2, font_dir_cache_size + size );
+        if (!(ptr = realloc( font_dir_cache_data, new_size ))) return NULL;
+        font_dir_cache_data = ptr;
+        font_dir_cache_alloc = new_size;
+    }
+    ptr = font_dir_cache_data + font_dir_cache_size;
+    memset( ptr, 0, size );
+    font_dir_cache_size += size;
+    return ptr;
+}
+
+static void map_font_dir_cache(void)
+{
+    const struct font_dir_cache_header *header;
+    UNICODE_STRING name = { sizeof(font_dir_cache_fileW), sizeof(font_dir_cache_fileW),
+                            (WCHAR *)font_dir_cache_fileW };
+    OBJECT_ATTRIBUTES attr;
+    FILE_STANDARD_INFORMATION info;
+    IO_STATUS_BLOCK io;
+    HANDLE file, section;
+    void *view = NULL;
+    SIZE_T size = 0;
+    NTSTATUS status;
+
+    font_dir_cache_size = font_dir_cache_alloc = 0;
+    if (!append_font_dir_cache( sizeof(struct font_dir_cache_header) )) return;
+
+    InitializeObjectAttributes( &attr, &name, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtOpenFile( &file, GENERIC_READ | SYNCHRONIZE, &attr, &io, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                    FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE ))
+        return;
+
+    status = NtQueryInformationFile( file, &io, &info, sizeof(info), FileStandardInformation );
+    if (!status && info.EndOfFile.QuadPart >= sizeof(*header) && info.EndOfFile.QuadPart < 0x10000000)
+    {
+        if (!NtCreateSection( &section, SECTION_MAP_READ, NULL, NULL, PAGE_READONLY, SEC_COMMIT, file ))
+        {
+            NtMapViewOfSection( section, GetCurrentProcess(), &view, 0, 0, NULL, &size,
+                                ViewShare, 0, PAGE_READONLY );
+            NtClose( section );
+        }
+    }
+    NtClose( file );
+    if (!view) return;
+
+    header = view;
+    if (header->magic != FONT_DIR_CACHE_MAGIC || header->version != FONT_DIR_CACHE_VERSION ||
+        header->size > info.EndOfFile.QuadPart)
+    {
+        TRACE( "ignoring invalid font cache\n" );
+        NtUnmapViewOfSection( GetCurrentProcess(), view );
+        return;
+    }
+    font_dir_cache_view = view;
+    font_dir_cache_view_size = header->size;
+}
+
+static const struct font_dir_cache_dir *find_font_dir_in_cache( const WCHAR *path, DWORD len,
+                                                                DWORD flags, LONGLONG write_time )
+{
+    const struct font_dir_cache_header *header = (const void *)font_dir_cache_view;
+    const struct font_dir_cache_dir *dir;
+    SIZE_T pos = sizeof(*header);
+    DWORD i;
+
+    if (!header) return NULL;
+
+    for (i = 0; i < header->count; i++, pos += dir->size)
+    {
+        dir = (const void *)(font_dir_cache_view + pos);
+        if (font_dir_cache_view_size - pos < sizeof(*dir)) break;
+        if (dir->size < sizeof(*dir) || dir->size > font_dir_cache_view_size - pos) break;
+        if (dir->path_len > (dir->size - offsetof( struct font_dir_cache_dir, path )) / sizeof(WCHAR)) break;
+        if (dir->path_len != len || dir->flags != flags || dir->write_time != write_time) continue;
+        if (!memcmp( dir->path, path, len * sizeof(WCHAR) )) return dir;
+    }
+    return NULL;
+}
+
+static BOOL load_font_dir_from_cache( const struct font_dir_cache_dir *dir )
+{
+    const struct font_dir_cache_face *face;
+    const WCHAR *names[5], *ptr, *names_end;
+    SIZE_T pos = FONT_DIR_CACHE_ALIGN( offsetof( struct font_dir_cache_dir, path[dir->path_len] ));
+    DWORD i, j;
+    void *copy;
+
+    /* validate the whole entry first, so that we never add only part of a directory */
+    for (i = 0; i < dir->face_count; i++, pos += face->size)
+    {
+        if (pos > dir->size || dir->size - pos < sizeof(*face)) return FALSE;
+        face = (const void *)((const char *)dir + pos);
+        if (face->size < sizeof(*face) || face->size > dir->size - pos) return FALSE;
+        names_end = (const WCHAR *)((const char *)face + face->size);
+        for (j = 0, ptr = face->names; j < ARRAY_SIZE(names); j++, ptr++)
+            while (ptr < names_end && *ptr) ptr++;
+        if (ptr > names_end) return FALSE;
+    }
+
+    pos = FONT_DIR_CACHE_ALIGN( offsetof( struct font_dir_cache_dir, path[dir->path_len] ));
+    for (i = 0; i < dir->face_count; i++, pos += face->size)
+    {
+        face = (const void *)((const char *)dir + pos);
+        for (j = 0, ptr = face->names; j < ARRAY_SIZE(names); j++, ptr += lstrlenW( ptr ) + 1)
+            names[j] = ptr;
+        add_gdi_face( names[0], names[1], names[2], names[3], names[4], NULL, 0, face->index,
+                      face->fs, face->ntmflags, face->version, face->flags,
+                      face->scalable ? NULL : &face->bitmap_size );
+    }
+
+    TRACE( "loaded %u faces for %s from cache\n", dir->face_count, debugstr_wn(dir->path, dir->path_len) );
+
+    if ((copy = append_font_dir_cache( dir->size )))
+    {
+        memcpy( copy, dir, dir->size );
+        ((struct font_dir_cache_header *)font_dir_cache_data)->count++;
+    }
+    return TRUE;
+}
+
+static void begin_font_dir_cache_record( const WCHAR *path, DWORD len, DWORD flags, LONGLONG write_time )
+{
+    struct font_dir_cache_dir *dir;
+
+    font_dir_cache_dirty = TRUE;
+    if (!font_dir_cache_data) return;
+    if (!(dir = append_font_dir_cache( offsetof( struct font_dir_cache_dir, path[len] )))) return;
+    dir->flags = flags;
+    dir->write_time = write_time;
+    dir->path_len = len;
+    memcpy( dir->path, path, len * sizeof(WCHAR) );
+    font_dir_cache_record = (char *)dir - font_dir_cache_data;
+}
+
+static void end_font_dir_cache_record(void)
+{
+    struct font_dir_cache_dir *dir;
+
+    if (!font_dir_cache_record) return;
+    dir = (struct font_dir_cache_dir *)(font_dir_cache_data + font_dir_cache_record);
+    dir->size = font_dir_cache_size - font_dir_cache_record;
+    ((struct font_dir_cache_header *)font_dir_cache_data)->count++;
+    font_dir_cache_record = 0;
+}
+
+static void add_face_to_dir_cache( const WCHAR *family_name, const WCHAR *second_name,
+                                   const WCHAR *style, const WCHAR *fullname, const WCHAR *file,
+                                   UINT index, FONTSIGNATURE fs, DWORD ntmflags, DWORD version,
+                                   DWORD flags, const struct bitmap_font_size *size )
+{
+    const WCHAR *names[5] = { family_name, second_name, style, fullname, file };
+    struct font_dir_cache_face *face;
+    struct font_dir_cache_dir *dir;
+    DWORD i, len = 0;
+    WCHAR *ptr;
+
+    if (!font_dir_cache_record) return;
+
+    for (i = 0; i < ARRAY_SIZE(names); i++) len += (names[i] ? lstrlenW( names[i] ) : 0) + 1;
+    if (!(face = append_font_dir_cache( offsetof( struct font_dir_cache_face, names[len] ))))
+    {
+        /* drop the incomplete entry */
+        font_dir_cache_size = font_dir_cache_record;
+        font_dir_cache_record = 0;
+        return;
+    }
+    face->size = FONT_DIR_CACHE_ALIGN( offsetof( struct font_dir_cache_face, names[len] ));
+    face->index = index;
+    face->flags = flags;
+    face->ntmflags = ntmflags;
+    face->version = version;
+    face->fs = fs;
+    if (size) face->bitmap_size = *size;
+    else face->scalable = TRUE;
+    for (i = 0, ptr = face->names; i < ARRAY_SIZE(names); i++, ptr += lstrlenW( ptr ) + 1)
+        if (names[i]) lstrcpyW( ptr, names[i] );
+
+    dir = (struct font_dir_cache_dir *)(font_dir_cache_data + font_dir_cache_record);
+    dir->face_count++;
+}
+
+static void write_font_dir_cache(void)
+{
+    struct font_dir_cache_header *header = (struct font_dir_cache_header *)font_dir_cache_data;
+    WCHAR tmp_nameW[ARRAY_SIZE(font_dir_cache_fileW) + 16];
+    char buffer[FIELD_OFFSET( FILE_RENAME_INFORMATION, FileName[ARRAY_SIZE(font_dir_cache_fileW)] )];
+    FILE_RENAME_INFORMATION *rename_info = (FILE_RENAME_INFORMATION *)buffer;
+    FILE_DISPOSITION_INFORMATION disposition = { TRUE };
+    UNICODE_STRING name;
+    OBJECT_ATTRIBUTES attr;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER timeout;
+    NTSTATUS status;
+    HANDLE file;
+    char tmp_name[16];
+    DWORD i, len;
+
+    if (!header || !font_dir_cache_dirty) return;
+
+    header->magic = FONT_DIR_CACHE_MAGIC;
+    header->version = FONT_DIR_CACHE_VERSION;
+    header->size = font_dir_cache_size;
+
+    /* write to a temporary file and rename it, so that other processes never see a partial cache */
+    memcpy( tmp_nameW, font_dir_cache_fileW, sizeof(font_dir_cache_fileW) );
+    len = sprintf( tmp_name, ".%04x", (UINT)GetCurrentProcessId() );
+    ascii_to_unicode( tmp_nameW + ARRAY_SIZE(font_dir_cache_fileW), tmp_name, len );
+    name.Buffer = tmp_nameW;
+    name.Length = name.MaximumLength = (ARRAY_SIZE(font_dir_cache_fileW) + len) * sizeof(WCHAR);
+    InitializeObjectAttributes( &attr, &name, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtCreateFile( &file, GENERIC_WRITE | DELETE | SYNCHRONIZE, &attr, &io, NULL, FILE_ATTRIBUTE_NORMAL,
+                      0, FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE, NULL, 0 ))
+        return;
+
+    rename_info->ReplaceIfExists = TRUE;
+    rename_info->RootDirectory = 0;
+    rename_info->FileNameLength = sizeof(font_dir_cache_fileW);
+    memcpy( rename_info->FileName, font_dir_cache_fileW, sizeof(font_dir_cache_fileW) );
+
+    status = NtWriteFile( file, 0, NULL, NULL, &io, font_dir_cache_data, font_dir_cache_size, NULL, NULL );
+    for (i = 0; !status; i++)
+    {
+        /* an opened file can't be replaced, and other processes keep the old cache
+         * mapped while they load their fonts, so give them a chance to finish */
+        status = NtSetInformationFile( file, &io, rename_info, sizeof(buffer), FileRenameInformation );
+        if (status != STATUS_ACCESS_DENIED || i == 10) break;
+        timeout.QuadPart = 20 * -10000;
+        NtDelayExecution( FALSE, &timeout );
+    }
+    if (status)
+    {
+        WARN( "failed to write font cache\n" );
+        NtSetInformationFile( file, &io, &disposition, sizeof(disposition), FileDispositionInformation );
+    }
+    else TRACE( "wrote %u directories to font cache\n", header->count );
+    NtClose( file );
+}
+
+static void unmap_font_dir_cache(void)
+{
+    /* the directories that are still valid have been copied to font_dir_cache_data */
+    if (font_dir_cache_view) NtUnmapViewOfSection( GetCurrentProcess(), (void *)font_dir_cache_view );
+    font_dir_cache_view = NULL;
+    font_dir_cache_view_size = 0;
+}
+
+static void free_font_dir_cache(void)
+{
+    free( font_dir_cache_data );
+    font_dir_cache_data = NULL;
+    font_dir_cache_size = font_dir_cache_alloc = 0;
+}
+
 /* font links */
 
 struct gdi_font_link
@@ -3354,6 +3678,229 @@ static UINT get_glyph_index_linked( struct gdi_font **font, UINT glyph )
     return 0;
 }
 
+/* shared glyph cache
+ *
+ * Rendered glyph bitmaps can optionally be shared between processes through a named section,
+ * enabled by setting HKCU\Software\Wine\Fonts\SharedGlyphCache to the cache size in megabytes.
+ * The cache is set-associative with LRU replacement inside each set. Every entry is protected
+ * by a sequence counter that is odd while the entry is being written; readers never wait and
+ * simply treat a busy or modified entry as a miss.
+ */
+
+#define GLYPH_CACHE_MAGIC     0x48434757  /* "WGCH" */
+#define GLYPH_CACHE_WAYS      8
+#define GLYPH_CACHE_MAX_BITS  1024
+#define GLYPH_CACHE_MAX_SIZE  256  /* in megabytes */
+
+struct glyph_cache_key
+{
+    ULONGLONG              file_hash;
+    FILETIME               writetime;
+    UINT                   face_index;
+    UINT                   glyph;
+    UINT                   format;
+    BOOL                   tategaki;
+    LOGFONTW               lf;
+    FMAT2                  matrix;
+    MAT2                   mat;
+};
+
+struct glyph_cache_entry
+{
+    unsigned int           seq;        /* odd while the entry is being written */
+    unsigned int           last_used;
+    unsigned int           hash;       /* 0 if the entry is unused */
+    DWORD                  size;       /* size of the glyph bits */
+    struct glyph_cache_key key;
+    GLYPHMETRICS           gm;
+    ABC                    abc;
+    BYTE                   bits[GLYPH_CACHE_MAX_BITS];
+};
+
+struct glyph_cache_header
+{
+    unsigned int           magic;      /* set once the header is initialized */
+    LONG                   init;
+    unsigned int           sets;
+    LONG                   clock;
+    LONG                   hits;
+    LONG                   misses;
+    LONG                   evictions;
+    struct glyph_cache_entry entries[1];
+};
+
+static struct glyph_cache_header *glyph_cache;
+static unsigned int glyph_cache_lookups;
+
+static void init_glyph_cache( DWORD size_mb )
+{
+    static const WCHAR nameW[] =
+        {'\\','B','a','s','e','N','a','m','e','d','O','b','j','e','c','t','s',
+         '\\','_','_','w','i','n','e','_','g','l','y','p','h','_','c','a','c','h','e'};
+    UNICODE_STRING name = { sizeof(nameW), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr;
+    struct glyph_cache_header *header = NULL;
+    LARGE_INTEGER section_size;
+    SIZE_T view_size = 0;
+    HANDLE section;
+    NTSTATUS status;
+
+    section_size.QuadPart = (LONGLONG)min( size_mb, GLYPH_CACHE_MAX_SIZE ) << 20;
+    InitializeObjectAttributes( &attr, &name, OBJ_OPENIF, 0, NULL );
+    status = NtCreateSection( &section, SECTION_MAP_READ | SECTION_MAP_WRITE | SECTION_QUERY, &attr,
+                              &section_size, PAGE_READWRITE, SEC_COMMIT, 0 );
+    if (status && status != STATUS_OBJECT_NAME_EXISTS)
+    {
+        WARN( "failed to create glyph cache section, status %#x\n", (int)status );
+        return;
+    }
+    status = NtMapViewOfSection( section, GetCurrentProcess(), (void **)&header, 0, 0, NULL,
+                                 &view_size, ViewShare, 0, PAGE_READWRITE );
+    NtClose( section );
+    if (status) return;
+
+    if (!InterlockedCompareExchange( &header->init, 1, 0 ))
+    {
+        header->sets = (view_size - offsetof( struct glyph_cache_header, entries ))
+                       / sizeof(struct glyph_cache_entry) / GLYPH_CACHE_WAYS;
+        __atomic_store_n( &header->magic, GLYPH_CACHE_MAGIC, __ATOMIC_RELEASE );
+    }
+    glyph_cache = header;
+    TRACE( "mapped %lu byte glyph cache\n", (unsigned long)view_size );
+}
+
+static BOOL is_glyph_cache_format( UINT format )
+{
+    switch (format & ~GGO_UNHINTED)
+    {
+    case GGO_BITMAP:
+    case GGO_GRAY2_BITMAP:
+    case GGO_GRAY4_BITMAP:
+    case GGO_GRAY8_BITMAP:
+    case WINE_GGO_HRGB_BITMAP:
+    case WINE_GGO_HBGR_BITMAP:
+    case WINE_GGO_VRGB_BITMAP:
+    case WINE_GGO_VBGR_BITMAP:
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* build the cache key, return the set that holds it or NULL if the glyph can't be cached */
+static struct glyph_cache_entry *get_glyph_cache_set( struct gdi_font *font, UINT index, UINT format,
+                                                      const MAT2 *mat, BOOL tategaki,
+                                                      struct glyph_cache_key *key, unsigned int *hash )
+{
+    ULONGLONG h = 0xcbf29ce484222325ull;
+    const BYTE *ptr;
+    const WCHAR *p;
+    unsigned int i;
+
+    if (!glyph_cache || __atomic_load_n( &glyph_cache->magic, __ATOMIC_ACQUIRE ) != GLYPH_CACHE_MAGIC)
+        return NULL;
+    if (!glyph_cache->sets || !font->file[0] || !is_glyph_cache_format( format )) return NULL;
+
+    memset( key, 0, sizeof(*key) );
+    for (p = font->file; *p; p++) key->file_hash = (key->file_hash ^ *p) * 0x100000001b3ull + 1;
+    key->writetime  = font->writetime;
+    key->face_index = font->face_index;
+    key->glyph      = index;
+    key->format     = format;
+    key->tategaki   = tategaki;
+    key->lf         = font->lf;
+    key->matrix     = font->matrix;
+    key->mat        = mat ? *mat : identity;
+
+    for (i = 0, ptr = (const BYTE *)key; i < sizeof(*key); i++) h = (h ^ ptr[i]) * 0x100000001b3ull;
+    *hash = (unsigned int)(h >> 32) | 1;
+    return &glyph_cache->entries[(h % glyph_cache->sets) * GLYPH_CACHE_WAYS];
+}
+
+static void report_glyph_cache_stats(void)
+{
+    if (++glyph_cache_lookups % 4096) return;
+    TRACE( "glyph cache: %d hits, %d misses, %d evictions\n", (int)glyph_cache->hits,
+           (int)glyph_cache->misses, (int)glyph_cache->evictions );
+}
+
+static DWORD find_cached_glyph( struct gdi_font *font, UINT index, UINT format, const MAT2 *mat,
+                                BOOL tategaki, GLYPHMETRICS *gm, ABC *abc, DWORD buflen, void *buf )
+{
+    struct glyph_cache_entry *set, *entry;
+    struct glyph_cache_key key;
+    unsigned int i, seq, hash;
+    DWORD size;
+
+    if (!(set = get_glyph_cache_set( font, index, format, mat, tategaki, &key, &hash ))) return GDI_ERROR;
+
+    for (i = 0; i < GLYPH_CACHE_WAYS; i++)
+    {
+        entry = &set[i];
+        seq = __atomic_load_n( &entry->seq, __ATOMIC_ACQUIRE );
+        if ((seq & 1) || entry->hash != hash) continue;
+        if (memcmp( &entry->key, &key, sizeof(key) )) continue;
+        size = entry->size;
+        if (size > GLYPH_CACHE_MAX_BITS) continue;
+        if (buflen && size > buflen) break;
+        *gm = entry->gm;
+        *abc = entry->abc;
+        if (buflen && buf) memcpy( buf, entry->bits, size );
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        if (__atomic_load_n( &entry->seq, __ATOMIC_RELAXED ) != seq) break;
+
+        entry->last_used = InterlockedIncrement( &glyph_cache->clock );
+        InterlockedIncrement( &glyph_cache->hits );
+        report_glyph_cache_stats();
+        return size;
+    }
+    InterlockedIncrement( &glyph_cache->misses );
+    report_glyph_cache_stats();
+    return GDI_ERROR;
+}
+
+static void add_glyph_to_cache( struct gdi_font *font, UINT index, UINT format, const MAT2 *mat,
+                                BOOL tategaki, const GLYPHMETRICS *gm, const ABC *abc,
+                                DWORD size, const void *bits )
+{
+    struct glyph_cache_entry *set, *entry = NULL;
+    struct glyph_cache_key key;
+    unsigned int i, seq, hash;
+
+    if (size > GLYPH_CACHE_MAX_BITS) return;
+    if (!(set = get_glyph_cache_set( font, index, format, mat, tategaki, &key, &hash ))) return;
+
+    /* use a free entry, or replace the least recently used one of the set. Entries being written
+     * are skipped, so a process that died while writing one only takes that entry out of the set. */
+    for (i = 0; i < GLYPH_CACHE_WAYS; i++)
+    {
+        if (__atomic_load_n( &set[i].seq, __ATOMIC_ACQUIRE ) & 1) continue;
+        if (!set[i].hash)
+        {
+            if (!entry || entry->hash) entry = &set[i];
+            continue;
+        }
+        /* another thread or process already added it */
+        if (set[i].hash == hash && !memcmp( &set[i].key, &key, sizeof(key) )) return;
+        if (!entry || (entry->hash && (int)(set[i].last_used - entry->last_used) < 0)) entry = &set[i];
+    }
+    if (!entry) return;
+
+    seq = __atomic_load_n( &entry->seq, __ATOMIC_RELAXED );
+    if ((seq & 1) || !__atomic_compare_exchange_n( &entry->seq, &seq, seq + 1, FALSE,
+                                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ))
+        return;  /* another process is writing it */
+
+    if (entry->hash) InterlockedIncrement( &glyph_cache->evictions );
+    entry->hash = hash;
+    entry->key = key;
+    entry->size = size;
+    entry->gm = *gm;
+    entry->abc = *abc;
+    memcpy( entry->bits, bits, size );
+    entry->last_used = InterlockedIncrement( &glyph_cache->clock );
+    __atomic_store_n( &entry->seq, seq + 2, __ATOMIC_RELEASE );
+}
+
 static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
                                 GLYPHMETRICS *gm_ret, ABC *abc_ret, DWORD buflen, void *buf,
                                 const MAT2 *mat )
@@ -3390,12 +3937,32 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
     if (format == GGO_METRICS && !mat && get_gdi_font_glyph_metrics( font, index, &gm, &abc ))
         goto done;
 
+    if (glyph_cache &&
+        (ret = find_cached_glyph( font, index, format, mat, tategaki, &gm, &abc, buflen, buf )) != GDI_ERROR)
+        goto done;
+
     ret = font_funcs->get_glyph_outline( font, index, format, &gm, &abc, buflen, buf, mat, tategaki );
     if (ret == GDI_ERROR) return ret;
 
     if (format == GGO_METRICS && !mat)
         set_gdi_font_glyph_metrics( font, index, &gm, &abc );
 
+    if (glyph_cache && ret <= GLYPH_CACHE_MAX_BITS && is_glyph_cache_format( format ))
+    {
+        if (buf && buflen >= ret)
+            add_glyph_to_cache( font, index, format, mat, tategaki, &gm, &abc, ret, buf );
+        else if (!buflen)  /* size query, render the bits now so that the following call hits the cache */
+        {
+            BYTE bits[GLYPH_CACHE_MAX_BITS];
+            GLYPHMETRICS gm2;
+            ABC abc2;
+
+            if (font_funcs->get_glyph_outline( font, index, format, &gm2, &abc2, ret, bits,
+                                               mat, tategaki ) == ret)
+                add_glyph_to_cache( font, index, format, mat, tategaki, &gm2, &abc2, ret, bits );
+        }
+    }
+
 done:
     if (gm_ret) *gm_ret = gm;
     if (abc_ret) *abc_ret = abc;
@@ -4303,7 +4870,7 @@ const struct gdi_dc_funcs font_driver =
     GDI_PRIORITY_FONT_DRV           /* priority */
 };
 
-static BOOL get_key_value( HKEY key, const char *name, DWORD *value )
+BOOL get_key_value( HKEY key, const char *name, DWORD *value )
 {
     char value_buffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[12 * sizeof(WCHAR)])];
     KEY_VALUE_PARTIAL_INFORMATION *info = (void *)value_buffer;
@@ -6052,6 +6619,8 @@ static void load_system_bitmap_fonts(void)
 
 static void load_directory_fonts( WCHAR *path, UINT flags )
 {
+    const struct font_dir_cache_dir *cached;
+    FILE_BASIC_INFORMATION basic_info;
     OBJECT_ATTRIBUTES attr;
     UNICODE_STRING nt_name;
     IO_STATUS_BLOCK io;
@@ -6077,6 +6646,17 @@ static void load_directory_fonts( WCHAR *path, UINT flags )
                     FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT | FILE_OPEN_FOR_BACKUP_INTENT ))
         return;
 
+    if (!NtQueryInformationFile( handle, &io, &basic_info, sizeof(basic_info), FileBasicInformation ))
+    {
+        if ((cached = find_font_dir_in_cache( path, len, flags, basic_info.LastWriteTime.QuadPart )) &&
+            load_font_dir_from_cache( cached ))
+        {
+            NtClose( handle );
+            return;
+        }
+        begin_font_dir_cache_record( path, len, flags, basic_info.LastWriteTime.QuadPart );
+    }
+
     path[len++] = '\\';
 
     while (!NtQueryDirectoryFile( handle, 0, NULL, NULL, &io, buf, sizeof(buf),
@@ -6097,6 +6677,7 @@ static void load_directory_fonts( WCHAR *path, UINT flags )
         }
     }
 
+    end_font_dir_cache_record();
     NtClose( handle );
 }
 
@@ -6106,6 +6687,8 @@ static void load_file_system_fonts(void)
     KEY_VALUE_PARTIAL_INFORMATION *info = (void *)value_buffer;
     WCHAR *ptr, *next, path[MAX_PATH];
 
+    map_font_dir_cache();
+
     /* Windows directory */
     get_fonts_win_dir_path( NULL, path );
     load_directory_fonts( path, 0 );
@@ -6132,6 +6715,11 @@ static void load_file_system_fonts(void)
             load_directory_fonts( path, ADDFONT_EXTERNAL_FONT );
         }
     }
+
+    /* unmap the old cache first, we couldn't replace it otherwise */
+    unmap_font_dir_cache();
+    write_font_dir_cache();
+    free_font_dir_cache();
 }
 
 struct external_key
@@ -6309,7 +6897,7 @@ UINT font_init(void)
     OBJECT_ATTRIBUTES attr = { sizeof(attr) };
     UNICODE_STRING name;
     HANDLE mutex;
-    DWORD disposition;
+    DWORD disposition, cache_size;
     UINT dpi = 0;
 
     static WCHAR wine_font_mutexW[] =
@@ -6328,6 +6916,10 @@ UINT font_init(void)
     if (!(font_funcs = init_freetype_lib()))
         return dpi;
 
+    /* @@ Wine registry key: HKCU\Software\Wine\Fonts */
+    if (get_key_value( wine_fonts_key, "SharedGlyphCache", &cache_size ) && cache_size)
+        init_glyph_cache( cache_size );
+
     load_system_bitmap_fonts();
     load_file_system_fonts();
     font_funcs->load_fonts();
@@ -222,16 +222,19 @@ BOOL get_cursor_pos( POINT *pt )
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if (!(ret = get_shared_cursor_pos( pt, &last_change )))
     {
-        if ((ret = !wine_server_call( req )))
+        SERVER_START_REQ( set_cursor )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
         }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && NtGetTickCount() - last_change > 100) ret = user_driver->pGetCursorPos( pt );
@@ -280,13 +283,17 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
 {
     struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
     INT counter = global_key_state_counter;
-    BYTE prev_key_state;
+    BYTE prev_key_state, state;
     SHORT ret;
 
     if (key < 0 || key >= 256) return 0;
 
     check_for_events( QS_INPUT );
 
+    /* the server needs to clear the pressed bit when it's set */
+    if (get_shared_async_key_state( key, &state ) && !(state & 0x40))
+        return (state & 0x80) ? 0x8000 : 0;
+
     if (key_state_info && !(key_state_info->state[key] & 0xc0) &&
         key_state_info->counter == counter && NtGetTickCount() - key_state_info->time < 50)
     {
@@ -336,6 +343,7 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
  */
 DWORD WINAPI NtUserGetQueueStatus( UINT flags )
 {
+    UINT wake_bits, changed_bits;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -346,6 +354,10 @@ DWORD WINAPI NtUserGetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* no need to call the server if there are no changed bits to clear */
+    if (get_shared_queue_bits( FALSE, &wake_bits, &changed_bits, NULL, NULL ) && !(changed_bits & flags))
+        return MAKELONG( 0, wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -361,10 +373,14 @@ DWORD WINAPI NtUserGetQueueStatus( UINT flags )
  */
 DWORD get_input_state(void)
 {
+    UINT wake_bits, changed_bits;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if (get_shared_queue_bits( FALSE, &wake_bits, &changed_bits, NULL, NULL ))
+        return wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
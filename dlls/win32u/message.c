@@ -1777,6 +1777,186 @@ static BOOL process_hardware_message( MSG *msg, UINT hw_id, const struct hardwar
     return ret;
 }
 
+/***********************************************************************
+ *           get_server_queue_handle
+ *
+ * Get a handle to the server message queue for the current thread.
+ */
+static HANDLE get_server_queue_handle(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    HANDLE ret;
+
+    if (!(ret = thread_info->server_queue))
+    {
+        SERVER_START_REQ( get_msg_queue )
+        {
+            wine_server_call( req );
+            ret = wine_server_ptr_handle( reply->handle );
+            thread_info->queue_shm_slot = reply->shm_slot;
+        }
+        SERVER_END_REQ;
+        thread_info->server_queue = ret;
+        if (!ret) ERR( "Cannot get server thread queue\n" );
+    }
+    return ret;
+}
+
+/* map the message queue and desktop state shared by the server */
+static const input_shm_t *get_input_shm(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','i','n','p','u','t','_','s','h','m',0};
+    static const input_shm_t *input_shm;
+    static BOOL failed;
+    UNICODE_STRING name_str = { sizeof(nameW) - sizeof(WCHAR), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr = { sizeof(attr), 0, &name_str };
+    SIZE_T size = 0;
+    HANDLE section;
+    void *ptr = NULL;
+
+    if (input_shm || failed) return input_shm;
+
+    if (!NtOpenSection( &section, SECTION_MAP_READ, &attr ))
+    {
+        if (NtMapViewOfSection( section, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                                ViewShare, 0, PAGE_READONLY ))
+            ptr = NULL;
+        NtClose( section );
+    }
+    if (!ptr)
+    {
+        WARN( "shared input state not available\n" );
+        failed = TRUE;
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&input_shm, ptr, NULL ))
+        NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+    return input_shm;
+}
+
+/* get the shared state of the thread queue, optionally creating the queue */
+static const queue_shm_t *get_queue_shm( BOOL create )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    const input_shm_t *input_shm;
+
+    if (!thread_info->server_queue && (!create || !get_server_queue_handle())) return NULL;
+    if (thread_info->queue_shm_slot == INPUT_SHM_NO_SLOT) return NULL;
+    if (!(input_shm = get_input_shm())) return NULL;
+    return &input_shm->queues[thread_info->queue_shm_slot];
+}
+
+/* the server makes the sequence counter odd while it is modifying the shared state */
+static unsigned int shm_read_begin( const volatile unsigned int *seq )
+{
+    unsigned int ret;
+
+    while ((ret = __atomic_load_n( seq, __ATOMIC_ACQUIRE )) & 1) YieldProcessor();
+    return ret;
+}
+
+static BOOL shm_read_retry( const volatile unsigned int *seq, unsigned int start )
+{
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return __atomic_load_n( seq, __ATOMIC_RELAXED ) != start;
+}
+
+/***********************************************************************
+ *           get_shared_queue_bits
+ *
+ * Read the thread queue bits and masks without a server call.
+ */
+BOOL get_shared_queue_bits( BOOL create, UINT *wake_bits, UINT *changed_bits,
+                            UINT *wake_mask, UINT *changed_mask )
+{
+    const queue_shm_t *shm;
+    unsigned int seq;
+
+    if (!(shm = get_queue_shm( create ))) return FALSE;
+    do
+    {
+        seq = shm_read_begin( &shm->seq );
+        *wake_bits    = shm->wake_bits;
+        *changed_bits = shm->changed_bits;
+        if (wake_mask) *wake_mask = shm->wake_mask;
+        if (changed_mask) *changed_mask = shm->changed_mask;
+    } while (shm_read_retry( &shm->seq, seq ));
+    return TRUE;
+}
+
+/* get the shared state of the desktop of the thread input */
+static const desktop_shm_t *get_desktop_shm( BOOL create )
+{
+    const queue_shm_t *shm;
+    unsigned int seq, slot;
+
+    if (!(shm = get_queue_shm( create ))) return NULL;
+    do
+    {
+        seq = shm_read_begin( &shm->seq );
+        slot = shm->desktop_slot;
+    } while (shm_read_retry( &shm->seq, seq ));
+    if (slot == INPUT_SHM_NO_SLOT) return NULL;
+    return &get_input_shm()->desktops[slot];
+}
+
+/***********************************************************************
+ *           get_shared_cursor_pos
+ *
+ * Read the desktop cursor position without a server call.
+ */
+BOOL get_shared_cursor_pos( POINT *pt, DWORD *last_change )
+{
+    const desktop_shm_t *shm;
+    unsigned int seq;
+
+    /* the set_cursor request creates the queue anyway */
+    if (!(shm = get_desktop_shm( TRUE ))) return FALSE;
+    do
+    {
+        seq = shm_read_begin( &shm->seq );
+        pt->x = shm->cursor_x;
+        pt->y = shm->cursor_y;
+        *last_change = shm->cursor_change;
+    } while (shm_read_retry( &shm->seq, seq ));
+    return TRUE;
+}
+
+/***********************************************************************
+ *           get_shared_async_key_state
+ *
+ * Read the desktop async state of a key without a server call.
+ */
+BOOL get_shared_async_key_state( INT key, BYTE *state )
+{
+    const desktop_shm_t *shm;
+    unsigned int seq;
+
+    if (!(shm = get_desktop_shm( FALSE ))) return FALSE;
+    do
+    {
+        seq = shm_read_begin( &shm->seq );
+        *state = shm->keystate[key];
+    } while (shm_read_retry( &shm->seq, seq ));
+    return TRUE;
+}
+
+/* check in the shared state that get_message would only find an empty queue, with the
+ * same masks already set; the server still needs to be called every few seconds to
+ * avoid the queue being considered hung */
+static BOOL check_queue_empty( UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    UINT wake_bits, changed_bits, queue_wake_mask, queue_changed_mask;
+
+    if (NtGetTickCount() - thread_info->last_getmsg_time >= 3000) return FALSE;
+    if (!get_shared_queue_bits( TRUE, &wake_bits, &changed_bits, &queue_wake_mask, &queue_changed_mask ))
+        return FALSE;
+    return !wake_bits && !changed_bits && queue_changed_mask == changed_mask &&
+           queue_wake_mask == (changed_mask & (QS_SENDMESSAGE | QS_SMRESULT));
+}
+
 /***********************************************************************
  *           peek_message
  *
@@ -1794,11 +1974,18 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
     void *buffer;
     size_t buffer_size = 1024;
 
-    if (!(buffer = malloc( buffer_size ))) return -1;
-
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    if (hwnd != HWND_TOPMOST && check_queue_empty( changed_mask ))
+    {
+        thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+        thread_info->changed_mask = changed_mask;
+        return 0;
+    }
+
+    if (!(buffer = malloc( buffer_size ))) return -1;
+
     for (;;)
     {
         NTSTATUS res;
@@ -1835,6 +2022,7 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
             else buffer_size = reply->total;
         }
         SERVER_END_REQ;
+        thread_info->last_getmsg_time = NtGetTickCount();
 
         if (res)
         {
@@ -2054,30 +2242,6 @@ static void process_sent_messages(void)
     peek_message( &msg, 0, 0, 0, PM_REMOVE | PM_QS_SENDMESSAGE, 0 );
 }
 
-/***********************************************************************
- *           get_server_queue_handle
- *
- * Get a handle to the server message queue for the current thread.
- */
-static HANDLE get_server_queue_handle(void)
-{
-    struct user_thread_info *thread_info = get_user_thread_info();
-    HANDLE ret;
-
-    if (!(ret = thread_info->server_queue))
-    {
-        SERVER_START_REQ( get_msg_queue )
-        {
-            wine_server_call( req );
-            ret = wine_server_ptr_handle( reply->handle );
-        }
-        SERVER_END_REQ;
-        thread_info->server_queue = ret;
-        if (!ret) ERR( "Cannot get server thread queue\n" );
-    }
-    return ret;
-}
-
 /* check for driver events if we detect that the app is not properly consuming messages */
 static inline void check_for_driver_events( UINT msg )
 {
@@ -120,6 +120,8 @@ struct user_thread_info
 {
     struct ntuser_thread_info     client_info;            /* Data shared with client */
     HANDLE                        server_queue;           /* Handle to server-side queue */
+    UINT                          queue_shm_slot;         /* Slot of the queue in the shared input state */
+    DWORD                         last_getmsg_time;       /* Time of last get_message server call */
     DWORD                         wake_mask;              /* Current queue wake mask */
     DWORD                         changed_mask;           /* Current queue changed mask */
     WORD                          message_count;          /* Get/PeekMessage loop counter */
@@ -300,6 +300,10 @@ extern void track_keyboard_menu_bar( HWND hwnd, UINT wparam, WCHAR ch ) DECLSPEC
 extern void track_mouse_menu_bar( HWND hwnd, INT ht, int x, int y ) DECLSPEC_HIDDEN;
 
 /* message.c */
+extern BOOL get_shared_async_key_state( INT key, BYTE *state ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_cursor_pos( POINT *pt, DWORD *last_change ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_queue_bits( BOOL create, UINT *wake_bits, UINT *changed_bits,
+                                   UINT *wake_mask, UINT *changed_mask ) DECLSPEC_HIDDEN;
 extern BOOL kill_system_timer( HWND hwnd, UINT_PTR id ) DECLSPEC_HIDDEN;
 extern BOOL reply_message_result( LRESULT result ) DECLSPEC_HIDDEN;
 extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, const RAWINPUT *rawinput,
@@ -19,6 +19,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 static const struct wined3d_state_entry_template misc_state_template_vk[] =
 {
@@ -376,6 +377,241 @@ static const struct wined3d_allocator_ops wined3d_allocator_vk_ops =
     .allocator_destroy_chunk = wined3d_allocator_vk_destroy_chunk,
 };
 
+/* Vulkan pipeline cache
+ *
+ * Each device creates its pipelines through a VkPipelineCache, which is
+ * loaded from disk when the device is created and written back when it is
+ * destroyed. The file is keyed by the vendor and device IDs and by the
+ * pipelineCacheUUID of the driver, so a driver update simply starts a new
+ * file; the driver also validates the data itself. */
+
+#define WINED3D_PIPELINE_CACHE_MAGIC    0x43504b56 /* "VKPC" */
+#define WINED3D_PIPELINE_CACHE_VERSION  1
+
+/* Pipelines taking longer than this to create are likely to cause a visible stutter. */
+#define WINED3D_PIPELINE_HITCH_TIME     16000
+
+struct wined3d_pipeline_cache_header_vk
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t data_size;
+};
+
+static WCHAR *wined3d_pipeline_cache_vk_get_path(const struct wined3d_adapter_vk *adapter_vk)
+{
+    WCHAR *dir, *path;
+    unsigned int i;
+    size_t len;
+
+    if (!(dir = wined3d_get_cache_directory(L"vulkan")))
+        return NULL;
+
+    /* The vendor and device IDs are 32-bit, e.g. VK_VENDOR_ID_MESA is 0x10005. */
+    len = wcslen(dir) + 2 * 8 + 2 + 2 * VK_UUID_SIZE + 5;
+    if ((path = heap_alloc(len * sizeof(WCHAR))))
+    {
+        swprintf(path, len, L"%s%08x-%08x-", dir, adapter_vk->vendor_id, adapter_vk->device_id);
+        for (i = 0; i < VK_UUID_SIZE; ++i)
+            swprintf(path + wcslen(path), len - wcslen(path), L"%02x", adapter_vk->pipeline_cache_uuid[i]);
+        wcscat(path, L".bin");
+    }
+    heap_free(dir);
+
+    return path;
+}
+
+static void *wined3d_pipeline_cache_vk_load(const WCHAR *path, size_t *size)
+{
+    struct wined3d_pipeline_cache_header_vk header;
+    void *data = NULL;
+    LARGE_INTEGER file_size;
+    HANDLE file;
+    DWORD count;
+
+    *size = 0;
+    if ((file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (!GetFileSizeEx(file, &file_size)
+            || !ReadFile(file, &header, sizeof(header), &count, NULL) || count != sizeof(header)
+            || header.magic != WINED3D_PIPELINE_CACHE_MAGIC || header.version != WINED3D_PIPELINE_CACHE_VERSION
+            || header.data_size != file_size.QuadPart - sizeof(header)
+            || header.data_size > (uint64_t)wined3d_settings.shader_cache_size << 20
+            || !(data = heap_alloc(header.data_size)))
+        goto done;
+
+    if (!ReadFile(file, data, header.data_size, &count, NULL) || count != header.data_size)
+    {
+        heap_free(data);
+        data = NULL;
+        goto done;
+    }
+    *size = header.data_size;
+
+done:
+    CloseHandle(file);
+    return data;
+}
+
+static void wined3d_device_vk_pipeline_cache_init(struct wined3d_device_vk *device_vk,
+        const struct wined3d_adapter_vk *adapter_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    VkPipelineCacheCreateInfo cache_desc;
+    void *data = NULL;
+    size_t size = 0;
+    VkResult vr;
+
+    if ((device_vk->pipeline_cache_path = wined3d_pipeline_cache_vk_get_path(adapter_vk)))
+        data = wined3d_pipeline_cache_vk_load(device_vk->pipeline_cache_path, &size);
+
+    cache_desc.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_desc.pNext = NULL;
+    cache_desc.flags = 0;
+    cache_desc.initialDataSize = size;
+    cache_desc.pInitialData = data;
+
+    if ((vr = VK_CALL(vkCreatePipelineCache(device_vk->vk_device, &cache_desc, NULL,
+            &device_vk->vk_pipeline_cache))) < 0 && data)
+    {
+        WARN("Failed to create pipeline cache from %s, vr %s.\n",
+                debugstr_w(device_vk->pipeline_cache_path), wined3d_debug_vkresult(vr));
+        cache_desc.initialDataSize = 0;
+        cache_desc.pInitialData = NULL;
+        vr = VK_CALL(vkCreatePipelineCache(device_vk->vk_device, &cache_desc, NULL, &device_vk->vk_pipeline_cache));
+    }
+    heap_free(data);
+
+    if (vr < 0)
+    {
+        WARN("Failed to create pipeline cache, vr %s.\n", wined3d_debug_vkresult(vr));
+        device_vk->vk_pipeline_cache = VK_NULL_HANDLE;
+        return;
+    }
+
+    TRACE("Created pipeline cache 0x%s from %s, %Iu bytes.\n", wine_dbgstr_longlong(device_vk->vk_pipeline_cache),
+            debugstr_w(device_vk->pipeline_cache_path), size);
+}
+
+static void wined3d_device_vk_pipeline_cache_store(struct wined3d_device_vk *device_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    struct wined3d_pipeline_cache_header_vk header;
+    WCHAR tmp_path[MAX_PATH];
+    size_t size = 0;
+    void *data;
+    HANDLE file;
+    DWORD count;
+    BOOL ret;
+
+    if (!device_vk->pipeline_cache_path || !device_vk->pipeline_stats.count)
+        return;
+
+    if (VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, NULL)) < 0
+            || !size || size > (uint64_t)wined3d_settings.shader_cache_size << 20 || !(data = heap_alloc(size)))
+        return;
+    if (VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, data)) < 0)
+    {
+        heap_free(data);
+        return;
+    }
+
+    header.magic = WINED3D_PIPELINE_CACHE_MAGIC;
+    header.version = WINED3D_PIPELINE_CACHE_VERSION;
+    header.data_size = size;
+
+    /* Write to a temporary file first, other processes may be reading the cache. */
+    swprintf(tmp_path, ARRAY_SIZE(tmp_path), L"%s.%x", device_vk->pipeline_cache_path, GetCurrentThreadId());
+    if ((file = CreateFileW(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        heap_free(data);
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &count, NULL) && WriteFile(file, data, size, &count, NULL);
+    CloseHandle(file);
+    heap_free(data);
+
+    if (!ret || !MoveFileExW(tmp_path, device_vk->pipeline_cache_path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to store pipeline cache %s.\n", debugstr_w(device_vk->pipeline_cache_path));
+        DeleteFileW(tmp_path);
+        return;
+    }
+    TRACE("Stored %Iu bytes in pipeline cache %s.\n", size, debugstr_w(device_vk->pipeline_cache_path));
+}
+
+static void wined3d_device_vk_pipeline_cache_cleanup(struct wined3d_device_vk *device_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+
+    if (device_vk->pipeline_stats.count)
+        TRACE_(d3d_perf)("Created %s pipelines in %s us, %s took longer than %u us, the longest took %s us.\n",
+                wine_dbgstr_longlong(device_vk->pipeline_stats.count),
+                wine_dbgstr_longlong(device_vk->pipeline_stats.total_time),
+                wine_dbgstr_longlong(device_vk->pipeline_stats.hitch_count), WINED3D_PIPELINE_HITCH_TIME,
+                wine_dbgstr_longlong(device_vk->pipeline_stats.max_time));
+
+    if (device_vk->vk_pipeline_cache)
+    {
+        wined3d_device_vk_pipeline_cache_store(device_vk);
+        VK_CALL(vkDestroyPipelineCache(device_vk->vk_device, device_vk->vk_pipeline_cache, NULL));
+    }
+    heap_free(device_vk->pipeline_cache_path);
+}
+
+static void wined3d_device_vk_pipeline_stats_update(struct wined3d_device_vk *device_vk,
+        const LARGE_INTEGER *start, const char *type)
+{
+    LARGE_INTEGER end, frequency;
+    uint64_t time;
+
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&frequency);
+    time = (end.QuadPart - start->QuadPart) * 1000000 / frequency.QuadPart;
+
+    ++device_vk->pipeline_stats.count;
+    device_vk->pipeline_stats.total_time += time;
+    if (time > device_vk->pipeline_stats.max_time)
+        device_vk->pipeline_stats.max_time = time;
+    if (time > WINED3D_PIPELINE_HITCH_TIME)
+    {
+        ++device_vk->pipeline_stats.hitch_count;
+        WARN_(d3d_perf)("Creating %s pipeline took %s us (%s of %s pipelines so far).\n", type,
+                wine_dbgstr_longlong(time), wine_dbgstr_longlong(device_vk->pipeline_stats.hitch_count),
+                wine_dbgstr_longlong(device_vk->pipeline_stats.count));
+    }
+}
+
+VkResult wined3d_device_vk_create_compute_pipeline(struct wined3d_device_vk *device_vk,
+        const VkComputePipelineCreateInfo *desc, VkPipeline *pipeline)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    LARGE_INTEGER start;
+    VkResult vr;
+
+    QueryPerformanceCounter(&start);
+    vr = VK_CALL(vkCreateComputePipelines(device_vk->vk_device, device_vk->vk_pipeline_cache, 1, desc, NULL, pipeline));
+    wined3d_device_vk_pipeline_stats_update(device_vk, &start, "compute");
+
+    return vr;
+}
+
+VkResult wined3d_device_vk_create_graphics_pipeline(struct wined3d_device_vk *device_vk,
+        const VkGraphicsPipelineCreateInfo *desc, VkPipeline *pipeline)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    LARGE_INTEGER start;
+    VkResult vr;
+
+    QueryPerformanceCounter(&start);
+    vr = VK_CALL(vkCreateGraphicsPipelines(device_vk->vk_device, device_vk->vk_pipeline_cache, 1, desc, NULL, pipeline));
+    wined3d_device_vk_pipeline_stats_update(device_vk, &start, "graphics");
+
+    return vr;
+}
+
 static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wined3d_adapter *adapter,
         enum wined3d_device_type device_type, HWND focus_window, unsigned int flags, BYTE surface_alignment,
         const enum wined3d_feature_level *levels, unsigned int level_count,
@@ -492,10 +728,13 @@ static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wi
         goto fail;
     }
 
+    wined3d_device_vk_pipeline_cache_init(device_vk, adapter_vk);
+
     if (FAILED(hr = wined3d_device_init(&device_vk->d, wined3d, adapter->ordinal, device_type, focus_window,
             flags, surface_alignment, levels, level_count, vk_info->supported, device_parent)))
     {
         WARN("Failed to initialize device, hr %#x.\n", hr);
+        wined3d_device_vk_pipeline_cache_cleanup(device_vk);
         wined3d_allocator_cleanup(&device_vk->allocator);
         goto fail;
     }
@@ -518,6 +757,7 @@ static void adapter_vk_destroy_device(struct wined3d_device *device)
     const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
 
     wined3d_device_cleanup(&device_vk->d);
+    wined3d_device_vk_pipeline_cache_cleanup(device_vk);
     wined3d_allocator_cleanup(&device_vk->allocator);
 
     wined3d_lock_cleanup(&device_vk->allocator_cs);
@@ -2494,6 +2734,9 @@ static BOOL wined3d_adapter_vk_init(struct wined3d_adapter_vk *adapter_vk,
     else
         VK_CALL(vkGetPhysicalDeviceProperties(adapter_vk->physical_device, &properties2.properties));
     adapter_vk->device_limits = properties2.properties.limits;
+    adapter_vk->vendor_id = properties2.properties.vendorID;
+    adapter_vk->device_id = properties2.properties.deviceID;
+    memcpy(adapter_vk->pipeline_cache_uuid, properties2.properties.pipelineCacheUUID, VK_UUID_SIZE);
 
     VK_CALL(vkGetPhysicalDeviceMemoryProperties(adapter_vk->physical_device, &adapter_vk->memory_properties));
 
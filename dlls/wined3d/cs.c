@@ -2619,6 +2619,61 @@ void wined3d_device_context_emit_blt_sub_resource(struct wined3d_device_context
         wined3d_device_context_finish(context, WINED3D_CS_QUEUE_DEFAULT);
 }
 
+/* Each upload ring allocation is preceded by a header holding the ring
+ * position just past its end, which becomes the new tail when it is released.
+ * Positions are free-running and only reduced modulo the ring size when
+ * addressing the data, so "head - tail" is always the amount in use. */
+#define WINED3D_UPLOAD_RING_HEADER_SIZE 16u
+
+static void *wined3d_upload_ring_alloc(struct wined3d_upload_ring *ring, size_t size)
+{
+    ULONG offset, padding, tail, used;
+    BYTE *ptr;
+
+    if (!ring->data)
+        return NULL;
+
+    size = (size + WINED3D_UPLOAD_RING_HEADER_SIZE + WINED3D_UPLOAD_RING_HEADER_SIZE - 1)
+            & ~(size_t)(WINED3D_UPLOAD_RING_HEADER_SIZE - 1);
+    /* Leave large uploads to the heap instead of letting them monopolise the ring. */
+    if (size > WINED3D_UPLOAD_RING_SIZE / 4)
+        return NULL;
+
+    offset = ring->head % WINED3D_UPLOAD_RING_SIZE;
+    padding = offset + size > WINED3D_UPLOAD_RING_SIZE ? WINED3D_UPLOAD_RING_SIZE - offset : 0;
+
+    tail = *(volatile ULONG *)&ring->tail;
+    used = ring->head - tail;
+    if (used + padding + size > WINED3D_UPLOAD_RING_SIZE)
+    {
+        if (!(ring->full_count++ % 256))
+            WARN_(d3d_perf)("Upload ring full, %u bytes in flight, falling back to heap memory (%u times).\n",
+                    used, ring->full_count);
+        return NULL;
+    }
+
+    if (padding)
+    {
+        ring->head += padding;
+        offset = 0;
+        if (!(ring->wrap_count++ % 1024))
+            TRACE_(d3d_perf)("Upload ring wrapped around %u times.\n", ring->wrap_count);
+    }
+
+    ring->head += size;
+    ptr = &ring->data[offset];
+    *(ULONG *)ptr = ring->head;
+
+    return ptr + WINED3D_UPLOAD_RING_HEADER_SIZE;
+}
+
+static void wined3d_upload_ring_release(struct wined3d_upload_ring *ring, const void *data)
+{
+    const ULONG *end = (const ULONG *)((const BYTE *)data - WINED3D_UPLOAD_RING_HEADER_SIZE);
+
+    InterlockedExchange((LONG *)&ring->tail, *end);
+}
+
 static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_update_sub_resource *op = data;
@@ -2637,7 +2692,9 @@ static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const voi
 
     context_release(context);
 
-    if (op->bo.flags & UPLOAD_BO_FREE_ON_UNMAP)
+    if (op->bo.flags & UPLOAD_BO_RING_ON_UNMAP)
+        wined3d_upload_ring_release(&cs->upload_ring, op->bo.addr.addr);
+    else if (op->bo.flags & UPLOAD_BO_FREE_ON_UNMAP)
     {
         if (op->bo.addr.buffer_object)
             FIXME("Free BO address %s.\n", debug_const_bo_address(&op->bo.addr));
@@ -2951,6 +3008,7 @@ static void wined3d_cs_st_finish(struct wined3d_device_context *context, enum wi
 static bool wined3d_cs_map_upload_bo(struct wined3d_device_context *context, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, struct wined3d_map_desc *map_desc, const struct wined3d_box *box, uint32_t flags)
 {
+    struct wined3d_cs *cs = wined3d_cs_from_context(context);
     struct wined3d_client_resource *client = &resource->client;
     const struct wined3d_format *format = resource->format;
     size_t size;
@@ -3054,14 +3112,23 @@ static bool wined3d_cs_map_upload_bo(struct wined3d_device_context *context, str
             + ((box->bottom - box->top - 1) / format->block_height) * map_desc->row_pitch
             + ((box->right - box->left + format->block_width - 1) / format->block_width) * format->block_byte_count;
 
-    if (!(map_desc->data = heap_alloc(size)))
+    /* The CS thread releases ring allocations in submission order, which
+     * doesn't hold for commands it emits and executes itself. */
+    if (cs->thread_id != GetCurrentThreadId() && (map_desc->data = wined3d_upload_ring_alloc(&cs->upload_ring, size)))
+    {
+        client->mapped_upload.flags = UPLOAD_BO_UPLOAD_ON_UNMAP | UPLOAD_BO_RING_ON_UNMAP;
+    }
+    else if ((map_desc->data = heap_alloc(size)))
+    {
+        client->mapped_upload.flags = UPLOAD_BO_UPLOAD_ON_UNMAP | UPLOAD_BO_FREE_ON_UNMAP;
+    }
+    else
     {
         WARN_(d3d_perf)("Failed to allocate a heap memory buffer.\n");
         return false;
     }
     client->mapped_upload.addr.buffer_object = 0;
     client->mapped_upload.addr.addr = map_desc->data;
-    client->mapped_upload.flags = UPLOAD_BO_UPLOAD_ON_UNMAP | UPLOAD_BO_FREE_ON_UNMAP;
     client->mapped_box = *box;
     return true;
 }
@@ -3253,8 +3320,23 @@ static void poll_queries(struct wined3d_cs *cs)
     }
 }
 
-static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+/* Adjust how long the CS thread spins before blocking on its event. A wait
+ * that ends sooner than the time already spent spinning would have been
+ * avoided by spinning a little longer, while a much longer wait means the
+ * thread is idle and is only burning CPU time that the application's own
+ * threads could use. */
+static void wined3d_cs_update_spin_limit(struct wined3d_cs *cs, LONGLONG spin_time, LONGLONG wait_time)
+{
+    if (wait_time < spin_time)
+        cs->spin_limit = min(cs->spin_limit * 2, WINED3D_CS_SPIN_COUNT);
+    else if (wait_time / 4 > spin_time)
+        cs->spin_limit = max(cs->spin_limit / 2, WINED3D_CS_SPIN_COUNT_MIN);
+}
+
+static void wined3d_cs_wait_event(struct wined3d_cs *cs, const LARGE_INTEGER *spin_start)
 {
+    LARGE_INTEGER wait_start, wait_end;
+
     InterlockedExchange(&cs->waiting_for_event, TRUE);
 
     /* The main thread might have enqueued a command and blocked on it after
@@ -3269,7 +3351,12 @@ static void wined3d_cs_wait_event(struct wined3d_cs *cs)
             && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         return;
 
+    QueryPerformanceCounter(&wait_start);
     WaitForSingleObject(cs->event, INFINITE);
+    QueryPerformanceCounter(&wait_end);
+
+    wined3d_cs_update_spin_limit(cs, wait_start.QuadPart - spin_start->QuadPart,
+            wait_end.QuadPart - wait_start.QuadPart);
 }
 
 static void wined3d_cs_command_lock(const struct wined3d_cs *cs)
@@ -3348,6 +3435,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
 {
     struct wined3d_cs_queue *queue;
     unsigned int spin_count = 0;
+    LARGE_INTEGER spin_start;
     struct wined3d_cs *cs = ctx;
     HMODULE wined3d_module;
     unsigned int poll = 0;
@@ -3377,8 +3465,13 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
-                    wined3d_cs_wait_event(cs);
+                if (!spin_count++)
+                    QueryPerformanceCounter(&spin_start);
+                if (spin_count >= cs->spin_limit && list_empty(&cs->query_poll_list))
+                {
+                    wined3d_cs_wait_event(cs, &spin_start);
+                    spin_count = 0;
+                }
                 continue;
             }
         }
@@ -3434,11 +3527,15 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
             && !RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
     {
         cs->c.ops = &wined3d_cs_mt_ops;
+        cs->spin_limit = WINED3D_CS_SPIN_COUNT;
+        if (!(cs->upload_ring.data = heap_alloc(WINED3D_UPLOAD_RING_SIZE)))
+            WARN("Failed to allocate the upload ring.\n");
 
         if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
         {
             ERR("Failed to create command stream event.\n");
             heap_free(cs->data);
+            heap_free(cs->upload_ring.data);
             goto fail;
         }
 
@@ -3448,6 +3545,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
             ERR("Failed to get wined3d module handle.\n");
             CloseHandle(cs->event);
             heap_free(cs->data);
+            heap_free(cs->upload_ring.data);
             goto fail;
         }
 
@@ -3457,6 +3555,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
             FreeLibrary(cs->wined3d_module);
             CloseHandle(cs->event);
             heap_free(cs->data);
+            heap_free(cs->upload_ring.data);
             goto fail;
         }
     }
@@ -3478,6 +3577,10 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
         CloseHandle(cs->thread);
         if (!CloseHandle(cs->event))
             ERR("Closing event failed.\n");
+        if (cs->upload_ring.wrap_count || cs->upload_ring.full_count)
+            TRACE_(d3d_perf)("Upload ring wrapped around %u times, was full %u times.\n",
+                    cs->upload_ring.wrap_count, cs->upload_ring.full_count);
+        heap_free(cs->upload_ring.data);
     }
 
     wined3d_state_destroy(cs->c.state);
@@ -122,6 +122,15 @@ struct constant_heap
 };
 
 /* GLSL shader private data */
+struct glsl_program_cache
+{
+    WCHAR *path;        /* cache directory, NULL if the cache is disabled */
+    BOOL initialised;   /* the driver hash has been computed */
+    uint64_t driver_hash[2];
+    uint64_t size;      /* approximate size of the cache directory */
+    uint64_t max_size;
+};
+
 struct shader_glsl_priv
 {
     struct wined3d_string_buffer shader_buffer;
@@ -138,6 +147,8 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct glsl_program_cache program_cache;
 };
 
 struct glsl_vs_program
@@ -636,6 +647,307 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* GLSL program binary cache
+ *
+ * Linked programs are saved with glGetProgramBinary() and reloaded by later
+ * processes, keyed by a hash of the driver strings, of the link state and of
+ * the source of every attached shader. Each program is stored in its own file,
+ * and the least recently used files are removed when the cache grows past its
+ * size limit. Any failure simply falls back to a regular link. */
+
+#define WINED3D_GLSL_CACHE_MAGIC    0x43534c47 /* "GLSC" */
+#define WINED3D_GLSL_CACHE_VERSION  1
+
+struct glsl_program_cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash[2];
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+static void glsl_program_cache_hash(uint64_t hash[2], const void *data, size_t size)
+{
+    const uint8_t *ptr = data;
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+    {
+        hash[0] = (hash[0] ^ ptr[i]) * 0x100000001b3ull;
+        hash[1] = (hash[1] ^ ptr[i]) * 0x100000001b3ull + (hash[0] >> 32);
+    }
+    hash[1] ^= size;
+}
+
+static void glsl_program_cache_get_file_name(const struct glsl_program_cache *cache,
+        const uint64_t hash[2], WCHAR *name, size_t size)
+{
+    swprintf(name, size, L"%s%08x%08x%08x%08x.bin", cache->path,
+            (uint32_t)(hash[0] >> 32), (uint32_t)hash[0], (uint32_t)(hash[1] >> 32), (uint32_t)hash[1]);
+}
+
+static void glsl_program_cache_evict(struct glsl_program_cache *cache)
+{
+    struct cache_file
+    {
+        FILETIME time;
+        uint64_t size;
+        WCHAR name[40];
+    } *files = NULL, *tmp;
+    SIZE_T count = 0, capacity = 0, i, j;
+    WIN32_FIND_DATAW data;
+    WCHAR path[MAX_PATH];
+    HANDLE find;
+
+    swprintf(path, ARRAY_SIZE(path), L"%s*.bin", cache->path);
+    if ((find = FindFirstFileW(path, &data)) == INVALID_HANDLE_VALUE)
+        return;
+
+    cache->size = 0;
+    do
+    {
+        if (wcslen(data.cFileName) >= ARRAY_SIZE(files->name))
+            continue;
+        if (!wined3d_array_reserve((void **)&files, &capacity, count + 1, sizeof(*files)))
+            break;
+        files[count].time = data.ftLastWriteTime;
+        files[count].size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        wcscpy(files[count].name, data.cFileName);
+        cache->size += files[count++].size;
+    } while (FindNextFileW(find, &data));
+    FindClose(find);
+
+    if (cache->size > cache->max_size)
+    {
+        /* Sort by last use, oldest first. */
+        for (i = 1; i < count; ++i)
+        {
+            struct cache_file file = files[i];
+
+            for (j = i; j && CompareFileTime(&files[j - 1].time, &file.time) > 0; --j)
+                files[j] = files[j - 1];
+            files[j] = file;
+        }
+
+        for (i = 0, tmp = files; i < count && cache->size > cache->max_size / 4 * 3; ++i, ++tmp)
+        {
+            swprintf(path, ARRAY_SIZE(path), L"%s%s", cache->path, tmp->name);
+            if (DeleteFileW(path))
+                cache->size -= tmp->size;
+        }
+        TRACE("Evicted %Iu programs, cache size now %s.\n", i, wine_dbgstr_longlong(cache->size));
+    }
+
+    heap_free(files);
+}
+
+static void glsl_program_cache_init(struct glsl_program_cache *cache)
+{
+    if (!(cache->path = wined3d_get_cache_directory(L"glsl")))
+        return;
+    cache->max_size = (uint64_t)wined3d_settings.shader_cache_size << 20;
+    glsl_program_cache_evict(cache);
+    TRACE("Using shader cache %s, size %s.\n", debugstr_w(cache->path), wine_dbgstr_longlong(cache->size));
+}
+
+static void glsl_program_cache_cleanup(struct glsl_program_cache *cache)
+{
+    heap_free(cache->path);
+    cache->path = NULL;
+}
+
+/* Context activation is done by the caller. */
+static BOOL glsl_program_cache_init_driver_hash(const struct wined3d_gl_info *gl_info,
+        struct glsl_program_cache *cache)
+{
+    static const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION_ARB};
+    const char *str;
+    GLint count = 0;
+    unsigned int i;
+
+    if (cache->initialised)
+        return !!cache->path;
+    cache->initialised = TRUE;
+
+    if (gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    if (!count)
+    {
+        TRACE("Program binaries are not supported, disabling the shader cache.\n");
+        glsl_program_cache_cleanup(cache);
+        return FALSE;
+    }
+
+    cache->driver_hash[0] = 0xcbf29ce484222325ull;
+    cache->driver_hash[1] = 0x84222325cbf29ce4ull;
+    for (i = 0; i < ARRAY_SIZE(strings); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(strings[i])))
+            glsl_program_cache_hash(cache->driver_hash, str, strlen(str) + 1);
+    }
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL glsl_program_cache_get_key(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, const void *link_key, size_t link_key_size,
+        uint64_t hash[2])
+{
+    GLint length, max_length = 0, type;
+    GLuint shaders[8];
+    GLsizei count, i;
+    char *source;
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &count, shaders));
+    for (i = 0; i < count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        max_length = max(max_length, length);
+    }
+    if (!count || !max_length || !(source = heap_alloc(max_length)))
+        return FALSE;
+
+    hash[0] = priv->program_cache.driver_hash[0];
+    hash[1] = priv->program_cache.driver_hash[1];
+    glsl_program_cache_hash(hash, link_key, link_key_size);
+    for (i = 0; i < count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type));
+        GL_EXTCALL(glGetShaderSource(shaders[i], max_length, &length, source));
+        glsl_program_cache_hash(hash, &type, sizeof(type));
+        glsl_program_cache_hash(hash, source, length);
+    }
+    checkGLcall("get program cache key");
+
+    heap_free(source);
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL glsl_program_cache_load(const struct wined3d_gl_info *gl_info,
+        struct glsl_program_cache *cache, GLuint program_id, const uint64_t hash[2])
+{
+    struct glsl_program_cache_header header;
+    WCHAR path[MAX_PATH];
+    void *binary = NULL;
+    BOOL ret = FALSE;
+    FILETIME now;
+    HANDLE file;
+    DWORD size;
+    GLint status;
+
+    glsl_program_cache_get_file_name(cache, hash, path, ARRAY_SIZE(path));
+    if ((file = CreateFileW(path, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    if (!ReadFile(file, &header, sizeof(header), &size, NULL) || size != sizeof(header)
+            || header.magic != WINED3D_GLSL_CACHE_MAGIC || header.version != WINED3D_GLSL_CACHE_VERSION
+            || header.hash[0] != hash[0] || header.hash[1] != hash[1] || header.binary_size > 64 * 1024 * 1024
+            || !(binary = heap_alloc(header.binary_size))
+            || !ReadFile(file, binary, header.binary_size, &size, NULL) || size != header.binary_size)
+        goto done;
+
+    GL_EXTCALL(glProgramBinary(program_id, header.binary_format, binary, header.binary_size));
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    checkGLcall("glProgramBinary");
+    if (!(ret = !!status))
+    {
+        /* Most likely a driver update; the program will be linked and stored again. */
+        TRACE("Driver rejected cached program %s.\n", debugstr_w(path));
+        goto done;
+    }
+
+    /* Keep track of the last use for eviction. */
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    TRACE("Loaded program %u from %s.\n", program_id, debugstr_w(path));
+
+done:
+    heap_free(binary);
+    CloseHandle(file);
+    return ret;
+}
+
+/* Context activation is done by the caller. */
+static void glsl_program_cache_store(const struct wined3d_gl_info *gl_info,
+        struct glsl_program_cache *cache, GLuint program_id, const uint64_t hash[2])
+{
+    struct glsl_program_cache_header header;
+    WCHAR path[MAX_PATH], tmp_path[MAX_PATH];
+    GLint length = 0, status;
+    GLenum format;
+    HANDLE file;
+    void *binary;
+    DWORD size;
+    BOOL ret;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    if (status)
+        GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (!length || !(binary = heap_alloc(length)))
+        return;
+
+    GL_EXTCALL(glGetProgramBinary(program_id, length, &length, &format, binary));
+    checkGLcall("glGetProgramBinary");
+
+    header.magic = WINED3D_GLSL_CACHE_MAGIC;
+    header.version = WINED3D_GLSL_CACHE_VERSION;
+    header.hash[0] = hash[0];
+    header.hash[1] = hash[1];
+    header.binary_format = format;
+    header.binary_size = length;
+
+    /* Write to a temporary file first, other processes may be reading the cache. */
+    glsl_program_cache_get_file_name(cache, hash, path, ARRAY_SIZE(path));
+    swprintf(tmp_path, ARRAY_SIZE(tmp_path), L"%s.%x", path, GetCurrentThreadId());
+    if ((file = CreateFileW(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        heap_free(binary);
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &size, NULL) && WriteFile(file, binary, length, &size, NULL);
+    CloseHandle(file);
+    heap_free(binary);
+
+    if (!ret || !MoveFileExW(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to store program %u in the shader cache.\n", program_id);
+        DeleteFileW(tmp_path);
+        return;
+    }
+    TRACE("Stored program %u in %s.\n", program_id, debugstr_w(path));
+
+    cache->size += sizeof(header) + length;
+    if (cache->size > cache->max_size)
+        glsl_program_cache_evict(cache);
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv,
+        GLuint program_id, const void *link_key, size_t link_key_size)
+{
+    struct glsl_program_cache *cache = &priv->program_cache;
+    uint64_t hash[2];
+    BOOL cached;
+
+    cached = link_key && cache->path && glsl_program_cache_init_driver_hash(gl_info, cache)
+            && glsl_program_cache_get_key(gl_info, priv, program_id, link_key, link_key_size, hash);
+    if (cached && glsl_program_cache_load(gl_info, cache, program_id, hash))
+        return;
+
+    if (cached)
+        GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+
+    TRACE("Linking GLSL shader program %u.\n", program_id);
+    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_validate_link(gl_info, program_id);
+
+    if (cached)
+        glsl_program_cache_store(gl_info, cache, program_id, hash);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -10101,6 +10413,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     struct glsl_shader_private *shader_data;
     struct glsl_shader_prog_link *entry;
     GLuint shader_id, program_id;
+    uint32_t link_key;
 
     if (!(entry = heap_alloc(sizeof(*entry))))
     {
@@ -10154,9 +10467,8 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    link_key = WINED3D_SHADER_TYPE_COMPUTE;
+    shader_glsl_link_program(gl_info, priv, program_id, &link_key, sizeof(link_key));
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10229,6 +10541,11 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     struct wined3d_shader *pshader = NULL;
     GLuint reorder_shader_id = 0;
     struct glsl_program_key key;
+    struct
+    {
+        uint32_t attribs_map;
+        uint32_t dual_source;
+    } link_key;
     uint32_t attribs_map;
     GLuint program_id;
     unsigned int i;
@@ -10484,10 +10801,13 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    /* Link the program. The attribute and fragment output bindings are part
+     * of the link state; transform feedback varyings aren't tracked, so
+     * programs using stream output are never cached. */
+    link_key.attribs_map = vshader ? vshader->reg_maps.input_registers : (1u << WINED3D_FFP_ATTRIBS_COUNT) - 1;
+    link_key.dual_source = state->blend_state && state->blend_state->dual_source;
+    shader_glsl_link_program(gl_info, priv, program_id,
+            gshader && gshader->u.gs.so_desc ? NULL : &link_key, sizeof(link_key));
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -11080,6 +11400,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     fragment_pipe->get_caps(device->adapter, &fragment_caps);
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     priv->legacy_lighting = device->wined3d->flags & WINED3D_LEGACY_FFP_LIGHTING;
+    glsl_program_cache_init(&priv->program_cache);
 
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
@@ -11104,6 +11425,7 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
     struct shader_glsl_priv *priv = device->shader_priv;
 
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
+    glsl_program_cache_cleanup(&priv->program_cache);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     heap_free(priv->stack);
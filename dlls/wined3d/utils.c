@@ -7142,6 +7142,43 @@ BOOL wined3d_array_reserve(void **elements, SIZE_T *capacity, SIZE_T count, SIZE
     return TRUE;
 }
 
+/* Returns the directory used to store the named on-disk cache, with a trailing
+ * backslash, creating it if needed. Returns NULL if caching is disabled. */
+WCHAR *wined3d_get_cache_directory(const WCHAR *name)
+{
+    static const WCHAR *subdirs[] = {L"\\wine", L"\\wine\\wined3d"};
+    WCHAR path[MAX_PATH], *ret;
+    unsigned int i;
+    DWORD len;
+
+    if (!wined3d_settings.shader_cache_size)
+        return NULL;
+
+    len = GetEnvironmentVariableW(L"LOCALAPPDATA", path, ARRAY_SIZE(path));
+    if (!len || len + wcslen(subdirs[ARRAY_SIZE(subdirs) - 1]) + wcslen(name) + 64 > ARRAY_SIZE(path))
+        return NULL;
+
+    for (i = 0; i < ARRAY_SIZE(subdirs); ++i)
+    {
+        wcscpy(path + len, subdirs[i]);
+        if (!CreateDirectoryW(path, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+            goto fail;
+    }
+    wcscat(path, L"\\");
+    wcscat(path, name);
+    if (!CreateDirectoryW(path, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+        goto fail;
+    wcscat(path, L"\\");
+
+    if ((ret = heap_alloc((wcslen(path) + 1) * sizeof(WCHAR))))
+        wcscpy(ret, path);
+    return ret;
+
+fail:
+    WARN("Failed to create cache directory %s.\n", debugstr_w(path));
+    return NULL;
+}
+
 static void swap_rows(float **a, float **b)
 {
     float *tmp = *a;
@@ -530,6 +530,7 @@ struct wined3d_settings
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
     BOOL cb_access_map_w;
+    unsigned int shader_cache_size;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -3462,6 +3463,7 @@ bool wined3d_driver_info_init(struct wined3d_driver_info *driver_info,
 #define UPLOAD_BO_UPLOAD_ON_UNMAP   0x1
 #define UPLOAD_BO_RENAME_ON_UNMAP   0x2
 #define UPLOAD_BO_FREE_ON_UNMAP     0x4
+#define UPLOAD_BO_RING_ON_UNMAP     0x8
 
 struct upload_bo
 {
@@ -3627,6 +3629,10 @@ struct wined3d_adapter_vk
 
     VkPhysicalDeviceLimits device_limits;
     VkPhysicalDeviceMemoryProperties memory_properties;
+
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
 };
 
 static inline struct wined3d_adapter_vk *wined3d_adapter_vk(struct wined3d_adapter *adapter)
@@ -4240,6 +4246,16 @@ struct wined3d_device_vk
     struct wined3d_allocator allocator;
 
     struct wined3d_uav_clear_state_vk uav_clear_state;
+
+    VkPipelineCache vk_pipeline_cache;
+    WCHAR *pipeline_cache_path;
+    struct
+    {
+        uint64_t count;         /* pipelines created */
+        uint64_t hitch_count;   /* pipelines that took longer than a frame to create */
+        uint64_t total_time;    /* in microseconds */
+        uint64_t max_time;
+    } pipeline_stats;
 };
 
 static inline struct wined3d_device_vk *wined3d_device_vk(struct wined3d_device *device)
@@ -4252,6 +4268,11 @@ static inline struct wined3d_device_vk *wined3d_device_vk_from_allocator(struct
     return CONTAINING_RECORD(allocator, struct wined3d_device_vk, allocator);
 }
 
+VkResult wined3d_device_vk_create_compute_pipeline(struct wined3d_device_vk *device_vk,
+        const VkComputePipelineCreateInfo *desc, VkPipeline *pipeline) DECLSPEC_HIDDEN;
+VkResult wined3d_device_vk_create_graphics_pipeline(struct wined3d_device_vk *device_vk,
+        const VkGraphicsPipelineCreateInfo *desc, VkPipeline *pipeline) DECLSPEC_HIDDEN;
+
 static inline void wined3d_device_vk_allocator_lock(struct wined3d_device_vk *device_vk)
 {
     EnterCriticalSection(&device_vk->allocator_cs);
@@ -5040,6 +5061,7 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x400000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_SPIN_COUNT_MIN       10000u
 #define WINED3D_CS_QUEUE_MASK           (WINED3D_CS_QUEUE_SIZE - 1)
 
 C_ASSERT(!(WINED3D_CS_QUEUE_SIZE & (WINED3D_CS_QUEUE_SIZE - 1)));
@@ -5050,6 +5072,19 @@ struct wined3d_cs_queue
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
+#define WINED3D_UPLOAD_RING_SIZE        0x400000u
+
+/* System memory ring used to pass UpdateSubResource() data to the CS thread.
+ * The application thread allocates from the head, and the CS thread releases
+ * allocations in order, by moving the tail, once the data has been uploaded. */
+struct wined3d_upload_ring
+{
+    BYTE *data;
+    ULONG head, tail;
+    unsigned int wrap_count;
+    unsigned int full_count;
+};
+
 struct wined3d_device_context_ops
 {
     void *(*require_space)(struct wined3d_device_context *context, size_t size, enum wined3d_cs_queue_id queue_id);
@@ -5086,6 +5121,7 @@ struct wined3d_cs
     BOOL serialize_commands;
 
     struct wined3d_cs_queue queue[WINED3D_CS_QUEUE_COUNT];
+    struct wined3d_upload_ring upload_ring;
     size_t data_size, start, end;
     void *data;
     struct list query_poll_list;
@@ -5093,6 +5129,7 @@ struct wined3d_cs
 
     HANDLE event;
     BOOL waiting_for_event;
+    unsigned int spin_limit;
     LONG pending_presents;
 };
 
@@ -6334,6 +6371,7 @@ static inline const struct wined3d_format_vk *wined3d_format_vk(const struct win
 }
 
 BOOL wined3d_array_reserve(void **elements, SIZE_T *capacity, SIZE_T count, SIZE_T size) DECLSPEC_HIDDEN;
+WCHAR *wined3d_get_cache_directory(const WCHAR *name) DECLSPEC_HIDDEN;
 
 static inline BOOL wined3d_format_is_typeless(const struct wined3d_format *format)
 {
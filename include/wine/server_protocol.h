@@ -1411,6 +1411,47 @@ struct open_event_reply
 };
 
 
+struct get_fast_sync_slot_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct get_fast_sync_slot_reply
+{
+    struct reply_header __header;
+    unsigned int  slot;
+    unsigned int  serial;
+    int           type;
+    char __pad_20[4];
+};
+#define FAST_SYNC_SLOTS   65536
+#define FAST_SYNC_NO_SLOT (~0u)
+
+enum fast_sync_type
+{
+    FAST_SYNC_NONE,
+    FAST_SYNC_MANUAL_EVENT,
+    FAST_SYNC_AUTO_EVENT,
+    FAST_SYNC_SEMAPHORE,
+    FAST_SYNC_MUTEX,
+    FAST_SYNC_SOCKET
+};
+#define FAST_SYNC_SOCKET_RECV  0x01
+#define FAST_SYNC_SOCKET_SEND  0x02
+#define FAST_SYNC_LOCKED       0x80000000
+
+/* State of a synchronization object shared with the clients. The state is
+ * (serial << 32) | value and is only modified atomically; the serial changes
+ * when the slot is reused. A client may acquire an object by updating the
+ * state with compare-and-swap, unless FAST_SYNC_LOCKED is set. */
+typedef volatile struct
+{
+    unsigned __int64 state;
+    unsigned int     count;
+    unsigned int     abandoned;
+} fast_sync_slot_t;
+
+
 
 struct create_keyed_event_request
 {
@@ -2209,6 +2250,22 @@ struct write_process_memory_reply
 
 
 
+struct get_process_vm_pid_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    unsigned int access;
+    char __pad_20[4];
+};
+struct get_process_vm_pid_reply
+{
+    struct reply_header __header;
+    int          unix_pid;
+    char __pad_12[4];
+};
+
+
+
 struct create_key_request
 {
     struct request_header __header;
@@ -2627,9 +2684,41 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    unsigned int shm_slot;
 };
 
+/* Message queue and desktop state shared read-only with the clients.
+ * The server increments seq before and after each update, so a client
+ * must retry its read while seq is odd or has changed during the read. */
+#define INPUT_SHM_QUEUE_SLOTS   16384
+#define INPUT_SHM_DESKTOP_SLOTS 256
+#define INPUT_SHM_NO_SLOT       (~0u)
+
+typedef volatile struct
+{
+    unsigned int   seq;
+    int            cursor_x;
+    int            cursor_y;
+    unsigned int   cursor_change;
+    unsigned char  keystate[256];
+} desktop_shm_t;
+
+typedef volatile struct
+{
+    unsigned int   seq;
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_mask;
+    unsigned int   desktop_slot;
+} queue_shm_t;
+
+typedef volatile struct
+{
+    desktop_shm_t  desktops[INPUT_SHM_DESKTOP_SLOTS];
+    queue_shm_t    queues[INPUT_SHM_QUEUE_SLOTS];
+} input_shm_t;
+
 
 
 struct set_queue_fd_request
@@ -5475,6 +5564,32 @@ struct get_next_thread_reply
 };
 
 
+/* Header of a request in a batch, followed by the request structure and its
+ * variable size data, padded to a multiple of 8 bytes. The replies are returned
+ * in the same way, without header. */
+struct batch_request
+{
+    unsigned short handle_offset;
+    unsigned short handle_source;
+    unsigned int   handle_index;
+};
+
+
+struct batch_requests_request
+{
+    struct request_header __header;
+    /* VARARG(requests,batch_requests); */
+    char __pad_12[4];
+};
+struct batch_requests_reply
+{
+    struct reply_header __header;
+    unsigned int count;
+    /* VARARG(replies,batch_replies); */
+    char __pad_12[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5510,6 +5625,7 @@ enum request
     REQ_event_op,
     REQ_query_event,
     REQ_open_event,
+    REQ_get_fast_sync_slot,
     REQ_create_keyed_event,
     REQ_open_keyed_event,
     REQ_create_mutex,
@@ -5557,6 +5673,7 @@ enum request
     REQ_set_debug_obj_info,
     REQ_read_process_memory,
     REQ_write_process_memory,
+    REQ_get_process_vm_pid,
     REQ_create_key,
     REQ_open_key,
     REQ_delete_key,
@@ -5754,6 +5871,7 @@ enum request
     REQ_suspend_process,
     REQ_resume_process,
     REQ_get_next_thread,
+    REQ_batch_requests,
     REQ_NB_REQUESTS
 };
 
@@ -5794,6 +5912,7 @@ union generic_request
     struct event_op_request event_op_request;
     struct query_event_request query_event_request;
     struct open_event_request open_event_request;
+    struct get_fast_sync_slot_request get_fast_sync_slot_request;
     struct create_keyed_event_request create_keyed_event_request;
     struct open_keyed_event_request open_keyed_event_request;
     struct create_mutex_request create_mutex_request;
@@ -5841,6 +5960,7 @@ union generic_request
     struct set_debug_obj_info_request set_debug_obj_info_request;
     struct read_process_memory_request read_process_memory_request;
     struct write_process_memory_request write_process_memory_request;
+    struct get_process_vm_pid_request get_process_vm_pid_request;
     struct create_key_request create_key_request;
     struct open_key_request open_key_request;
     struct delete_key_request delete_key_request;
@@ -6038,6 +6158,7 @@ union generic_request
     struct suspend_process_request suspend_process_request;
     struct resume_process_request resume_process_request;
     struct get_next_thread_request get_next_thread_request;
+    struct batch_requests_request batch_requests_request;
 };
 union generic_reply
 {
@@ -6076,6 +6197,7 @@ union generic_reply
     struct event_op_reply event_op_reply;
     struct query_event_reply query_event_reply;
     struct open_event_reply open_event_reply;
+    struct get_fast_sync_slot_reply get_fast_sync_slot_reply;
     struct create_keyed_event_reply create_keyed_event_reply;
     struct open_keyed_event_reply open_keyed_event_reply;
     struct create_mutex_reply create_mutex_reply;
@@ -6123,6 +6245,7 @@ union generic_reply
     struct set_debug_obj_info_reply set_debug_obj_info_reply;
     struct read_process_memory_reply read_process_memory_reply;
     struct write_process_memory_reply write_process_memory_reply;
+    struct get_process_vm_pid_reply get_process_vm_pid_reply;
     struct create_key_reply create_key_reply;
     struct open_key_reply open_key_reply;
     struct delete_key_reply delete_key_reply;
@@ -6320,11 +6443,12 @@ union generic_reply
     struct suspend_process_reply suspend_process_reply;
     struct resume_process_reply resume_process_reply;
     struct get_next_thread_reply get_next_thread_reply;
+    struct batch_requests_reply batch_requests_reply;
 };
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 755
+#define SERVER_PROTOCOL_VERSION 761
 
 /* ### protocol_version end ### */
 
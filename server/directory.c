@@ -439,8 +439,12 @@ void init_directories( struct fd *intl_fd )
     /* mappings */
     static const WCHAR intlW[] = {'N','l','s','S','e','c','t','i','o','n','L','A','N','G','_','I','N','T','L'};
     static const WCHAR user_dataW[] = {'_','_','w','i','n','e','_','u','s','e','r','_','s','h','a','r','e','d','_','d','a','t','a'};
+    static const WCHAR fast_syncW[] = {'_','_','w','i','n','e','_','f','a','s','t','_','s','y','n','c'};
+    static const WCHAR input_shmW[] = {'_','_','w','i','n','e','_','i','n','p','u','t','_','s','h','m'};
     static const struct unicode_str intl_str = {intlW, sizeof(intlW)};
     static const struct unicode_str user_data_str = {user_dataW, sizeof(user_dataW)};
+    static const struct unicode_str fast_sync_str = {fast_syncW, sizeof(fast_syncW)};
+    static const struct unicode_str input_shm_str = {input_shmW, sizeof(input_shmW)};
 
     struct directory *dir_driver, *dir_device, *dir_global, *dir_kernel, *dir_nls;
     struct object *named_pipe_device, *mailslot_device, *null_device;
@@ -481,6 +485,11 @@ void init_directories( struct fd *intl_fd )
     release_object( create_symlink( &dir_global->obj, &link_conout_str, OBJ_PERMANENT, &link_currentout_str, NULL ));
     release_object( create_symlink( &dir_global->obj, &link_con_str, OBJ_PERMANENT, &link_console_str, NULL ));
 
+    /* the fast sync state must exist before any event is created */
+    release_object( create_fast_sync_mapping( &dir_kernel->obj, &fast_sync_str, OBJ_PERMANENT, NULL ));
+    /* and the shared input state before any desktop or message queue */
+    release_object( create_input_shm_mapping( &dir_kernel->obj, &input_shm_str, OBJ_PERMANENT, NULL ));
+
     /* events */
     for (i = 0; i < ARRAY_SIZE( kernel_events ); i++)
         release_object( create_event( &dir_kernel->obj, &kernel_events[i], OBJ_PERMANENT, 1, 0, NULL ));
@@ -55,7 +55,7 @@ struct event
     struct object  obj;             /* object header */
     struct list    kernel_object;   /* list of kernel object pointers */
     int            manual_reset;    /* is it a manual reset event? */
-    int            signaled;        /* event has been signaled */
+    fast_sync_slot_t *sync;         /* signaled state, possibly shared with the clients */
 };
 
 static void event_dump( struct object *obj, int verbose );
@@ -63,6 +63,7 @@ static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int event_signal( struct object *obj, unsigned int access);
 static struct list *event_get_kernel_obj_list( struct object *obj );
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
@@ -85,7 +86,7 @@ static const struct object_ops event_ops =
     no_open_file,              /* open_file */
     event_get_kernel_obj_list, /* get_kernel_obj_list */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -136,6 +137,108 @@ static const struct object_ops keyed_event_ops =
 };
 
 
+/* state of synchronization objects and sockets shared with the clients, so that they
+ * can satisfy waits on signaled objects or socket I/O without a server round trip */
+fast_sync_slot_t *fast_sync_slots;
+static unsigned int fast_sync_free[FAST_SYNC_SLOTS];  /* stack of freed slots */
+static unsigned int fast_sync_free_count;
+static unsigned int fast_sync_used;                    /* number of slots ever allocated */
+static fast_sync_slot_t **locked_syncs;                /* states locked by the server */
+static unsigned int locked_count, locked_size;
+
+/* allocate the state of an object; if no shared slot is available,
+ * the state is kept private to the server */
+fast_sync_slot_t *alloc_fast_sync( unsigned int value )
+{
+    fast_sync_slot_t *sync;
+    unsigned int slot;
+
+    if (fast_sync_slots && (fast_sync_free_count || fast_sync_used < FAST_SYNC_SLOTS))
+    {
+        slot = fast_sync_free_count ? fast_sync_free[--fast_sync_free_count] : fast_sync_used++;
+        sync = &fast_sync_slots[slot];
+        sync->count = sync->abandoned = 0;
+        /* bump the serial so that clients can detect a reused slot */
+        __atomic_store_n( &sync->state, ((sync->state >> 32) + 1) << 32 | value, __ATOMIC_SEQ_CST );
+        return sync;
+    }
+    if (!(sync = mem_alloc( sizeof(*sync) ))) return NULL;
+    sync->state = value;
+    sync->count = sync->abandoned = 0;
+    return sync;
+}
+
+/* get the index of a state in the shared slots, or FAST_SYNC_NO_SLOT if it is private */
+unsigned int get_fast_sync_slot( fast_sync_slot_t *sync )
+{
+    if (!sync || !fast_sync_slots || sync < fast_sync_slots || sync >= fast_sync_slots + FAST_SYNC_SLOTS)
+        return FAST_SYNC_NO_SLOT;
+    return sync - fast_sync_slots;
+}
+
+void free_fast_sync( fast_sync_slot_t *sync )
+{
+    unsigned int i, slot = get_fast_sync_slot( sync );
+
+    if (!sync) return;
+    for (i = 0; i < locked_count; i++)
+    {
+        if (locked_syncs[i] != sync) continue;
+        locked_syncs[i] = locked_syncs[--locked_count];
+        break;
+    }
+    if (slot == FAST_SYNC_NO_SLOT)
+    {
+        free( (void *)sync );
+        return;
+    }
+    __atomic_store_n( &sync->state, sync->state & ~(unsigned __int64)0xffffffff, __ATOMIC_SEQ_CST );
+    fast_sync_free[fast_sync_free_count++] = slot;
+}
+
+unsigned int get_fast_sync_value( fast_sync_slot_t *sync )
+{
+    return (unsigned int)__atomic_load_n( &sync->state, __ATOMIC_SEQ_CST ) & ~FAST_SYNC_LOCKED;
+}
+
+/* set the value of a state; clients may be modifying it concurrently unless it is locked */
+void set_fast_sync_value( fast_sync_slot_t *sync, unsigned int value )
+{
+    unsigned __int64 old = sync->state, new;
+
+    if (((unsigned int)old & ~FAST_SYNC_LOCKED) == value) return;
+    do new = (old & ~(unsigned __int64)0xffffffff) | (old & FAST_SYNC_LOCKED) | value;
+    while (!__atomic_compare_exchange_n( &sync->state, &old, new, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+}
+
+/* prevent clients from modifying a state until unlock_fast_syncs() is called, and return its value */
+unsigned int lock_fast_sync( fast_sync_slot_t *sync )
+{
+    unsigned __int64 old = __atomic_fetch_or( &sync->state, FAST_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+
+    if (!(old & FAST_SYNC_LOCKED))
+    {
+        if (locked_count == locked_size)
+        {
+            unsigned int new_size = max( 16, locked_size * 2 );
+            fast_sync_slot_t **new_syncs = realloc( locked_syncs, new_size * sizeof(*new_syncs) );
+
+            if (!new_syncs) fatal_error( "out of memory\n" );
+            locked_syncs = new_syncs;
+            locked_size = new_size;
+        }
+        locked_syncs[locked_count++] = sync;
+    }
+    return (unsigned int)old & ~FAST_SYNC_LOCKED;
+}
+
+void unlock_fast_syncs(void)
+{
+    while (locked_count)
+        __atomic_fetch_and( &locked_syncs[--locked_count]->state, ~(unsigned __int64)FAST_SYNC_LOCKED,
+                            __ATOMIC_SEQ_CST );
+}
+
 struct event *create_event( struct object *root, const struct unicode_str *name,
                             unsigned int attr, int manual_reset, int initial_state,
                             const struct security_descriptor *sd )
@@ -149,7 +252,11 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             /* initialize it if it didn't already exist */
             list_init( &event->kernel_object );
             event->manual_reset = manual_reset;
-            event->signaled     = initial_state;
+            if (!(event->sync = alloc_fast_sync( !!initial_state )))
+            {
+                release_object( event );
+                return NULL;
+            }
         }
     }
     return event;
@@ -162,22 +269,22 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
 
 static void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    set_fast_sync_value( event->sync, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    set_fast_sync_value( event->sync, 0 );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    set_fast_sync_value( event->sync, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    set_fast_sync_value( event->sync, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
@@ -185,14 +292,16 @@ static void event_dump( struct object *obj, int verbose )
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     fprintf( stderr, "Event manual=%d signaled=%d\n",
-             event->manual_reset, event->signaled );
+             event->manual_reset, get_fast_sync_value( event->sync ) );
 }
 
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    /* clients can reset an auto-reset event when they acquire it */
+    if (!event->manual_reset) return lock_fast_sync( event->sync );
+    return get_fast_sync_value( event->sync );
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -200,7 +309,7 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    if (!event->manual_reset) set_fast_sync_value( event->sync, 0 );
 }
 
 static int event_signal( struct object *obj, unsigned int access )
@@ -223,6 +332,13 @@ static struct list *event_get_kernel_obj_list( struct object *obj )
     return &event->kernel_object;
 }
 
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    free_fast_sync( event->sync );
+}
+
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -316,7 +432,7 @@ DECL_HANDLER(event_op)
     struct event *event;
 
     if (!(event = get_event_obj( current->process, req->handle, EVENT_MODIFY_STATE ))) return;
-    reply->state = event->signaled;
+    reply->state = get_fast_sync_value( event->sync );
     switch(req->op)
     {
     case PULSE_EVENT:
@@ -343,7 +459,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = get_fast_sync_value( event->sync );
 
     release_object( event );
 }
@@ -379,3 +495,28 @@ DECL_HANDLER(open_keyed_event)
     reply->handle = open_object( current->process, req->rootdir, req->access,
                                  &keyed_event_ops, &name, req->attributes );
 }
+
+/* get the slot of an object in the fast sync state */
+DECL_HANDLER(get_fast_sync_slot)
+{
+    fast_sync_slot_t *sync = NULL;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, SYNCHRONIZE, NULL ))) return;
+
+    if (obj->ops == &event_ops)
+    {
+        struct event *event = (struct event *)obj;
+        sync = event->sync;
+        reply->type = event->manual_reset ? FAST_SYNC_MANUAL_EVENT : FAST_SYNC_AUTO_EVENT;
+    }
+    else if ((sync = get_semaphore_fast_sync( obj ))) reply->type = FAST_SYNC_SEMAPHORE;
+    else if ((sync = get_mutex_fast_sync( obj, current->process ))) reply->type = FAST_SYNC_MUTEX;
+    else if ((sync = sock_get_fast_sync( obj ))) reply->type = FAST_SYNC_SOCKET;
+
+    if ((reply->slot = get_fast_sync_slot( sync )) != FAST_SYNC_NO_SLOT)
+        reply->serial = sync->state >> 32;
+    else
+        reply->type = FAST_SYNC_NONE;
+    release_object( obj );
+}
@@ -365,14 +365,27 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in expired list */
     abstime_t             when;       /* timeout expiry */
+    unsigned int          index;      /* index in timeout heap, or TIMEOUT_EXPIRED */
+    unsigned int          serial;     /* insertion order, to break ties */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+#define TIMEOUT_EXPIRED (~0u)
+
+/* binary min-heap of timeouts, ordered by expiry */
+struct timeout_heap
+{
+    struct timeout_user **users;      /* heap array */
+    unsigned int          count;      /* number of users in the heap */
+    unsigned int          size;       /* allocated size of the array */
+};
+
+static struct timeout_heap abs_timeouts;  /* absolute timeouts heap */
+static struct timeout_heap rel_timeouts;  /* relative timeouts heap */
+static unsigned int timeout_serial;
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -449,43 +462,111 @@ void set_current_time(void)
     if (user_shared_data) set_user_shared_data_time();
 }
 
+/* return the heap holding a given timeout */
+static inline struct timeout_heap *get_timeout_heap( abstime_t when )
+{
+    return when > 0 ? &abs_timeouts : &rel_timeouts;
+}
+
+/* check if timeout a expires before timeout b; both must be in the same heap */
+static inline int timeout_before( const struct timeout_user *a, const struct timeout_user *b )
+{
+    /* relative timeouts are stored negated, so the latest value expires first */
+    if (a->when != b->when) return a->when > 0 ? a->when < b->when : a->when > b->when;
+    /* the most recently added timeout expires first, as with the old sorted lists */
+    return (int)(a->serial - b->serial) > 0;
+}
+
+static inline void timeout_heap_set( struct timeout_heap *heap, unsigned int pos, struct timeout_user *user )
+{
+    heap->users[pos] = user;
+    user->index = pos;
+}
+
+/* move a heap entry towards the root until the heap property is restored */
+static void timeout_heap_up( struct timeout_heap *heap, unsigned int pos )
+{
+    struct timeout_user *user = heap->users[pos];
+
+    while (pos)
+    {
+        unsigned int parent = (pos - 1) / 2;
+        if (!timeout_before( user, heap->users[parent] )) break;
+        timeout_heap_set( heap, pos, heap->users[parent] );
+        pos = parent;
+    }
+    timeout_heap_set( heap, pos, user );
+}
+
+/* move a heap entry towards the leaves until the heap property is restored */
+static void timeout_heap_down( struct timeout_heap *heap, unsigned int pos )
+{
+    struct timeout_user *user = heap->users[pos];
+
+    for (;;)
+    {
+        unsigned int child = 2 * pos + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && timeout_before( heap->users[child + 1], heap->users[child] )) child++;
+        if (!timeout_before( heap->users[child], user )) break;
+        timeout_heap_set( heap, pos, heap->users[child] );
+        pos = child;
+    }
+    timeout_heap_set( heap, pos, user );
+}
+
+/* remove an entry from its heap */
+static void timeout_heap_remove( struct timeout_heap *heap, struct timeout_user *user )
+{
+    unsigned int pos = user->index;
+    struct timeout_user *last = heap->users[--heap->count];
+
+    user->index = TIMEOUT_EXPIRED;
+    if (last == user) return;
+    timeout_heap_set( heap, pos, last );
+    if (pos && timeout_before( last, heap->users[(pos - 1) / 2] )) timeout_heap_up( heap, pos );
+    else timeout_heap_down( heap, pos );
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
+    struct timeout_heap *heap;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
+    user->serial   = timeout_serial++;
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
+    /* Now insert it in the heap */
 
-    if (user->when > 0)
-    {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
+    heap = get_timeout_heap( user->when );
+    if (heap->count == heap->size)
     {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
+        unsigned int new_size = max( 64, heap->size * 2 );
+        struct timeout_user **new_users = realloc( heap->users, new_size * sizeof(*new_users) );
+
+        if (!new_users)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
+            free( user );
+            set_error( STATUS_NO_MEMORY );
+            return NULL;
         }
+        heap->users = new_users;
+        heap->size  = new_size;
     }
-    list_add_before( ptr, &user->entry );
+    heap->users[heap->count] = user;
+    timeout_heap_up( heap, heap->count++ );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->index == TIMEOUT_EXPIRED) list_remove( &user->entry );
+    else timeout_heap_remove( get_timeout_heap( user->when ), user );
     free( user );
 }
 
@@ -920,34 +1001,28 @@ static int get_next_timeout(void)
 {
     int ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeouts.count || rel_timeouts.count)
     {
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heaps */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = abs_timeouts.users[0];
 
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            if (timeout->when > current_time) break;
+            timeout_heap_remove( &abs_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = rel_timeouts.users[0];
 
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            if (-timeout->when > monotonic_time) break;
+            timeout_heap_remove( &rel_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
 
         /* now call the callback for all the removed timers */
@@ -960,18 +1035,18 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = abs_timeouts.users[0];
             timeout_t diff = (timeout->when - current_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = rel_timeouts.users[0];
             timeout_t diff = (-timeout->when - monotonic_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
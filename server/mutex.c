@@ -32,6 +32,7 @@
 #include "winternl.h"
 
 #include "handle.h"
+#include "process.h"
 #include "thread.h"
 #include "request.h"
 #include "security.h"
@@ -50,13 +51,26 @@ struct type_descr mutex_type =
     },
 };
 
+/* The owner thread id, recursion count and abandoned flag are kept in
+ * the fast sync state, where clients can acquire the mutex directly.
+ * Since all processes can write to it, the owner is only trusted if it's
+ * a live thread of a process that was given the fast sync state. */
 struct mutex
 {
-    struct object  obj;             /* object header */
-    struct thread *owner;           /* mutex owner */
-    unsigned int   count;           /* recursion count */
-    int            abandoned;       /* has it been abandoned? */
-    struct list    entry;           /* entry in owner thread mutex list */
+    struct object     obj;          /* object header */
+    fast_sync_slot_t *sync;         /* owner id and recursion count */
+    struct thread    *owner;        /* owner as last seen by the server */
+    struct list       entry;        /* entry in owner thread mutex list */
+    struct list       users;        /* processes that can grab it directly */
+};
+
+/* a process that was given the fast sync state of a mutex */
+struct mutex_user
+{
+    struct list       mutex_entry;    /* entry in the mutex list of users */
+    struct list       process_entry;  /* entry in the process list of fast mutexes */
+    struct mutex     *mutex;          /* mutex being shared */
+    struct process   *process;        /* process it's shared with */
 };
 
 static void mutex_dump( struct object *obj, int verbose );
@@ -90,29 +104,80 @@ static const struct object_ops mutex_ops =
 };
 
 
+static void set_owner( struct mutex *mutex, struct thread *thread )
+{
+    if (mutex->owner == thread) return;
+    if (mutex->owner) list_remove( &mutex->entry );
+    if ((mutex->owner = thread)) list_add_head( &thread->mutex_list, &mutex->entry );
+}
+
+static int is_mutex_user( struct mutex *mutex, struct process *process )
+{
+    struct mutex_user *user;
+
+    LIST_FOR_EACH_ENTRY( user, &mutex->users, struct mutex_user, mutex_entry )
+        if (user->process == process) return 1;
+    return 0;
+}
+
+/* get the owner of a mutex, after checking the id that clients may have stored in the
+ * fast sync state; an invalid owner leaves the mutex abandoned, and returns 0 */
+static unsigned int get_owner( struct mutex *mutex )
+{
+    unsigned int id = get_fast_sync_value( mutex->sync ), error;
+    struct thread *thread;
+
+    if (!id || (mutex->owner && mutex->owner->id == id)) return id;
+
+    error = get_error();
+    if ((thread = get_thread_from_id( id )))
+    {
+        if (thread->state != TERMINATED && is_mutex_user( mutex, thread->process ))
+            set_owner( mutex, thread );
+        else id = 0;
+        release_object( thread );
+    }
+    else id = 0;
+    set_error( error );
+
+    if (!id)
+    {
+        set_owner( mutex, NULL );
+        mutex->sync->count = 0;
+        mutex->sync->abandoned = 1;
+        set_fast_sync_value( mutex->sync, 0 );
+    }
+    return id;
+}
+
 /* grab a mutex for a given thread */
 static void do_grab( struct mutex *mutex, struct thread *thread )
 {
-    assert( !mutex->count || (mutex->owner == thread) );
-
-    if (!mutex->count++)  /* FIXME: avoid wrap-around */
+    lock_fast_sync( mutex->sync );
+    if (get_owner( mutex ) == thread->id)
     {
-        assert( !mutex->owner );
-        mutex->owner = thread;
-        list_add_head( &thread->mutex_list, &mutex->entry );
+        mutex->sync->count++;  /* FIXME: avoid wrap-around */
+        return;
     }
+    mutex->sync->count = 1;
+    set_fast_sync_value( mutex->sync, thread->id );
+    set_owner( mutex, thread );
 }
 
 /* release a mutex once the recursion count is 0 */
 static void do_release( struct mutex *mutex )
 {
-    assert( !mutex->count );
-    /* remove the mutex from the thread list of owned mutexes */
-    list_remove( &mutex->entry );
-    mutex->owner = NULL;
+    set_fast_sync_value( mutex->sync, 0 );
+    set_owner( mutex, NULL );
     wake_up( &mutex->obj, 0 );
 }
 
+/* check if the current thread owns a mutex */
+static int is_owned_by_current( struct mutex *mutex )
+{
+    return mutex->sync->count && get_owner( mutex ) == current->id;
+}
+
 static struct mutex *create_mutex( struct object *root, const struct unicode_str *name,
                                    unsigned int attr, int owned, const struct security_descriptor *sd )
 {
@@ -123,10 +188,15 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
         if (get_error() != STATUS_OBJECT_NAME_EXISTS)
         {
             /* initialize it if it didn't already exist */
-            mutex->count = 0;
             mutex->owner = NULL;
-            mutex->abandoned = 0;
+            list_init( &mutex->users );
+            if (!(mutex->sync = alloc_fast_sync( 0 )))
+            {
+                release_object( mutex );
+                return NULL;
+            }
             if (owned) do_grab( mutex, current );
+            unlock_fast_syncs();
         }
     }
     return mutex;
@@ -134,30 +204,60 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
 
 void abandon_mutexes( struct thread *thread )
 {
+    struct mutex_user *user;
+    struct mutex *mutex;
     struct list *ptr;
 
+    /* clients can grab mutexes without telling us, look for them in the ones shared with the process */
+    LIST_FOR_EACH_ENTRY( user, &thread->process->fast_mutexes, struct mutex_user, process_entry )
+        if (get_fast_sync_value( user->mutex->sync ) == thread->id) set_owner( user->mutex, thread );
+
     while ((ptr = list_head( &thread->mutex_list )) != NULL)
     {
-        struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
+        mutex = LIST_ENTRY( ptr, struct mutex, entry );
         assert( mutex->owner == thread );
-        mutex->count = 0;
-        mutex->abandoned = 1;
+        /* the client may have released it without telling us either */
+        if (get_fast_sync_value( mutex->sync ) != thread->id)
+        {
+            set_owner( mutex, NULL );
+            continue;
+        }
+        mutex->sync->count = 0;
+        mutex->sync->abandoned = 1;
         do_release( mutex );
     }
 }
 
+/* free the fast sync sharing information of a process */
+void release_fast_mutexes( struct process *process )
+{
+    struct mutex_user *user, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( user, next, &process->fast_mutexes, struct mutex_user, process_entry )
+    {
+        list_remove( &user->mutex_entry );
+        list_remove( &user->process_entry );
+        free( user );
+    }
+}
+
 static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    fprintf( stderr, "Mutex count=%u owner=%04x\n", mutex->sync->count, get_fast_sync_value( mutex->sync ) );
 }
 
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    unsigned int owner;
+
     assert( obj->ops == &mutex_ops );
-    return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
+    /* keep clients from grabbing it until the wait is satisfied */
+    lock_fast_sync( mutex->sync );
+    owner = get_owner( mutex );
+    return (!owner || owner == get_wait_queue_thread( entry )->id);
 }
 
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -166,8 +266,8 @@ static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry
     assert( obj->ops == &mutex_ops );
 
     do_grab( mutex, get_wait_queue_thread( entry ));
-    if (mutex->abandoned) make_wait_abandoned( entry );
-    mutex->abandoned = 0;
+    if (mutex->sync->abandoned) make_wait_abandoned( entry );
+    mutex->sync->abandoned = 0;
 }
 
 static int mutex_signal( struct object *obj, unsigned int access )
@@ -180,23 +280,48 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
-    if (!mutex->count || (mutex->owner != current))
+    if (!is_owned_by_current( mutex ))
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
         return 0;
     }
-    if (!--mutex->count) do_release( mutex );
+    if (!--mutex->sync->count) do_release( mutex );
     return 1;
 }
 
 static void mutex_destroy( struct object *obj )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    struct mutex_user *user, *next;
+
     assert( obj->ops == &mutex_ops );
 
-    if (!mutex->count) return;
-    mutex->count = 0;
-    do_release( mutex );
+    set_owner( mutex, NULL );
+    LIST_FOR_EACH_ENTRY_SAFE( user, next, &mutex->users, struct mutex_user, mutex_entry )
+    {
+        list_remove( &user->mutex_entry );
+        list_remove( &user->process_entry );
+        free( user );
+    }
+    free_fast_sync( mutex->sync );
+}
+
+/* get the owner of a mutex, possibly shared with the clients; the threads of
+ * the process are allowed to grab it directly from then on */
+fast_sync_slot_t *get_mutex_fast_sync( struct object *obj, struct process *process )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    struct mutex_user *user;
+
+    if (obj->ops != &mutex_ops) return NULL;
+    if (get_fast_sync_slot( mutex->sync ) == FAST_SYNC_NO_SLOT) return mutex->sync;
+    if (is_mutex_user( mutex, process )) return mutex->sync;
+    if (!(user = malloc( sizeof(*user) ))) return NULL;
+    user->mutex = mutex;
+    user->process = process;
+    list_add_tail( &mutex->users, &user->mutex_entry );
+    list_add_tail( &process->fast_mutexes, &user->process_entry );
+    return mutex->sync;
 }
 
 /* create a mutex */
@@ -240,11 +365,11 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
+        if (!is_owned_by_current( mutex )) set_error( STATUS_MUTANT_NOT_OWNED );
         else
         {
-            reply->prev_count = mutex->count;
-            if (!--mutex->count) do_release( mutex );
+            reply->prev_count = mutex->sync->count;
+            if (!--mutex->sync->count) do_release( mutex );
         }
         release_object( mutex );
     }
@@ -258,9 +383,11 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        unsigned int owner = get_owner( mutex );
+
+        reply->count = owner ? mutex->sync->count : 0;
+        reply->owned = (owner == current->id);
+        reply->abandoned = mutex->sync->abandoned;
 
         release_object( mutex );
     }
@@ -214,10 +214,24 @@ extern struct event *get_event_obj( struct process *process, obj_handle_t handle
 extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern fast_sync_slot_t *fast_sync_slots;
+extern fast_sync_slot_t *alloc_fast_sync( unsigned int value );
+extern unsigned int get_fast_sync_slot( fast_sync_slot_t *sync );
+extern void free_fast_sync( fast_sync_slot_t *sync );
+extern unsigned int get_fast_sync_value( fast_sync_slot_t *sync );
+extern void set_fast_sync_value( fast_sync_slot_t *sync, unsigned int value );
+extern unsigned int lock_fast_sync( fast_sync_slot_t *sync );
+extern void unlock_fast_syncs(void);
 
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
+extern fast_sync_slot_t *get_mutex_fast_sync( struct object *obj, struct process *process );
+extern void release_fast_mutexes( struct process *process );
+
+/* semaphore functions */
+
+extern fast_sync_slot_t *get_semaphore_fast_sync( struct object *obj );
 
 /* serial functions */
 
@@ -226,6 +240,7 @@ int get_serial_async_timeout(struct object *obj, int type, int count);
 /* socket functions */
 
 extern void sock_init(void);
+extern fast_sync_slot_t *sock_get_fast_sync( struct object *obj );
 
 /* debugger functions */
 
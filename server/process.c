@@ -688,6 +688,7 @@ struct process *create_process( int fd, struct process *parent, unsigned int fla
     list_init( &process->locks );
     list_init( &process->asyncs );
     list_init( &process->classes );
+    list_init( &process->fast_mutexes );
     list_init( &process->views );
 
     process->end_time = 0;
@@ -771,6 +772,7 @@ static void process_destroy( struct object *obj )
     assert( !process->sigkill_timeout );  /* timeout should hold a reference to the process */
 
     close_process_handles( process );
+    release_fast_mutexes( process );
     set_process_startup_state( process, STARTUP_ABORTED );
 
     if (process->job)
@@ -1666,6 +1668,24 @@ DECL_HANDLER(write_process_memory)
     }
 }
 
+/* retrieve the Unix pid of a process to access its memory directly */
+DECL_HANDLER(get_process_vm_pid)
+{
+    struct process *process;
+
+    reply->unix_pid = -1;
+    if (req->access != PROCESS_VM_READ && req->access != PROCESS_VM_WRITE)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (!(process = get_process_from_handle( req->handle, req->access ))) return;
+
+    if (process->unix_pid == -1 || process->is_terminating) set_error( STATUS_ACCESS_DENIED );
+    else reply->unix_pid = process->unix_pid;
+    release_object( process );
+}
+
 /* retrieve the process idle event */
 DECL_HANDLER(get_process_idle_event)
 {
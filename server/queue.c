@@ -141,6 +141,7 @@ struct msg_queue
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
     int                    keystate_lock;   /* owns an input keystate lock */
+    unsigned int           shm_slot;        /* slot in the shared input state */
 };
 
 struct hotkey
@@ -249,6 +250,90 @@ static void set_caret_window( struct thread_input *input, user_handle_t win )
     input->caret_state       = 0;
 }
 
+/* message queue and desktop state shared read-only with the clients, so that they can detect
+ * an empty queue or read the key state and cursor position without a server round trip */
+input_shm_t *input_shm;
+
+struct shm_slots
+{
+    unsigned int  count;        /* total number of slots */
+    unsigned int  used;         /* number of slots ever allocated */
+    unsigned int  free_count;   /* number of freed slots */
+    unsigned int *free;         /* stack of freed slots */
+};
+
+static unsigned int queue_shm_free[INPUT_SHM_QUEUE_SLOTS];
+static unsigned int desktop_shm_free[INPUT_SHM_DESKTOP_SLOTS];
+static struct shm_slots queue_shm_slots = { INPUT_SHM_QUEUE_SLOTS, 0, 0, queue_shm_free };
+static struct shm_slots desktop_shm_slots = { INPUT_SHM_DESKTOP_SLOTS, 0, 0, desktop_shm_free };
+
+static unsigned int alloc_shm_slot( struct shm_slots *slots )
+{
+    if (!input_shm) return INPUT_SHM_NO_SLOT;
+    if (slots->free_count) return slots->free[--slots->free_count];
+    if (slots->used < slots->count) return slots->used++;
+    return INPUT_SHM_NO_SLOT;
+}
+
+static void free_shm_slot( struct shm_slots *slots, unsigned int slot )
+{
+    if (slot != INPUT_SHM_NO_SLOT) slots->free[slots->free_count++] = slot;
+}
+
+/* make the sequence counter odd while the shared state is being modified */
+static void shm_write_begin( volatile unsigned int *seq )
+{
+    __atomic_store_n( seq, *seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+static void shm_write_end( volatile unsigned int *seq )
+{
+    __atomic_store_n( seq, *seq + 1, __ATOMIC_RELEASE );
+}
+
+/* publish the queue bits and masks to the shared state */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    queue_shm_t *shm;
+
+    if (queue->shm_slot == INPUT_SHM_NO_SLOT) return;
+    shm = &input_shm->queues[queue->shm_slot];
+    shm_write_begin( &shm->seq );
+    shm->wake_bits    = queue->wake_bits;
+    shm->changed_bits = queue->changed_bits;
+    shm->wake_mask    = queue->wake_mask;
+    shm->changed_mask = queue->changed_mask;
+    shm->desktop_slot = queue->input->desktop->shm_slot;
+    shm_write_end( &shm->seq );
+}
+
+/* publish the desktop cursor position and async key state to the shared state */
+static void update_desktop_shm( struct desktop *desktop )
+{
+    desktop_shm_t *shm;
+
+    if (desktop->shm_slot == INPUT_SHM_NO_SLOT) return;
+    shm = &input_shm->desktops[desktop->shm_slot];
+    shm_write_begin( &shm->seq );
+    shm->cursor_x      = desktop->cursor.x;
+    shm->cursor_y      = desktop->cursor.y;
+    shm->cursor_change = desktop->cursor.last_change;
+    memcpy( (void *)shm->keystate, desktop->keystate, sizeof(desktop->keystate) );
+    shm_write_end( &shm->seq );
+}
+
+void init_desktop_shm( struct desktop *desktop )
+{
+    desktop->shm_slot = alloc_shm_slot( &desktop_shm_slots );
+    update_desktop_shm( desktop );
+}
+
+void free_desktop_shm( struct desktop *desktop )
+{
+    free_shm_slot( &desktop_shm_slots, desktop->shm_slot );
+}
+
 /* create a thread input object */
 static struct thread_input *create_thread_input( struct thread *thread )
 {
@@ -309,11 +394,13 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
         queue->keystate_lock   = 0;
+        queue->shm_slot        = alloc_shm_slot( &queue_shm_slots );
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        update_queue_shm( queue );
 
         thread->queue = queue;
     }
@@ -374,6 +461,7 @@ static int assign_thread_input( struct thread *thread, struct thread_input *new_
     queue->input = (struct thread_input *)grab_object( new_input );
     if (queue->keystate_lock) lock_input_keystate( queue->input );
     new_input->cursor_count += queue->cursor_count;
+    update_queue_shm( queue );
     return 1;
 }
 
@@ -413,6 +501,7 @@ static int update_desktop_cursor_pos( struct desktop *desktop, int x, int y )
     desktop->cursor.x = x;
     desktop->cursor.y = y;
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shm( desktop );
 
     return updated;
 }
@@ -516,6 +605,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
     }
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shm( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -524,6 +614,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shm( queue );
     if (!(queue->wake_bits & (QS_KEY | QS_MOUSEBUTTON)))
     {
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
@@ -1038,6 +1129,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_queue_shm( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -1072,6 +1164,7 @@ static void msg_queue_destroy( struct object *obj )
         free( timer );
     }
     if (queue->timeout) remove_timeout_user( queue->timeout );
+    free_shm_slot( &queue_shm_slots, queue->shm_slot );
     queue->input->cursor_count -= queue->cursor_count;
     if (queue->keystate_lock) unlock_input_keystate( queue->input );
     release_object( queue->input );
@@ -1405,6 +1498,7 @@ static void update_input_key_state( struct desktop *desktop, unsigned char *keys
         }
         break;
     }
+    if (keystate == desktop->keystate) update_desktop_shm( desktop );
 }
 
 /* update the desktop key state according to a mouse message flags */
@@ -1785,6 +1879,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shm( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2402,7 +2497,12 @@ DECL_HANDLER(get_msg_queue)
     struct msg_queue *queue = get_current_queue();
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    reply->shm_slot = INPUT_SHM_NO_SLOT;
+    if (queue)
+    {
+        reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+        reply->shm_slot = queue->shm_slot;
+    }
 }
 
 
@@ -2448,6 +2548,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_queue_shm( queue );
     }
 }
 
@@ -2461,6 +2562,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shm( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2643,6 +2745,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shm( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2697,6 +2800,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_queue_shm( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -3072,6 +3176,7 @@ DECL_HANDLER(get_key_state)
         {
             reply->state = desktop->keystate[req->key & 0xff];
             desktop->keystate[req->key & 0xff] &= ~0x40;
+            update_desktop_shm( desktop );
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -3102,6 +3207,7 @@ DECL_HANDLER(set_key_state)
     if (req->async && (desktop = get_thread_desktop( current, 0 )))
     {
         memcpy( desktop->keystate, get_req_data(), size );
+        update_desktop_shm( desktop );
         release_object( desktop );
     }
 }
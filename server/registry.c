@@ -26,15 +26,22 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -74,6 +81,17 @@ struct type_descr key_type =
     },
 };
 
+/* hash index of the subkeys or values of a key */
+struct name_index
+{
+    unsigned int      size;        /* number of slots, a power of 2 */
+    struct
+    {
+        int           pos;         /* position in the array, -1 if the slot is free */
+        unsigned int  hash;        /* hash of the name */
+    } slots[1];
+};
+
 /* a registry key */
 struct key
 {
@@ -82,11 +100,15 @@ struct key
     data_size_t       classlen;    /* length of class name */
     int               last_subkey; /* last in use subkey */
     int               nb_subkeys;  /* count of allocated subkeys */
+    int               sorted_subkeys; /* count of subkeys in sorted order at the start of the array */
     struct key      **subkeys;     /* subkeys array */
+    struct name_index *subkey_index; /* hash index of the subkeys array for large keys */
     struct key       *wow6432node; /* Wow6432Node subkey */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
+    int               sorted_values; /* count of values in sorted order at the start of the array */
     struct key_value *values;      /* values array */
+    struct name_index *value_index; /* hash index of the values array for large keys */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
@@ -99,6 +121,7 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOWSHARE 0x0010  /* key is a Wow64 shared key (used for Software\Classes) */
 #define KEY_PREDEF   0x0020  /* key is marked as predefined */
+#define KEY_MODIFIED 0x0040  /* key contents have been modified since the last save */
 
 #define OBJ_KEY_WOW64 0x100000 /* magic flag added to attributes for WoW64 redirection */
 
@@ -114,6 +137,7 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEXED  32  /* min. number of subkeys or values for a key to be hash indexed */
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -132,18 +156,77 @@ static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_va
 
 static void set_periodic_save_timer(void);
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static void index_values( struct key *key );
+static void sort_values( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    char        *journal;    /* path of the binary journal file */
+    int          snapshot;   /* the journal needs a new snapshot of the whole branch */
+    int          text_dirty; /* the text file is older than the journal */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
+static int load_journal( struct save_branch_info *info );
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
 
+/* registry branches being saved in the background by a child process */
+struct save_process
+{
+    struct object    obj;         /* object header */
+    struct fd       *fd;          /* pipe to the saving process */
+    pid_t            pid;         /* pid of the saving process */
+    unsigned int     branches;    /* mask of branches being saved */
+};
+
+#define BACKGROUND_SAVE_TIMEOUT 10000  /* ms to wait for a background save on flush */
+
+static void save_process_dump( struct object *obj, int verbose );
+static void save_process_destroy( struct object *obj );
+
+static const struct object_ops save_process_ops =
+{
+    sizeof(struct save_process), /* size */
+    &no_type,                 /* type */
+    save_process_dump,        /* dump */
+    no_add_queue,             /* add_queue */
+    NULL,                     /* remove_queue */
+    NULL,                     /* signaled */
+    NULL,                     /* satisfied */
+    no_signal,                /* signal */
+    no_get_fd,                /* get_fd */
+    default_map_access,       /* map_access */
+    default_get_sd,           /* get_sd */
+    default_set_sd,           /* set_sd */
+    no_get_full_name,         /* get_full_name */
+    no_lookup_name,           /* lookup_name */
+    no_link_name,             /* link_name */
+    NULL,                     /* unlink_name */
+    no_open_file,             /* open_file */
+    no_kernel_obj_list,       /* get_kernel_obj_list */
+    no_close_handle,          /* close_handle */
+    save_process_destroy      /* destroy */
+};
+
+static void save_process_poll_event( struct fd *fd, int event );
+
+static const struct fd_ops save_process_fd_ops =
+{
+    NULL,                     /* get_poll_events */
+    save_process_poll_event,  /* poll_event */
+    NULL,                     /* flush */
+    NULL,                     /* get_fd_type */
+    NULL,                     /* ioctl */
+    NULL,                     /* queue_async */
+    NULL                      /* reselect_async */
+};
+
+static struct save_process *save_process;  /* pending background save */
+
 unsigned int supported_machines_count = 0;
 unsigned short supported_machines[8];
 unsigned short native_machine = 0;
@@ -285,12 +368,155 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* Large keys
+ *
+ * Subkeys and values are kept in arrays sorted by name, which are searched
+ * with a binary search. Once a key has more than MIN_INDEXED subkeys (or
+ * values), a hash index of the array is built, new entries are appended
+ * unsorted at the end of the array, and lookups go through the index. The
+ * unsorted tail is merged into the sorted part when the entries have to be
+ * accessed in order, for instance for enumeration or saving. This keeps
+ * creating many entries from being quadratic because of the array shifting.
+ * Removing entries drops the index, it gets rebuilt on the next insertion.
+ * A key without index always has a fully sorted array.
+ */
+
+/* compare two key names the same way as find_subkey */
+static int compare_key_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmp_strW( name1, name2, min( len1, len2 ));
+    return res ? res : len1 - len2;
+}
+
+static unsigned int hash_key_name( const WCHAR *name, data_size_t len )
+{
+    return hash_strW( name, len, ~0u );
+}
+
+/* allocate a hash index for an array of the given size */
+static struct name_index *alloc_name_index( int count )
+{
+    struct name_index *index;
+    unsigned int i, size = 2 * MIN_INDEXED;
+
+    while (size < 2 * count) size *= 2;
+    if (!(index = malloc( offsetof( struct name_index, slots[size] )))) return NULL;
+    index->size = size;
+    for (i = 0; i < size; i++) index->slots[i].pos = -1;
+    return index;
+}
+
+/* add an array entry to a hash index */
+static void name_index_add( struct name_index *index, unsigned int hash, int pos )
+{
+    unsigned int mask = index->size - 1, i;
+
+    for (i = hash & mask; index->slots[i].pos != -1; i = (i + 1) & mask) /* nothing */;
+    index->slots[i].pos  = pos;
+    index->slots[i].hash = hash;
+}
+
+/* merge the sorted tail of an array into its sorted beginning */
+static void merge_sorted( void *base, size_t size, int mid, int count,
+                          int (*compare)( const void *, const void * ))
+{
+    char *array = base, *tail;
+    int i, j, k;
+
+    if (!mid || compare( array + (mid - 1) * size, array + mid * size ) < 0) return;
+    if (!(tail = memdup( array + mid * size, (count - mid) * size )))
+    {
+        qsort( base, count, size, compare );
+        return;
+    }
+    for (i = mid - 1, j = count - mid - 1, k = count - 1; j >= 0; k--)
+    {
+        if (i >= 0 && compare( array + i * size, tail + j * size ) > 0)
+            memcpy( array + k * size, array + i-- * size, size );
+        else
+            memcpy( array + k * size, tail + j-- * size, size );
+    }
+    free( tail );
+}
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(struct key * const *)p1;
+    const struct key *key2 = *(struct key * const *)p2;
+
+    return compare_key_names( key1->obj.name->name, key1->obj.name->len,
+                              key2->obj.name->name, key2->obj.name->len );
+}
+
+static void sort_subkeys( struct key *key );
+
+/* (re)build the hash index of the subkeys of a key */
+static void index_subkeys( struct key *key )
+{
+    const struct object_name *name;
+    int i;
+
+    free( key->subkey_index );
+    if (!(key->subkey_index = alloc_name_index( key->nb_subkeys )))
+    {
+        /* without an index the array has to be sorted */
+        sort_subkeys( key );
+        return;
+    }
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        name = key->subkeys[i]->obj.name;
+        name_index_add( key->subkey_index, hash_key_name( name->name, name->len ), i );
+    }
+}
+
+/* sort the subkeys array of a key, so that it can be accessed by index */
+static void sort_subkeys( struct key *key )
+{
+    int count = key->last_subkey + 1;
+
+    if (key->sorted_subkeys == count) return;
+    qsort( key->subkeys + key->sorted_subkeys, count - key->sorted_subkeys,
+           sizeof(*key->subkeys), compare_subkeys );
+    merge_sorted( key->subkeys, sizeof(*key->subkeys), key->sorted_subkeys, count, compare_subkeys );
+    key->sorted_subkeys = count;
+    if (key->subkey_index) index_subkeys( key );
+}
+
+/* drop the hash index of the subkeys of a key, leaving a sorted array */
+static void unindex_subkeys( struct key *key )
+{
+    if (!key->subkey_index) return;
+    free( key->subkey_index );
+    key->subkey_index = NULL;
+    sort_subkeys( key );
+}
+
 /* find the named child of a given key and return its index */
 static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (key->subkey_index)
+    {
+        const struct name_index *idx = key->subkey_index;
+        unsigned int hash = hash_key_name( name->str, name->len ), mask = idx->size - 1, slot;
+        struct key *subkey;
+
+        for (slot = hash & mask; idx->slots[slot].pos != -1; slot = (slot + 1) & mask)
+        {
+            if (idx->slots[slot].hash != hash) continue;
+            subkey = key->subkeys[idx->slots[slot].pos];
+            if (subkey->obj.name->len != name->len ||
+                memicmp_strW( subkey->obj.name->name, name->str, name->len )) continue;
+            *index = idx->slots[slot].pos;
+            return subkey;
+        }
+        *index = key->last_subkey + 1;  /* new subkeys are appended */
+        return NULL;
+    }
+
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -333,15 +559,18 @@ static int grow_subkeys( struct key *key )
     }
     key->subkeys    = new_subkeys;
     key->nb_subkeys = nb_subkeys;
+    if (key->subkey_index && key->subkey_index->size < 2 * nb_subkeys) index_subkeys( key );
     return 1;
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -588,6 +817,8 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
         /* need to grow the array */
         if (!grow_subkeys( parent_key )) return 0;
     }
+    if (!parent_key->subkey_index && parent_key->last_subkey + 1 >= MIN_INDEXED)
+        index_subkeys( parent_key );
     tmp.str = name->name;
     tmp.len = name->len;
     find_subkey( parent_key, &tmp, &index );
@@ -595,6 +826,10 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     for (i = ++parent_key->last_subkey; i > index; i--)
         parent_key->subkeys[i] = parent_key->subkeys[i - 1];
     parent_key->subkeys[index] = (struct key *)grab_object( key );
+    if (parent_key->subkey_index)
+        name_index_add( parent_key->subkey_index, hash_key_name( name->name, name->len ), index );
+    else
+        parent_key->sorted_subkeys++;
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
         parent_key->wow6432node = key;
@@ -616,10 +851,13 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
+    /* search from the end, keys are usually deleted from there when deleting a tree */
+    for (i = parent->last_subkey; i >= 0; i--) if (parent->subkeys[i] == key) break;
+    assert( i >= 0 );
+    if (i < parent->sorted_subkeys) parent->sorted_subkeys--;
     for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
     parent->last_subkey--;
+    unindex_subkeys( parent );
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
     release_object( key );
@@ -660,12 +898,14 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free( key->value_index );
     for (i = 0; i <= key->last_subkey; i++)
     {
         key->subkeys[i]->obj.name->parent = NULL;
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free( key->subkey_index );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -693,11 +933,15 @@ static struct key *create_key_object( struct object *parent, const struct unicod
             key->flags       = 0;
             key->last_subkey = -1;
             key->nb_subkeys  = 0;
+            key->sorted_subkeys = 0;
             key->subkeys     = NULL;
+            key->subkey_index = NULL;
             key->wow6432node = NULL;
             key->nb_values   = 0;
             key->last_value  = -1;
+            key->sorted_values = 0;
             key->values      = NULL;
+            key->value_index = NULL;
             key->modif       = modif;
             list_init( &key->notify_list );
 
@@ -710,7 +954,7 @@ static struct key *create_key_object( struct object *parent, const struct unicod
                 release_object( key );
                 return NULL;
             }
-            else key->flags |= KEY_DIRTY;
+            else key->flags |= KEY_DIRTY | KEY_MODIFIED;
         }
     }
     return key;
@@ -734,10 +978,21 @@ static void make_clean( struct key *key )
 
     if (key->flags & KEY_VOLATILE) return;
     if (!(key->flags & KEY_DIRTY)) return;
-    key->flags &= ~KEY_DIRTY;
+    key->flags &= ~(KEY_DIRTY | KEY_MODIFIED);
     for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
 }
 
+/* mark a key and all its subkeys as modified, for instance when their path changes */
+/* the parents must already be dirty */
+static void make_modified( struct key *key )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    key->flags |= KEY_DIRTY | KEY_MODIFIED;
+    for (i = 0; i <= key->last_subkey; i++) make_modified( key->subkeys[i] );
+}
+
 /* go through all the notifications and send them if necessary */
 static void check_notify( struct key *key, unsigned int change, int not_subtree )
 {
@@ -756,6 +1011,7 @@ static void touch_key( struct key *key, unsigned int change )
 {
     key->modif = current_time;
     make_dirty( key );
+    if (!(key->flags & KEY_VOLATILE)) key->flags |= KEY_MODIFIED;
 
     /* do notifications */
     check_notify( key, change, 1 );
@@ -885,6 +1141,7 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        sort_subkeys( key );
         key = key->subkeys[index];
     }
 
@@ -975,6 +1232,9 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
         return;
     }
 
+    /* the new position is found with a binary search of the sorted array */
+    if (parent) unindex_subkeys( parent );
+
     /* check for existing subkey with the same name */
     if (!parent || (subkey = find_subkey( parent, new_name, &index )))
     {
@@ -1015,6 +1275,9 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
 
     if (debug_level > 1) dump_operation( key, NULL, "Rename" );
     touch_key( key, REG_NOTIFY_CHANGE_NAME );
+    /* the paths of the whole subtree have changed */
+    make_modified( key );
+    if (!(parent->flags & KEY_VOLATILE)) parent->flags |= KEY_MODIFIED;
 }
 
 /* delete a key and its values */
@@ -1075,15 +1338,79 @@ static int grow_values( struct key *key )
     }
     key->values = new_val;
     key->nb_values = nb_values;
+    if (key->value_index && key->value_index->size < 2 * nb_values) index_values( key );
     return 1;
 }
 
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1, *value2 = p2;
+
+    return compare_key_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* (re)build the hash index of the values of a key */
+static void index_values( struct key *key )
+{
+    int i;
+
+    free( key->value_index );
+    if (!(key->value_index = alloc_name_index( key->nb_values )))
+    {
+        /* without an index the array has to be sorted */
+        sort_values( key );
+        return;
+    }
+    for (i = 0; i <= key->last_value; i++)
+        name_index_add( key->value_index, hash_key_name( key->values[i].name, key->values[i].namelen ), i );
+}
+
+/* sort the values array of a key, so that it can be accessed by index */
+static void sort_values( struct key *key )
+{
+    int count = key->last_value + 1;
+
+    if (key->sorted_values == count) return;
+    qsort( key->values + key->sorted_values, count - key->sorted_values,
+           sizeof(*key->values), compare_values );
+    merge_sorted( key->values, sizeof(*key->values), key->sorted_values, count, compare_values );
+    key->sorted_values = count;
+    if (key->value_index) index_values( key );
+}
+
+/* drop the hash index of the values of a key, leaving a sorted array */
+static void unindex_values( struct key *key )
+{
+    if (!key->value_index) return;
+    free( key->value_index );
+    key->value_index = NULL;
+    sort_values( key );
+}
+
 /* find the named value of a given key and return its index in the array */
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (key->value_index)
+    {
+        const struct name_index *idx = key->value_index;
+        unsigned int hash = hash_key_name( name->str, name->len ), mask = idx->size - 1, slot;
+        struct key_value *value;
+
+        for (slot = hash & mask; idx->slots[slot].pos != -1; slot = (slot + 1) & mask)
+        {
+            if (idx->slots[slot].hash != hash) continue;
+            value = &key->values[idx->slots[slot].pos];
+            if (value->namelen != name->len || memicmp_strW( value->name, name->str, name->len )) continue;
+            *index = idx->slots[slot].pos;
+            return value;
+        }
+        *index = key->last_value + 1;  /* new values are appended */
+        return NULL;
+    }
+
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1127,6 +1454,10 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    if (key->value_index)
+        name_index_add( key->value_index, hash_key_name( name->str, name->len ), index );
+    else if (++key->sorted_values >= MIN_INDEXED)
+        index_values( key );
     return value;
 }
 
@@ -1227,6 +1558,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         void *data;
         data_size_t namelen, maxlen;
 
+        sort_values( key );
         value = &key->values[i];
         reply->type = value->type;
         namelen = value->namelen;
@@ -1284,11 +1616,17 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         set_error( STATUS_OBJECT_NAME_NOT_FOUND );
         return;
     }
+    if (key->value_index)
+    {
+        unindex_values( key );
+        value = find_value( key, name, &index );
+    }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
     free( value->name );
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
+    key->sorted_values--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1762,6 +2100,8 @@ static void load_registry( struct key *key, obj_handle_t handle )
         {
             load_keys( key, NULL, f, -1 );
             fclose( f );
+            make_dirty( key );
+            make_modified( key );
         }
         else file_set_error();
     }
@@ -1770,25 +2110,39 @@ static void load_registry( struct key *key, obj_handle_t handle )
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
+    struct save_branch_info info;
+    int loaded = 0;
     FILE *f;
 
-    if ((f = fopen( filename, "r" )))
+    info.path = filename;
+    info.key = key;
+    info.snapshot = 1;
+    info.text_dirty = 0;
+    if (!(info.journal = malloc( strlen( filename ) + sizeof(".journal") )))
+        fatal_error( "out of memory\n" );
+    sprintf( info.journal, "%s.journal", filename );
+
+    if (load_journal( &info )) loaded = 1;
+    else if ((f = fopen( filename, "r" )))
     {
         load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
+            free( info.journal );
             return 1;
         }
+        loaded = 1;
     }
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    save_branch_info[save_branch_count++] = info;
+    grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+    if (loaded) make_clean( key );
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -2081,16 +2435,652 @@ done:
     return ret;
 }
 
+/* Binary registry journal
+ *
+ * Each saved branch has a journal file next to its text file, made of a header,
+ * a snapshot of the whole branch, and then records for the keys modified since
+ * the snapshot was taken, appended at each periodic save. All the records have
+ * the same format: the full contents of a key, identified by its path relative
+ * to the branch root, and the names of its subkeys, so that replaying them in
+ * order rebuilds the branch. This makes periodic saves proportional to the
+ * amount of changes, and loading the binary data at startup avoids parsing the
+ * text file.
+ *
+ * The text file remains the reference format: it is still written on shutdown,
+ * and the journal is ignored if the text file has been modified since the
+ * snapshot was taken.
+ */
+
+#define JOURNAL_MAGIC    0x4c4e524a  /* "JRNL" */
+#define JOURNAL_VERSION  1
+#define JOURNAL_ALIGN(len) (((len) + 3) & ~3)
+
+struct journal_header
+{
+    unsigned int     magic;          /* JOURNAL_MAGIC */
+    unsigned int     version;        /* JOURNAL_VERSION */
+    unsigned int     prefix_type;    /* prefix architecture */
+    unsigned int     snapshot_size;  /* size of the header and snapshot, changes are appended after it */
+    unsigned __int64 text_size;      /* size of the text file when the snapshot was taken */
+    unsigned __int64 text_mtime;     /* modification time of the text file */
+    unsigned __int64 text_ino;       /* inode of the text file */
+};
+
+struct journal_record
+{
+    data_size_t      size;           /* size of the record, including this header */
+    unsigned int     checksum;       /* checksum of the data following the header */
+    timeout_t        modif;          /* key modification time */
+    unsigned int     flags;          /* key flags */
+    data_size_t      path_len;       /* length of the key path */
+    data_size_t      class_len;      /* length of the key class */
+    unsigned int     values;         /* number of values */
+    unsigned int     subkeys;        /* number of subkeys */
+    unsigned int     reserved;
+    /* followed by the path, the class, the values (struct journal_value, name and data)
+     * and the subkey names (length and name), each padded to 4 bytes */
+};
+
+struct journal_value
+{
+    data_size_t      namelen;        /* length of the value name */
+    unsigned int     type;           /* value type */
+    data_size_t      len;            /* length of the value data */
+};
+
+/* buffer used to build journal records */
+struct journal_buffer
+{
+    char            *data;
+    data_size_t      size;
+};
+
+static unsigned int journal_checksum( const void *data, data_size_t size )
+{
+    const unsigned char *ptr = data;
+    unsigned int sum = 0x811c9dc5;
+
+    while (size--) sum = (sum ^ *ptr++) * 0x01000193;
+    return sum;
+}
+
+static int journal_text_matches( const struct journal_header *header, const struct stat *st )
+{
+    return header->text_size == st->st_size && header->text_mtime == st->st_mtime &&
+           header->text_ino == st->st_ino;
+}
+
+/* write a record with the contents of a key to the journal */
+static int write_journal_key( FILE *f, struct journal_buffer *buffer, struct key *key,
+                              const struct key *base )
+{
+    static const WCHAR backslash = '\\';
+    struct journal_record *rec;
+    struct journal_value value;
+    const struct key *k;
+    data_size_t size, path_len = 0;
+    unsigned int subkeys = 0;
+    char *ptr;
+    int i;
+
+    sort_subkeys( key );
+    sort_values( key );
+    for (k = key; k != base; k = get_parent( k ))
+        path_len += k->obj.name->len + (k != key ? sizeof(WCHAR) : 0);
+
+    size = sizeof(*rec) + JOURNAL_ALIGN( path_len ) + JOURNAL_ALIGN( key->classlen );
+    for (i = 0; i <= key->last_value; i++)
+        size += sizeof(value) + JOURNAL_ALIGN( key->values[i].namelen ) + JOURNAL_ALIGN( key->values[i].len );
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        if (key->subkeys[i]->flags & KEY_VOLATILE) continue;
+        size += sizeof(data_size_t) + JOURNAL_ALIGN( key->subkeys[i]->obj.name->len );
+        subkeys++;
+    }
+
+    if (size > buffer->size)
+    {
+        char *new_data = realloc( buffer->data, max( size, 2 * buffer->size ));
+        if (!new_data) return 0;
+        buffer->data = new_data;
+        buffer->size = max( size, 2 * buffer->size );
+    }
+    memset( buffer->data, 0, size );
+
+    rec = (struct journal_record *)buffer->data;
+    rec->size      = size;
+    rec->modif     = key->modif;
+    rec->flags     = key->flags & KEY_SYMLINK;
+    rec->path_len  = path_len;
+    rec->class_len = key->classlen;
+    rec->values    = key->last_value + 1;
+    rec->subkeys   = subkeys;
+
+    ptr = (char *)(rec + 1) + path_len;
+    for (k = key; k != base; k = get_parent( k ))
+    {
+        if (k != key)
+        {
+            ptr -= sizeof(WCHAR);
+            memcpy( ptr, &backslash, sizeof(WCHAR) );
+        }
+        ptr -= k->obj.name->len;
+        memcpy( ptr, k->obj.name->name, k->obj.name->len );
+    }
+    ptr = (char *)(rec + 1) + JOURNAL_ALIGN( path_len );
+    if (key->classlen) memcpy( ptr, key->class, key->classlen );
+    ptr += JOURNAL_ALIGN( key->classlen );
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        value.namelen = key->values[i].namelen;
+        value.type    = key->values[i].type;
+        value.len     = key->values[i].len;
+        memcpy( ptr, &value, sizeof(value) );
+        ptr += sizeof(value);
+        if (value.namelen) memcpy( ptr, key->values[i].name, value.namelen );
+        ptr += JOURNAL_ALIGN( value.namelen );
+        if (value.len) memcpy( ptr, key->values[i].data, value.len );
+        ptr += JOURNAL_ALIGN( value.len );
+    }
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        const struct object_name *name = key->subkeys[i]->obj.name;
+
+        if (key->subkeys[i]->flags & KEY_VOLATILE) continue;
+        memcpy( ptr, &name->len, sizeof(data_size_t) );
+        ptr += sizeof(data_size_t);
+        memcpy( ptr, name->name, name->len );
+        ptr += JOURNAL_ALIGN( name->len );
+    }
+    rec->checksum = journal_checksum( rec + 1, size - sizeof(*rec) );
+    return fwrite( rec, size, 1, f ) == 1;
+}
+
+/* write records for a key and all its subkeys */
+static int write_journal_snapshot( FILE *f, struct journal_buffer *buffer, struct key *key,
+                                   const struct key *base )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return 1;
+    if (!write_journal_key( f, buffer, key, base )) return 0;
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!write_journal_snapshot( f, buffer, key->subkeys[i], base )) return 0;
+    return 1;
+}
+
+/* write records for the keys modified since the last save */
+static int write_journal_changes( FILE *f, struct journal_buffer *buffer, struct key *key,
+                                  const struct key *base )
+{
+    int i;
+
+    if ((key->flags & KEY_VOLATILE) || !(key->flags & KEY_DIRTY)) return 1;
+    if ((key->flags & KEY_MODIFIED) && !write_journal_key( f, buffer, key, base )) return 0;
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!write_journal_changes( f, buffer, key->subkeys[i], base )) return 0;
+    return 1;
+}
+
+/* save a registry branch to its journal, either as a new snapshot or by appending the changes */
+static int save_branch_journal( const struct save_branch_info *info, int snapshot )
+{
+    struct journal_buffer buffer = { NULL, 0 };
+    struct journal_header header;
+    struct stat st;
+    char *tmp = NULL;
+    int fd, ret = 0;
+    FILE *f;
+
+    if (snapshot)
+    {
+        memset( &header, 0, sizeof(header) );
+        header.magic       = JOURNAL_MAGIC;
+        header.version     = JOURNAL_VERSION;
+        header.prefix_type = prefix_type;
+        if (!stat( info->path, &st ))
+        {
+            header.text_size  = st.st_size;
+            header.text_mtime = st.st_mtime;
+            header.text_ino   = st.st_ino;
+        }
+        if (!(tmp = malloc( strlen( info->journal ) + 5 ))) return 0;
+        sprintf( tmp, "%s.tmp", info->journal );
+        fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 );
+    }
+    else fd = open( info->journal, O_WRONLY | O_APPEND );
+
+    if (fd == -1) goto done;
+    if (!(f = fdopen( fd, "w" )))
+    {
+        close( fd );
+        goto done;
+    }
+
+    if (debug_level > 1)
+    {
+        fprintf( stderr, "%s: ", info->journal );
+        dump_operation( info->key, NULL, snapshot ? "journal snapshot" : "journal changes" );
+    }
+
+    if (snapshot)
+    {
+        ret = fwrite( &header, sizeof(header), 1, f ) == 1 &&
+              write_journal_snapshot( f, &buffer, info->key, info->key );
+        header.snapshot_size = ftell( f );
+        ret = ret && !fseek( f, 0, SEEK_SET ) && fwrite( &header, sizeof(header), 1, f ) == 1;
+    }
+    else ret = write_journal_changes( f, &buffer, info->key, info->key );
+    if (fclose( f )) ret = 0;
+
+    if (tmp)
+    {
+        if (ret) ret = !rename( tmp, info->journal );
+        if (!ret) unlink( tmp );
+    }
+
+done:
+    free( tmp );
+    free( buffer.data );
+    return ret;
+}
+
+/* check if the journal of a branch needs a new snapshot, or if the changes can be appended to it */
+static int journal_needs_snapshot( const struct save_branch_info *info )
+{
+    struct journal_header header;
+    struct stat st, text_st;
+    int fd, ret = 1;
+
+    if (info->snapshot) return 1;
+    if ((fd = open( info->journal, O_RDONLY )) == -1) return 1;
+    if (!fstat( fd, &st ) && read( fd, &header, sizeof(header) ) == sizeof(header) &&
+        header.magic == JOURNAL_MAGIC && !stat( info->path, &text_st ) &&
+        journal_text_matches( &header, &text_st ))
+    {
+        /* compact the journal once the changes are larger than the snapshot */
+        ret = st.st_size - header.snapshot_size > header.snapshot_size;
+    }
+    close( fd );
+    return ret;
+}
+
+/* check the validity of a journal record, and return its size */
+static data_size_t check_journal_record( const char *data, data_size_t avail )
+{
+    struct journal_record rec;
+    struct journal_value value;
+    data_size_t pos, len;
+    unsigned int i;
+
+    if (avail < sizeof(rec)) return 0;
+    memcpy( &rec, data, sizeof(rec) );
+    if (rec.size < sizeof(rec) || rec.size > avail || rec.size % 4) return 0;
+    if (journal_checksum( data + sizeof(rec), rec.size - sizeof(rec) ) != rec.checksum) return 0;
+
+    pos = sizeof(rec);
+    if ((rec.path_len | rec.class_len) % sizeof(WCHAR)) return 0;
+    if (rec.path_len > rec.size - pos) return 0;
+    pos += JOURNAL_ALIGN( rec.path_len );
+    if (rec.class_len > rec.size - pos) return 0;
+    pos += JOURNAL_ALIGN( rec.class_len );
+    for (i = 0; i < rec.values; i++)
+    {
+        if (sizeof(value) > rec.size - pos) return 0;
+        memcpy( &value, data + pos, sizeof(value) );
+        pos += sizeof(value);
+        if (value.namelen > MAX_VALUE_LEN * sizeof(WCHAR) || value.namelen % sizeof(WCHAR)) return 0;
+        if (value.namelen > rec.size - pos) return 0;
+        pos += JOURNAL_ALIGN( value.namelen );
+        if (value.len > rec.size - pos) return 0;
+        pos += JOURNAL_ALIGN( value.len );
+    }
+    for (i = 0; i < rec.subkeys; i++)
+    {
+        if (sizeof(len) > rec.size - pos) return 0;
+        memcpy( &len, data + pos, sizeof(len) );
+        pos += sizeof(len);
+        if (!len || len > MAX_NAME_LEN * sizeof(WCHAR) || len % sizeof(WCHAR)) return 0;
+        if (len > rec.size - pos) return 0;
+        pos += JOURNAL_ALIGN( len );
+    }
+    return pos == rec.size ? rec.size : 0;
+}
+
+/* apply a journal record to a registry branch */
+static void apply_journal_record( struct key *base, const char *data )
+{
+    struct journal_record rec;
+    struct journal_value value;
+    struct key_value *key_value;
+    struct unicode_str name;
+    struct key *key, *subkey;
+    const char *ptr, *names;
+    data_size_t len;
+    int i, j, res;
+
+    memcpy( &rec, data, sizeof(rec) );
+    ptr = data + sizeof(rec);
+    name.str = (const WCHAR *)ptr;
+    name.len = rec.path_len;
+    if (!(key = create_key_recursive( base, &name, rec.modif ))) return;
+    ptr += JOURNAL_ALIGN( rec.path_len );
+
+    key->modif = rec.modif;
+    key->flags = (key->flags & ~KEY_SYMLINK) | (rec.flags & KEY_SYMLINK);
+    free( key->class );
+    key->class = NULL;
+    key->classlen = 0;
+    if (rec.class_len && (key->class = memdup( ptr, rec.class_len ))) key->classlen = rec.class_len;
+    ptr += JOURNAL_ALIGN( rec.class_len );
+
+    /* replace all the values, they are stored in the key order */
+    for (i = 0; i <= key->last_value; i++)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    key->last_value = -1;
+    key->sorted_values = 0;
+    free( key->value_index );
+    key->value_index = NULL;
+    for (i = 0; i < rec.values; i++)
+    {
+        memcpy( &value, ptr, sizeof(value) );
+        ptr += sizeof(value);
+        name.str = (const WCHAR *)ptr;
+        name.len = value.namelen;
+        ptr += JOURNAL_ALIGN( value.namelen );
+        if ((key_value = insert_value( key, &name, key->last_value + 1 )))
+        {
+            key_value->type = value.type;
+            if (value.len && (key_value->data = memdup( ptr, value.len ))) key_value->len = value.len;
+        }
+        ptr += JOURNAL_ALIGN( value.len );
+    }
+
+    /* delete the subkeys that are not in the record anymore, both lists are sorted the same way */
+    sort_subkeys( key );
+    names = ptr;
+    for (i = j = 0; i <= key->last_subkey; )
+    {
+        subkey = key->subkeys[i];
+        res = 1;
+        while (j < rec.subkeys)
+        {
+            memcpy( &len, names, sizeof(len) );
+            res = compare_key_names( (const WCHAR *)(names + sizeof(len)), len,
+                                     subkey->obj.name->name, subkey->obj.name->len );
+            if (res >= 0) break;
+            names += sizeof(len) + JOURNAL_ALIGN( len );
+            j++;
+        }
+        if (!res || (subkey->flags & KEY_VOLATILE) || !delete_key( subkey, 1 )) i++;
+    }
+    release_object( key );
+}
+
+/* load a registry branch from its journal; return 0 if the text file has to be loaded instead */
+static int load_journal( struct save_branch_info *info )
+{
+    struct journal_header header;
+    struct stat st, text_st;
+    data_size_t pos, end, len;
+    char *data = NULL;
+    int fd, ret = 0;
+
+    if ((fd = open( info->journal, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) || st.st_size < sizeof(header) || st.st_size > INT_MAX) goto done;
+    if (stat( info->path, &text_st )) goto done;
+    if (!(data = malloc( st.st_size ))) goto done;
+    for (pos = 0; pos < st.st_size; pos += len)
+    {
+        ssize_t res = read( fd, data + pos, st.st_size - pos );
+        if (res <= 0) goto done;
+        len = res;
+    }
+
+    memcpy( &header, data, sizeof(header) );
+    if (header.magic != JOURNAL_MAGIC || header.version != JOURNAL_VERSION) goto done;
+    if (!journal_text_matches( &header, &text_st )) goto done;
+    if (header.prefix_type != PREFIX_32BIT && header.prefix_type != PREFIX_64BIT) goto done;
+    if (prefix_type != PREFIX_UNKNOWN && prefix_type != header.prefix_type) goto done;
+    if (header.snapshot_size < sizeof(header) || header.snapshot_size > st.st_size) goto done;
+
+    /* check all the records first, a truncated record at the end is ignored */
+    for (pos = sizeof(header); pos < st.st_size; pos += len)
+        if (!(len = check_journal_record( data + pos, st.st_size - pos ))) break;
+    if (pos < header.snapshot_size) goto done;
+    if (pos < st.st_size)
+        fprintf( stderr, "%s: ignoring corrupted journal data at offset %u\n", info->journal, pos );
+
+    prefix_type = header.prefix_type;
+    info->snapshot = pos < st.st_size;
+    info->text_dirty = pos > header.snapshot_size;
+    end = pos;
+    for (pos = sizeof(header); pos < end; pos += len)
+    {
+        memcpy( &len, data + pos, sizeof(len) );
+        apply_journal_record( info->key, data + pos );
+    }
+    ret = 1;
+
+done:
+    free( data );
+    close( fd );
+    return ret;
+}
+
+static void save_process_dump( struct object *obj, int verbose )
+{
+    struct save_process *process = (struct save_process *)obj;
+    fprintf( stderr, "Registry save process fd=%p pid=%d branches=%x\n",
+             process->fd, (int)process->pid, process->branches );
+}
+
+static void save_process_destroy( struct object *obj )
+{
+    struct save_process *process = (struct save_process *)obj;
+    if (process->fd) release_object( process->fd );
+}
+
+/* collect the result of a background save; branches that failed are marked dirty again */
+static void end_background_save( struct save_process *process, unsigned char saved )
+{
+    int i;
+
+    for (i = 0; i < save_branch_count; i++)
+    {
+        if (!(process->branches & (1 << i)) || (saved & (1 << i))) continue;
+        fprintf( stderr, "wineserver: could not save registry branch to %s\n", save_branch_info[i].journal );
+        /* the modified keys are not known anymore, take a new snapshot */
+        save_branch_info[i].snapshot = 1;
+    }
+    if (save_process == process) save_process = NULL;
+    release_object( process );
+}
+
+static void save_process_poll_event( struct fd *fd, int event )
+{
+    struct save_process *process = get_fd_user( fd );
+    unsigned char saved = 0;
+
+    if (event & (POLLIN | POLLERR | POLLHUP))
+    {
+        if (read( get_unix_fd( fd ), &saved, 1 ) != 1) saved = 0;
+        end_background_save( process, saved );
+    }
+}
+
+/* wait for a pending background save to complete; if it doesn't complete in time
+ * it is killed, and its branches get saved again by the caller */
+static void wait_background_save(void)
+{
+    struct pollfd pfd;
+    unsigned char saved = 0;
+    int ret;
+
+    if (!save_process) return;
+    pfd.fd = get_unix_fd( save_process->fd );
+    pfd.events = POLLIN;
+    while ((ret = poll( &pfd, 1, BACKGROUND_SAVE_TIMEOUT )) == -1 && errno == EINTR) /* nothing */;
+    if (ret <= 0)
+    {
+        /* the saving process holds the other end of the pipe, so it's still around */
+        fprintf( stderr, "wineserver: registry save timed out, killing process %d\n", (int)save_process->pid );
+        kill( save_process->pid, SIGKILL );
+    }
+    else if (read( pfd.fd, &saved, 1 ) != 1) saved = 0;
+    end_background_save( save_process, saved );
+}
+
+/* check if a branch has changes to save to its journal */
+static int branch_needs_save( const struct save_branch_info *info )
+{
+    return (info->key->flags & KEY_DIRTY) || info->snapshot;
+}
+
+/* update the branch state once its changes have been handed over to be saved in the journal */
+static void branch_saved_to_journal( struct save_branch_info *info )
+{
+    if (info->key->flags & KEY_DIRTY) info->text_dirty = 1;
+    info->snapshot = 0;
+    make_clean( info->key );
+}
+
+/* close the server fds inherited by a child process, except stdio and the one to keep */
+static void close_server_fds( int keep )
+{
+    struct dirent *de;
+    DIR *dir;
+    int fd, max_fd;
+
+#ifdef __NR_close_range
+    if ((keep <= 3 || !syscall( __NR_close_range, 3, keep - 1, 0 )) &&
+        !syscall( __NR_close_range, max( keep + 1, 3 ), ~0u, 0 ))
+        return;
+#endif
+
+    /* only walk the fds that are actually open if we can */
+    if ((dir = opendir( "/proc/self/fd" )))
+    {
+        while ((de = readdir( dir )))
+        {
+            if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+            fd = atoi( de->d_name );
+            if (fd > 2 && fd != keep && fd != dirfd( dir )) close( fd );
+        }
+        closedir( dir );
+        return;
+    }
+
+    max_fd = sysconf( _SC_OPEN_MAX );
+    for (fd = 3; fd < max_fd; fd++) if (fd != keep) close( fd );
+}
+
+/* save the dirty branches from a child process, so that the main loop is not
+ * blocked while the files are written; the child works on a copy-on-write
+ * snapshot of the registry and reports the branches it saved through a pipe */
+static int start_background_save(void)
+{
+    struct save_process *process;
+    unsigned int branches = 0, snapshots = 0;
+    unsigned char saved;
+    int i, fd[2], status;
+    pid_t pid;
+
+    for (i = 0; i < save_branch_count; i++)
+    {
+        if (!branch_needs_save( &save_branch_info[i] )) continue;
+        branches |= 1 << i;
+        if (journal_needs_snapshot( &save_branch_info[i] )) snapshots |= 1 << i;
+    }
+    if (!branches) return 1;
+
+    if (pipe( fd ) == -1) return 0;
+    if (!(process = alloc_object( &save_process_ops )))
+    {
+        close( fd[0] );
+        close( fd[1] );
+        return 0;
+    }
+    process->fd = NULL;
+    process->pid = -1;
+    process->branches = branches;
+
+    switch ((pid = fork()))
+    {
+    case 0:
+        /* fork again so that the saving process doesn't need to be reaped;
+         * its pid is sent first, so that it can be killed if it hangs */
+        if ((pid = fork()))
+        {
+            if (write( fd[1], &pid, sizeof(pid) ) != sizeof(pid)) _exit(1);
+            _exit(0);
+        }
+        /* don't keep the client connections open behind the server's back */
+        close_server_fds( fd[1] );
+        for (i = saved = 0; i < save_branch_count; i++)
+            if ((branches & (1 << i)) && save_branch_journal( &save_branch_info[i], snapshots & (1 << i) ))
+                saved |= 1 << i;
+        /* without a result the server considers that nothing was saved */
+        if (write( fd[1], &saved, 1 ) != 1) _exit(1);
+        _exit(0);
+    case -1:
+        close( fd[0] );
+        close( fd[1] );
+        release_object( process );
+        return 0;
+    default:
+        close( fd[1] );
+        /* the first child exits right after forking. sigchld_callback() only runs from the
+         * main loop, so it can't reap the child before us; the grandchild isn't ours to reap */
+        while (waitpid( pid, &status, 0 ) == -1 && errno == EINTR) /* nothing */;
+        if (read( fd[0], &process->pid, sizeof(process->pid) ) != sizeof(process->pid) ||
+            process->pid == -1)
+        {
+            close( fd[0] );
+            release_object( process );
+            return 0;
+        }
+        break;
+    }
+
+    if (!(process->fd = create_anonymous_fd( &save_process_fd_ops, fd[0], &process->obj, 0 )))
+    {
+        release_object( process );
+        return 0;
+    }
+    set_fd_events( process->fd, POLLIN );
+
+    /* the child owns the snapshot now, further changes will make the keys dirty again */
+    for (i = 0; i < save_branch_count; i++)
+        if (branches & (1 << i)) branch_saved_to_journal( &save_branch_info[i] );
+    save_process = process;
+    return 1;
+}
+
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
     int i;
 
-    if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
-    for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
-    if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+    if (!save_process)
+    {
+        if (fchdir( config_dir_fd ) == -1) return;
+        if (!start_background_save())
+        {
+            for (i = 0; i < save_branch_count; i++)
+            {
+                struct save_branch_info *info = &save_branch_info[i];
+                if (branch_needs_save( info ) && save_branch_journal( info, journal_needs_snapshot( info )))
+                    branch_saved_to_journal( info );
+            }
+        }
+        if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+    }
     set_periodic_save_timer();
 }
 
@@ -2104,17 +3094,28 @@ static void set_periodic_save_timer(void)
 /* save the modified registry branches to disk */
 void flush_registry(void)
 {
+    struct save_branch_info *info;
     int i;
 
+    wait_background_save();
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        info = &save_branch_info[i];
+        if (info->text_dirty) make_dirty( info->key );
+        if (info->key->flags & KEY_DIRTY)
         {
-            fprintf( stderr, "wineserver: could not save registry branch to %s",
-                     save_branch_info[i].path );
-            perror( " " );
+            if (!save_branch( info->key, info->path ))
+            {
+                fprintf( stderr, "wineserver: could not save registry branch to %s", info->path );
+                perror( " " );
+                continue;
+            }
+            /* the text file is up to date, start a new journal matching it */
+            info->text_dirty = 0;
+            info->snapshot = 1;
         }
+        if (info->snapshot && save_branch_journal( info, 1 )) info->snapshot = 0;
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 }
@@ -324,6 +324,153 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* check if a request can be executed as part of a batch; only the requests that
+ * the clients actually batch are allowed, the others may need the client to act
+ * on their reply before the next request runs */
+static int is_batchable_request( enum request req )
+{
+    switch (req)
+    {
+    case REQ_open_key:
+    case REQ_get_key_value:
+    case REQ_close_handle:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* size of a batched request or reply, including its data */
+static inline data_size_t batch_data_size( data_size_t size )
+{
+    return (size + 7) & ~7;
+}
+
+/* execute a batch of requests */
+DECL_HANDLER(batch_requests)
+{
+    struct thread *thread = current;
+    const union generic_request batch_req = current->req;
+    void *batch_data = current->req_data;
+    const char *ptr, *data = get_req_data(), *end = data + get_req_data_size();
+    data_size_t pos, *offsets;
+    unsigned __int64 reply_size = 0;
+    unsigned int i, count = 0;
+    char *replies;
+
+    /* validate the requests before executing any of them */
+    for (ptr = data; ptr < end; count++)
+    {
+        const struct batch_request *header = (const struct batch_request *)ptr;
+        const union generic_request *sub_req = (const union generic_request *)(header + 1);
+
+        if (end - ptr < sizeof(*header) + sizeof(*sub_req) ||
+            end - ptr - sizeof(*header) - sizeof(*sub_req) < sub_req->request_header.request_size ||
+            !is_batchable_request( sub_req->request_header.req ))
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            return;
+        }
+        if (sub_req->request_header.reply_size > get_reply_max_size())
+        {
+            set_error( STATUS_BUFFER_TOO_SMALL );
+            return;
+        }
+        if (header->handle_offset &&
+            (header->handle_index >= count ||
+             header->handle_offset < sizeof(struct request_header) ||
+             header->handle_offset > sizeof(*sub_req) - sizeof(obj_handle_t) ||
+             header->handle_offset % sizeof(obj_handle_t) ||
+             header->handle_source < sizeof(struct reply_header) ||
+             header->handle_source > sizeof(union generic_reply) - sizeof(obj_handle_t) ||
+             header->handle_source % sizeof(obj_handle_t)))
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            return;
+        }
+        /* computed in 64-bit so that neither the rounding nor the sum can wrap */
+        reply_size += sizeof(union generic_reply) + (((unsigned __int64)sub_req->request_header.reply_size + 7) & ~7);
+        ptr += sizeof(*header) + sizeof(*sub_req) + batch_data_size( sub_req->request_header.request_size );
+    }
+    if (reply_size > get_reply_max_size())
+    {
+        set_error( STATUS_BUFFER_TOO_SMALL );
+        return;
+    }
+    if (!count) return;
+    if (!(replies = mem_alloc( reply_size ))) return;
+    if (!(offsets = mem_alloc( count * sizeof(*offsets) )))
+    {
+        free( replies );
+        return;
+    }
+
+    for (i = 0, ptr = data, pos = 0; i < count; i++)
+    {
+        const struct batch_request *header = (const struct batch_request *)ptr;
+        union generic_reply *sub_reply = (union generic_reply *)(replies + pos);
+        data_size_t max_size;
+        enum request req;
+
+        memcpy( &current->req, header + 1, sizeof(current->req) );
+        current->req_data = (char *)(header + 1) + sizeof(current->req);
+        ptr = (char *)current->req_data + batch_data_size( current->req.request_header.request_size );
+        req = current->req.request_header.req;
+        max_size = current->req.request_header.reply_size;
+        offsets[i] = pos;
+        memset( sub_reply, 0, sizeof(*sub_reply) );
+
+        if (header->handle_offset)
+        {
+            const union generic_reply *source = (const union generic_reply *)(replies + offsets[header->handle_index]);
+            obj_handle_t handle;
+
+            memcpy( &handle, (const char *)source + header->handle_source, sizeof(handle) );
+            if (!handle)
+            {
+                /* the request that should have returned the handle failed, skip this one too */
+                sub_reply->reply_header.error = source->reply_header.error ? source->reply_header.error
+                                                                          : STATUS_INVALID_HANDLE;
+                pos += sizeof(*sub_reply);
+                continue;
+            }
+            memcpy( (char *)&current->req + header->handle_offset, &handle, sizeof(handle) );
+        }
+
+        current->reply_size = 0;
+        clear_error();
+        if (debug_level) trace_request();
+
+        req_handlers[req]( &current->req, sub_reply );
+
+        if (!current)  /* the thread has been killed */
+        {
+            thread->req = batch_req;
+            thread->req_data = batch_data;
+            free( replies );
+            free( offsets );
+            return;
+        }
+        /* never copy more than the space reserved for this reply */
+        if (current->reply_size > max_size) current->reply_size = max_size;
+        sub_reply->reply_header.error = current->error;
+        sub_reply->reply_header.reply_size = current->reply_size;
+        if (debug_level) trace_reply( req, sub_reply );
+        if (current->reply_size) memcpy( sub_reply + 1, current->reply_data, current->reply_size );
+        free( current->reply_data );
+        current->reply_data = NULL;
+        pos += sizeof(*sub_reply) + batch_data_size( current->reply_size );
+    }
+
+    current->req = batch_req;
+    current->req_data = batch_data;
+    current->reply_size = 0;
+    clear_error();
+    free( offsets );
+    reply->count = count;
+    set_reply_data_ptr( replies, pos );
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
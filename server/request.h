@@ -152,6 +152,7 @@ DECL_HANDLER(create_event);
 DECL_HANDLER(event_op);
 DECL_HANDLER(query_event);
 DECL_HANDLER(open_event);
+DECL_HANDLER(get_fast_sync_slot);
 DECL_HANDLER(create_keyed_event);
 DECL_HANDLER(open_keyed_event);
 DECL_HANDLER(create_mutex);
@@ -199,6 +200,7 @@ DECL_HANDLER(debug_process);
 DECL_HANDLER(set_debug_obj_info);
 DECL_HANDLER(read_process_memory);
 DECL_HANDLER(write_process_memory);
+DECL_HANDLER(get_process_vm_pid);
 DECL_HANDLER(create_key);
 DECL_HANDLER(open_key);
 DECL_HANDLER(delete_key);
@@ -396,6 +398,7 @@ DECL_HANDLER(terminate_job);
 DECL_HANDLER(suspend_process);
 DECL_HANDLER(resume_process);
 DECL_HANDLER(get_next_thread);
+DECL_HANDLER(batch_requests);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -435,6 +438,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_event_op,
     (req_handler)req_query_event,
     (req_handler)req_open_event,
+    (req_handler)req_get_fast_sync_slot,
     (req_handler)req_create_keyed_event,
     (req_handler)req_open_keyed_event,
     (req_handler)req_create_mutex,
@@ -482,6 +486,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_set_debug_obj_info,
     (req_handler)req_read_process_memory,
     (req_handler)req_write_process_memory,
+    (req_handler)req_get_process_vm_pid,
     (req_handler)req_create_key,
     (req_handler)req_open_key,
     (req_handler)req_delete_key,
@@ -679,6 +684,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_suspend_process,
     (req_handler)req_resume_process,
     (req_handler)req_get_next_thread,
+    (req_handler)req_batch_requests,
 };
 
 C_ASSERT( sizeof(abstime_t) == 8 );
@@ -929,6 +935,12 @@ C_ASSERT( FIELD_OFFSET(struct open_event_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_event_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_event_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_event_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_slot_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_fast_sync_slot_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_slot_reply, slot) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_slot_reply, serial) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_slot_reply, type) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_slot_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct create_keyed_event_request, access) == 12 );
 C_ASSERT( sizeof(struct create_keyed_event_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_keyed_event_reply, handle) == 8 );
@@ -1182,6 +1194,11 @@ C_ASSERT( sizeof(struct read_process_memory_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, addr) == 16 );
 C_ASSERT( sizeof(struct write_process_memory_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_process_vm_pid_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_process_vm_pid_request, access) == 16 );
+C_ASSERT( sizeof(struct get_process_vm_pid_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_process_vm_pid_reply, unix_pid) == 8 );
+C_ASSERT( sizeof(struct get_process_vm_pid_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, options) == 16 );
 C_ASSERT( sizeof(struct create_key_request) == 24 );
@@ -1308,6 +1325,7 @@ C_ASSERT( FIELD_OFFSET(struct get_atom_information_reply, total) == 16 );
 C_ASSERT( sizeof(struct get_atom_information_reply) == 24 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, shm_slot) == 12 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
@@ -2267,6 +2285,9 @@ C_ASSERT( FIELD_OFFSET(struct get_next_thread_request, flags) == 28 );
 C_ASSERT( sizeof(struct get_next_thread_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_next_thread_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_next_thread_reply) == 16 );
+C_ASSERT( sizeof(struct batch_requests_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct batch_requests_reply, count) == 8 );
+C_ASSERT( sizeof(struct batch_requests_reply) == 16 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
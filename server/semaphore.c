@@ -52,15 +52,16 @@ struct type_descr semaphore_type =
 
 struct semaphore
 {
-    struct object  obj;    /* object header */
-    unsigned int   count;  /* current count */
-    unsigned int   max;    /* maximum possible count */
+    struct object     obj;    /* object header */
+    fast_sync_slot_t *sync;   /* current count, possibly shared with the clients */
+    unsigned int      max;    /* maximum possible count */
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signal( struct object *obj, unsigned int access );
+static void semaphore_destroy( struct object *obj );
 
 static const struct object_ops semaphore_ops =
 {
@@ -83,7 +84,7 @@ static const struct object_ops semaphore_ops =
     no_open_file,                  /* open_file */
     no_kernel_obj_list,            /* get_kernel_obj_list */
     no_close_handle,               /* close_handle */
-    no_destroy                     /* destroy */
+    semaphore_destroy              /* destroy */
 };
 
 
@@ -93,7 +94,8 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
 {
     struct semaphore *sem;
 
-    if (!max || (initial > max))
+    /* the count must fit in the shared state */
+    if (!max || (initial > max) || max > 0x7fffffff)
     {
         set_error( STATUS_INVALID_PARAMETER );
         return NULL;
@@ -103,55 +105,72 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
         if (get_error() != STATUS_OBJECT_NAME_EXISTS)
         {
             /* initialize it if it didn't already exist */
-            sem->count = initial;
-            sem->max   = max;
+            sem->max = max;
+            if (!(sem->sync = alloc_fast_sync( initial )))
+            {
+                release_object( sem );
+                return NULL;
+            }
         }
     }
     return sem;
 }
 
+/* lock the count, clients may be decrementing it; since all processes can write
+ * to the fast sync state, a count above the maximum is clamped */
+static unsigned int lock_count( struct semaphore *sem )
+{
+    unsigned int count = lock_fast_sync( sem->sync );
+
+    if (count <= sem->max) return count;
+    set_fast_sync_value( sem->sync, sem->max );
+    return sem->max;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
-    if (prev) *prev = sem->count;
-    if (sem->count + count < sem->count || sem->count + count > sem->max)
+    unsigned int current = lock_count( sem );
+    int ret = 0;
+
+    if (prev) *prev = current;
+    if (count > sem->max - current)
     {
         set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
-        return 0;
-    }
-    else if (sem->count)
-    {
-        /* there cannot be any thread to wake up if the count is != 0 */
-        sem->count += count;
     }
     else
     {
-        sem->count = count;
-        wake_up( &sem->obj, count );
+        set_fast_sync_value( sem->sync, current + count );
+        /* there cannot be any thread to wake up if the count was != 0 */
+        if (!current) wake_up( &sem->obj, count );
+        ret = 1;
     }
-    return 1;
+    unlock_fast_syncs();
+    return ret;
 }
 
 static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d\n", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d\n", get_fast_sync_value( sem->sync ), sem->max );
 }
 
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    return (sem->count > 0);
+    /* keep clients from taking the count until the wait is satisfied */
+    return lock_count( sem ) > 0;
 }
 
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
+    unsigned int count;
+
     assert( obj->ops == &semaphore_ops );
-    assert( sem->count );
-    sem->count--;
+    if ((count = lock_count( sem ))) set_fast_sync_value( sem->sync, count - 1 );
 }
 
 static int semaphore_signal( struct object *obj, unsigned int access )
@@ -167,6 +186,20 @@ static int semaphore_signal( struct object *obj, unsigned int access )
     return release_semaphore( sem, 1, NULL );
 }
 
+static void semaphore_destroy( struct object *obj )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    free_fast_sync( sem->sync );
+}
+
+/* get the count of a semaphore, possibly shared with the clients */
+fast_sync_slot_t *get_semaphore_fast_sync( struct object *obj )
+{
+    if (obj->ops != &semaphore_ops) return NULL;
+    return ((struct semaphore *)obj)->sync;
+}
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -221,7 +254,7 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
+        reply->current = min( get_fast_sync_value( sem->sync ), sem->max );
         reply->max = sem->max;
         release_object( sem );
     }
@@ -225,6 +225,7 @@ struct sock
     }
     icmp_fixup_data[MAX_ICMP_HISTORY_LENGTH]; /* Sent ICMP packets history used to fixup reply id. */
     unsigned int        icmp_fixup_data_len;  /* Sent ICMP packets history length. */
+    fast_sync_slot_t   *fast_sync;   /* state shared with the clients */
     unsigned int        rd_shutdown : 1; /* is the read end shut down? */
     unsigned int        wr_shutdown : 1; /* is the write end shut down? */
     unsigned int        wr_shutdown_pending : 1; /* is a write shutdown pending? */
@@ -576,6 +577,24 @@ void sock_init(void)
     }
 }
 
+/* publish whether the client may recv() or send() directly on the unix fd;
+ * this is only allowed when doing so can't change any state we keep track of */
+static void sock_update_fast_sync( struct sock *sock )
+{
+    unsigned int flags = 0;
+
+    if (sock->type)
+    {
+        if (!sock->rd_shutdown && !sock->accept_recv_req && !async_queued( &sock->read_q ) &&
+            !(sock->reported_events & AFD_POLL_READ))
+            flags |= FAST_SYNC_SOCKET_RECV;
+        if (!sock->wr_shutdown && !async_queued( &sock->write_q ) &&
+            !(sock->reported_events & AFD_POLL_WRITE) && (sock->type != WS_SOCK_DGRAM || sock->bound))
+            flags |= FAST_SYNC_SOCKET_SEND;
+    }
+    if (sock->fast_sync) set_fast_sync_value( sock->fast_sync, flags );
+}
+
 static void sock_reselect( struct sock *sock )
 {
     int ev = sock_get_poll_events( sock->fd );
@@ -584,6 +603,7 @@ static void sock_reselect( struct sock *sock )
         fprintf(stderr,"sock_reselect(%p): new mask %x\n", sock, ev);
 
     set_fd_events( sock->fd, ev );
+    sock_update_fast_sync( sock );
 }
 
 static unsigned int afd_poll_flag_to_win32( unsigned int flags )
@@ -1109,6 +1129,7 @@ static void post_socket_event( struct sock *sock, enum afd_poll_bit event_bit )
     {
         sock->pending_events |= event;
         sock->reported_events |= event;
+        sock_update_fast_sync( sock );
     }
 }
 
@@ -1446,6 +1467,13 @@ static struct fd *sock_get_fd( struct object *obj )
     return (struct fd *)grab_object( sock->fd );
 }
 
+/* get the state of a socket shared with the clients */
+fast_sync_slot_t *sock_get_fast_sync( struct object *obj )
+{
+    if (obj->ops != &sock_ops) return NULL;
+    return ((struct sock *)obj)->fast_sync;
+}
+
 static int sock_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
 {
     struct sock *sock = (struct sock *)obj;
@@ -1510,6 +1538,7 @@ static void sock_destroy( struct object *obj )
     free_async_queue( &sock->poll_q );
     if (sock->event) release_object( sock->event );
     if (sock->fd) release_object( sock->fd );
+    free_fast_sync( sock->fast_sync );
 }
 
 static struct sock *create_socket(void)
@@ -1550,6 +1579,7 @@ static struct sock *create_socket(void)
     sock->rcvtimeo = 0;
     sock->sndtimeo = 0;
     sock->icmp_fixup_data_len = 0;
+    sock->fast_sync = alloc_fast_sync( 0 );
     init_async_queue( &sock->read_q );
     init_async_queue( &sock->write_q );
     init_async_queue( &sock->ifchange_q );
@@ -2298,6 +2328,7 @@ static void sock_ioctl( struct fd *fd, ioctl_code_t code, struct async *async )
         }
         list_add_tail( &sock->accept_list, &req->entry );
         acceptsock->accept_recv_req = req;
+        sock_update_fast_sync( acceptsock );
         release_object( acceptsock );
 
         acceptsock->wparam = params->accept_handle;
@@ -3557,6 +3588,7 @@ DECL_HANDLER(send_socket)
         {
             sock->addr_len = sockaddr_from_unix( &unix_addr, &sock->addr.addr, sizeof(sock->addr) );
             sock->bound = 1;
+            sock_update_fast_sync( sock );
         }
         else if (!bind_errno) bind_errno = errno;
     }
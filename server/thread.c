@@ -772,6 +772,8 @@ static unsigned int end_wait( struct thread *thread, unsigned int status )
         entry->obj->ops->remove_queue( entry->obj, entry );
     if (wait->user) remove_timeout_user( wait->user );
     free( wait );
+    /* let the clients modify the objects checked by check_wait() again */
+    unlock_fast_syncs();
     return status;
 }
 
@@ -861,6 +863,8 @@ static int check_wait( struct thread *thread )
     if ((wait->flags & SELECT_ALERTABLE) && !list_empty(&thread->user_apc)) return STATUS_USER_APC;
     if (wait->when >= 0 && wait->when <= current_time) return STATUS_TIMEOUT;
     if (wait->when < 0 && -wait->when <= monotonic_time) return STATUS_TIMEOUT;
+    /* the objects stay locked until end_wait() if the wait is satisfied */
+    unlock_fast_syncs();
     return -1;
 }
 
@@ -1349,6 +1349,53 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_batch_requests( const char *prefix, data_size_t size )
+{
+    const struct batch_request *batch;
+    const union generic_request *req;
+    data_size_t len;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*batch) + sizeof(*req))
+    {
+        batch = cur_data;
+        req = (const union generic_request *)(batch + 1);
+        fprintf( stderr, "{req=%u", req->request_header.req );
+        if (batch->handle_offset)
+            fprintf( stderr, ",handle_offset=%u,handle_index=%u,handle_source=%u",
+                     batch->handle_offset, batch->handle_index, batch->handle_source );
+        fputc( '}', stderr );
+        len = sizeof(*batch) + sizeof(*req) + ((req->request_header.request_size + 7) & ~7);
+        if (len > size) len = size;
+        size -= len;
+        remove_data( len );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
+static void dump_varargs_batch_replies( const char *prefix, data_size_t size )
+{
+    const union generic_reply *reply;
+    data_size_t len;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*reply))
+    {
+        reply = cur_data;
+        fprintf( stderr, "{error=%s,size=%u}", get_status_name( reply->reply_header.error ),
+                 reply->reply_header.reply_size );
+        len = sizeof(*reply) + ((reply->reply_header.reply_size + 7) & ~7);
+        if (len > size) len = size;
+        size -= len;
+        remove_data( len );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
 typedef void (*dump_func)( const void *req );
 
 /* Everything below this line is generated automatically by tools/make_requests */
@@ -1775,6 +1822,18 @@ static void dump_open_event_reply( const struct open_event_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_fast_sync_slot_request( const struct get_fast_sync_slot_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fast_sync_slot_reply( const struct get_fast_sync_slot_reply *req )
+{
+    fprintf( stderr, " slot=%08x", req->slot );
+    fprintf( stderr, ", serial=%08x", req->serial );
+    fprintf( stderr, ", type=%d", req->type );
+}
+
 static void dump_create_keyed_event_request( const struct create_keyed_event_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2302,6 +2361,17 @@ static void dump_write_process_memory_request( const struct write_process_memory
     dump_varargs_bytes( ", data=", cur_size );
 }
 
+static void dump_get_process_vm_pid_request( const struct get_process_vm_pid_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_get_process_vm_pid_reply( const struct get_process_vm_pid_reply *req )
+{
+    fprintf( stderr, " unix_pid=%d", req->unix_pid );
+}
+
 static void dump_create_key_request( const struct create_key_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2581,6 +2651,7 @@ static void dump_get_msg_queue_request( const struct get_msg_queue_request *req
 static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", shm_slot=%08x", req->shm_slot );
 }
 
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
@@ -4499,6 +4570,17 @@ static void dump_get_next_thread_reply( const struct get_next_thread_reply *req
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_batch_requests_request( const struct batch_requests_request *req )
+{
+    dump_varargs_batch_requests( " requests=", cur_size );
+}
+
+static void dump_batch_requests_reply( const struct batch_requests_reply *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    dump_varargs_batch_replies( ", replies=", cur_size );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_get_new_process_info_request,
@@ -4533,6 +4615,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_event_op_request,
     (dump_func)dump_query_event_request,
     (dump_func)dump_open_event_request,
+    (dump_func)dump_get_fast_sync_slot_request,
     (dump_func)dump_create_keyed_event_request,
     (dump_func)dump_open_keyed_event_request,
     (dump_func)dump_create_mutex_request,
@@ -4580,6 +4663,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_set_debug_obj_info_request,
     (dump_func)dump_read_process_memory_request,
     (dump_func)dump_write_process_memory_request,
+    (dump_func)dump_get_process_vm_pid_request,
     (dump_func)dump_create_key_request,
     (dump_func)dump_open_key_request,
     (dump_func)dump_delete_key_request,
@@ -4777,6 +4861,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_suspend_process_request,
     (dump_func)dump_resume_process_request,
     (dump_func)dump_get_next_thread_request,
+    (dump_func)dump_batch_requests_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -4813,6 +4898,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_event_op_reply,
     (dump_func)dump_query_event_reply,
     (dump_func)dump_open_event_reply,
+    (dump_func)dump_get_fast_sync_slot_reply,
     (dump_func)dump_create_keyed_event_reply,
     (dump_func)dump_open_keyed_event_reply,
     (dump_func)dump_create_mutex_reply,
@@ -4860,6 +4946,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_read_process_memory_reply,
     NULL,
+    (dump_func)dump_get_process_vm_pid_reply,
     (dump_func)dump_create_key_reply,
     (dump_func)dump_open_key_reply,
     NULL,
@@ -5057,6 +5144,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     (dump_func)dump_get_next_thread_reply,
+    (dump_func)dump_batch_requests_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -5093,6 +5181,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "event_op",
     "query_event",
     "open_event",
+    "get_fast_sync_slot",
     "create_keyed_event",
     "open_keyed_event",
     "create_mutex",
@@ -5140,6 +5229,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "set_debug_obj_info",
     "read_process_memory",
     "write_process_memory",
+    "get_process_vm_pid",
     "create_key",
     "open_key",
     "delete_key",
@@ -5337,6 +5427,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "suspend_process",
     "resume_process",
     "get_next_thread",
+    "batch_requests",
 };
 
 static const struct